@@ -0,0 +1,115 @@
+/*
+ * Helpers shared by the kernel benchmarks: a monotonic clock, a repeatable
+ * sample generator and the timing loop.
+ *
+ * Every kernel is timed over a number of calls on a synthetic block and
+ * reported as MSPS and ns/sample, where a sample is whatever one call of
+ * that kernel consumes (real ADC samples for the airspy/hydrasdr raw
+ * paths, complex samples everywhere else).
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define BENCH_ITERATIONS_DEFAULT 200
+
+/* Variant name of the kernels that pick their SIMD path at compile time */
+#if defined(__GNUC__) && defined(__SSE2__)
+#define BENCH_ISA "sse2"
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BENCH_ISA "neon"
+#else
+#define BENCH_ISA "scalar"
+#endif
+
+typedef void (*bench_fn)(void *ctx);
+
+static inline uint64_t bench_now_ns(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return (uint64_t) (counter.QuadPart / frequency.QuadPart) * 1000000000 + (uint64_t) (counter.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/* xorshift32, so that every run and every ISA variant sees the same input */
+static inline uint32_t bench_random(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x;
+}
+
+/* The only argument is the number of timed calls per kernel, 1 makes a quick smoke run */
+static inline int bench_iterations(int argc, char **argv)
+{
+	int n = argc > 1 ? atoi(argv[1]) : BENCH_ITERATIONS_DEFAULT;
+
+	return n > 0 ? n : BENCH_ITERATIONS_DEFAULT;
+}
+
+/*
+ * Times fn(ctx) iterations times after one warm-up call. prepare, when set,
+ * restores the input of in-place kernels and is not timed.
+ */
+static inline void bench_run(const char *kernel, const char *variant, bench_fn prepare, bench_fn fn, void *ctx, int samples_per_call, int iterations)
+{
+	int i;
+	uint64_t t0;
+	uint64_t total = 0;
+	double samples;
+
+	if (prepare != NULL)
+	{
+		prepare(ctx);
+	}
+	fn(ctx);
+
+	for (i = 0; i < iterations; i++)
+	{
+		if (prepare != NULL)
+		{
+			prepare(ctx);
+		}
+
+		t0 = bench_now_ns();
+		fn(ctx);
+		total += bench_now_ns() - t0;
+	}
+
+	if (total == 0)
+	{
+		total = 1;
+	}
+
+	samples = (double) samples_per_call * iterations;
+
+	printf("%-40s %-8s %10.2f MSPS %9.3f ns/sample\n", kernel, variant, samples * 1e3 / total, total / samples);
+	fflush(stdout);
+}
+
+#endif /* BENCH_H */
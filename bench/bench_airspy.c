@@ -0,0 +1,15 @@
+/*
+ * libairspy sample path. The driver is compiled in to reach its file-static
+ * unpack and convert kernels.
+ */
+
+#include "../libairspy/airspy.c"
+
+#include "bench_raw_path.h"
+
+int main(int argc, char **argv)
+{
+	bench_raw_path("airspy", bench_iterations(argc, argv));
+
+	return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * libairspyhf sample path. The driver is compiled in to reach its
+ * file-static convert_samples(), which is run on a device that was never
+ * opened, with only the DSP fields it reads filled in.
+ */
+
+#include "../libairspyhf/airspyhf.c"
+#include "../libairspyhf/iqfft.h"
+
+#include "bench.h"
+
+#define HF_BLOCK_SAMPLES (16 * 1024)
+#define HF_SAMPLERATE 768000
+#define HF_FREQ_SHIFT 5000
+#define HF_CHANNELS 16
+
+typedef struct {
+	airspyhf_device_t device;
+	airspyhf_complex_int16_t *raw;
+	airspyhf_complex_float_t *iq_src;
+	airspyhf_complex_float_t *iq;
+	airspyhf_complex_float_t **channels;
+	struct iq_fft_t *fft;
+	struct pfb_channelizer_t *channelizer;
+} hf_bench_t;
+
+static void run_convert_samples(void *ctx)
+{
+	hf_bench_t *b = (hf_bench_t *) ctx;
+	convert_samples(&b->device, b->raw, b->iq, HF_BLOCK_SAMPLES);
+}
+
+static void prepare_iq(void *ctx)
+{
+	hf_bench_t *b = (hf_bench_t *) ctx;
+	memcpy(b->iq, b->iq_src, HF_BLOCK_SAMPLES * sizeof(airspyhf_complex_float_t));
+}
+
+static void run_iq_balancer_process(void *ctx)
+{
+	hf_bench_t *b = (hf_bench_t *) ctx;
+	iq_balancer_process(b->device.iq_balancer, b->iq, HF_BLOCK_SAMPLES);
+}
+
+static void run_iq_fft_execute(void *ctx)
+{
+	int i;
+	hf_bench_t *b = (hf_bench_t *) ctx;
+
+	for (i = 0; i < HF_BLOCK_SAMPLES; i += FFTBins)
+	{
+		iq_fft_execute(b->fft, b->iq + i);
+	}
+}
+
+static void run_pfb_channelizer_process(void *ctx)
+{
+	hf_bench_t *b = (hf_bench_t *) ctx;
+	pfb_channelizer_process(b->channelizer, b->iq_src, HF_BLOCK_SAMPLES, b->channels);
+}
+
+static void bench_convert_samples(hf_bench_t *b, const char *name, int iterations)
+{
+#if defined(USE_AVX2)
+	b->device.use_avx2 = false;
+	bench_run(name, "sse2", NULL, run_convert_samples, b, HF_BLOCK_SAMPLES, iterations);
+	if (detect_avx2())
+	{
+		b->device.use_avx2 = true;
+		bench_run(name, "avx2", NULL, run_convert_samples, b, HF_BLOCK_SAMPLES, iterations);
+	}
+#elif defined(USE_SSE2)
+	bench_run(name, "sse2", NULL, run_convert_samples, b, HF_BLOCK_SAMPLES, iterations);
+#elif defined(USE_NEON)
+	bench_run(name, "neon", NULL, run_convert_samples, b, HF_BLOCK_SAMPLES, iterations);
+#else
+	bench_run(name, "scalar", NULL, run_convert_samples, b, HF_BLOCK_SAMPLES, iterations);
+#endif
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+	int iterations = bench_iterations(argc, argv);
+	uint32_t seed = 0x2545f491;
+	hf_bench_t b;
+
+	memset(&b, 0, sizeof(b));
+
+	b.raw = (airspyhf_complex_int16_t *) malloc(HF_BLOCK_SAMPLES * sizeof(airspyhf_complex_int16_t));
+	b.iq_src = (airspyhf_complex_float_t *) malloc(HF_BLOCK_SAMPLES * sizeof(airspyhf_complex_float_t));
+	b.iq = (airspyhf_complex_float_t *) malloc(HF_BLOCK_SAMPLES * sizeof(airspyhf_complex_float_t));
+	b.channels = (airspyhf_complex_float_t **) malloc(HF_CHANNELS * sizeof(airspyhf_complex_float_t *));
+	b.channels[0] = (airspyhf_complex_float_t *) malloc(HF_BLOCK_SAMPLES * sizeof(airspyhf_complex_float_t));
+	for (i = 1; i < HF_CHANNELS; i++)
+	{
+		b.channels[i] = b.channels[0] + i * (HF_BLOCK_SAMPLES / HF_CHANNELS);
+	}
+
+	for (i = 0; i < HF_BLOCK_SAMPLES; i++)
+	{
+		b.raw[i].re = (int16_t) bench_random(&seed);
+		b.raw[i].im = (int16_t) bench_random(&seed);
+		b.iq_src[i].re = b.raw[i].re * (1.0f / 32768);
+		b.iq_src[i].im = b.raw[i].im * (1.0f / 32768);
+	}
+
+	b.device.current_samplerate = HF_SAMPLERATE;
+	b.device.filter_gain = 1.0f;
+	b.device.enable_dsp = 1;
+	b.device.iq_balancer = iq_balancer_create(INITIAL_PHASE, INITIAL_AMPLITUDE);
+
+	b.device.is_low_if = 0;
+	b.device.freq_shift = 0;
+	bench_convert_samples(&b, "airspyhf convert_samples zero-IF", iterations);
+
+	b.device.freq_shift = HF_FREQ_SHIFT;
+	bench_convert_samples(&b, "airspyhf convert_samples zero-IF shifted", iterations);
+
+	b.device.is_low_if = 1;
+	bench_convert_samples(&b, "airspyhf convert_samples low-IF shifted", iterations);
+
+	bench_run("airspyhf iq_balancer_process", BENCH_ISA, prepare_iq, run_iq_balancer_process, &b, HF_BLOCK_SAMPLES, iterations);
+
+	b.fft = iq_fft_create(FFTBins);
+	bench_run("airspyhf iq_fft_execute 4096", BENCH_ISA, prepare_iq, run_iq_fft_execute, &b, HF_BLOCK_SAMPLES, iterations);
+	iq_fft_destroy(b.fft);
+
+	b.channelizer = pfb_channelizer_create(HF_CHANNELS, 0.5f / HF_CHANNELS);
+	bench_run("airspyhf pfb_channelizer_process 16", BENCH_ISA, NULL, run_pfb_channelizer_process, &b, HF_BLOCK_SAMPLES, iterations);
+	pfb_channelizer_destroy(b.channelizer);
+
+	iq_balancer_destroy(b.device.iq_balancer);
+	free(b.channels[0]);
+	free(b.channels);
+	free(b.iq);
+	free(b.iq_src);
+	free(b.raw);
+
+	return 0;
+}
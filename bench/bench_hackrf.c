@@ -0,0 +1,118 @@
+/*
+ * libhackrf sample path: the int8 IQ converter and the sweep engine, fed
+ * with synthetic transfers.
+ */
+
+#include <string.h>
+
+#include "../libhackrf/iqconverter.h"
+#include "../libhackrf/sweep_engine.h"
+
+#include "bench.h"
+
+#define HACKRF_TRANSFER_BLOCKS 16
+#define HACKRF_TRANSFER_SAMPLES (HACKRF_TRANSFER_BLOCKS * SAMPLES_PER_BLOCK)
+#define SWEEP_STEP_WIDTH 20000000
+#define SWEEP_SAMPLE_RATE 20e6
+#define SWEEP_FFT_SIZE 256
+
+typedef struct {
+	int8_t *raw;
+	void *out;
+	iqconverter_t *cnv;
+	uint8_t *sweep_buffer;
+	hackrf_transfer transfer;
+	struct hackrf_sweep_engine *engine;
+} hackrf_bench_t;
+
+static int sweep_count;
+
+static int sweep_callback(hackrf_sweep_spectrum *spectrum)
+{
+	(void) spectrum;
+	sweep_count++;
+	return 0;
+}
+
+static void run_iqconverter_process(void *ctx)
+{
+	hackrf_bench_t *b = (hackrf_bench_t *) ctx;
+	iqconverter_process(b->cnv, b->raw, b->out, HACKRF_TRANSFER_SAMPLES);
+}
+
+static void run_sweep_engine_process(void *ctx)
+{
+	hackrf_bench_t *b = (hackrf_bench_t *) ctx;
+	hackrf_sweep_engine_process(b->engine, &b->transfer);
+}
+
+static void bench_iqconverter(hackrf_bench_t *b, enum hackrf_sample_type sample_type, int dc_removal, int iq_correction, const char *name, int iterations)
+{
+	b->cnv = iqconverter_create();
+	b->cnv->sample_type = sample_type;
+	b->cnv->dc_removal = dc_removal;
+	b->cnv->iq_correction = iq_correction;
+	bench_run(name, BENCH_ISA, NULL, run_iqconverter_process, b, HACKRF_TRANSFER_SAMPLES, iterations);
+	iqconverter_free(b->cnv);
+}
+
+int main(int argc, char **argv)
+{
+	int i, k;
+	int iterations = bench_iterations(argc, argv);
+	uint32_t seed = 0x2545f491;
+	uint64_t frequency;
+	const uint16_t frequency_list[] = { 2400, 2500 };
+	uint8_t *block;
+	hackrf_bench_t b;
+
+	memset(&b, 0, sizeof(b));
+
+	b.raw = (int8_t *) malloc(HACKRF_TRANSFER_SAMPLES * 2);
+	b.out = malloc(HACKRF_TRANSFER_SAMPLES * 2 * sizeof(float));
+	b.sweep_buffer = (uint8_t *) malloc(HACKRF_TRANSFER_BLOCKS * BYTES_PER_BLOCK);
+
+	for (i = 0; i < HACKRF_TRANSFER_SAMPLES * 2; i++)
+	{
+		b.raw[i] = (int8_t) bench_random(&seed);
+	}
+
+	bench_iqconverter(&b, HACKRF_SAMPLE_INT16_IQ, 0, 0, "hackrf iqconverter_process int16", iterations);
+	bench_iqconverter(&b, HACKRF_SAMPLE_INT16_IQ, 1, 1, "hackrf iqconverter_process int16 dc+iq", iterations);
+	bench_iqconverter(&b, HACKRF_SAMPLE_FLOAT32_IQ, 0, 0, "hackrf iqconverter_process float", iterations);
+	bench_iqconverter(&b, HACKRF_SAMPLE_FLOAT32_IQ, 1, 1, "hackrf iqconverter_process float dc+iq", iterations);
+
+	/* Sweep blocks step through 2400-2500 MHz, each one tagged like the firmware does */
+	memcpy(b.sweep_buffer, b.raw, HACKRF_TRANSFER_BLOCKS * BYTES_PER_BLOCK);
+	for (i = 0; i < HACKRF_TRANSFER_BLOCKS; i++)
+	{
+		block = b.sweep_buffer + i * BYTES_PER_BLOCK;
+		frequency = (uint64_t) frequency_list[0] * 1000000 + (uint64_t) (i % 5) * SWEEP_STEP_WIDTH;
+
+		block[0] = 0x7F;
+		block[1] = 0x7F;
+		for (k = 0; k < 8; k++)
+		{
+			block[2 + k] = (uint8_t) (frequency >> (8 * k));
+		}
+	}
+
+	b.transfer.buffer = b.sweep_buffer;
+	b.transfer.buffer_length = HACKRF_TRANSFER_BLOCKS * BYTES_PER_BLOCK;
+	b.transfer.valid_length = b.transfer.buffer_length;
+
+	b.engine = hackrf_sweep_engine_create(frequency_list, 1, SWEEP_STEP_WIDTH, 0, LINEAR, SWEEP_SAMPLE_RATE, SWEEP_FFT_SIZE, HACKRF_SWEEP_WINDOW_HANN, sweep_callback);
+	if (b.engine == NULL)
+	{
+		fprintf(stderr, "hackrf_sweep_engine_create() failed\n");
+		return 1;
+	}
+	bench_run("hackrf hackrf_sweep_engine_process 256", BENCH_ISA, NULL, run_sweep_engine_process, &b, HACKRF_TRANSFER_SAMPLES, iterations);
+	hackrf_sweep_engine_destroy(b.engine);
+
+	free(b.sweep_buffer);
+	free(b.out);
+	free(b.raw);
+
+	return 0;
+}
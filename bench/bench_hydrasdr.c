@@ -0,0 +1,15 @@
+/*
+ * libhydrasdr sample path. The driver is compiled in to reach its file-static
+ * unpack and convert kernels.
+ */
+
+#include "../libhydrasdr/hydrasdr.c"
+
+#include "bench_raw_path.h"
+
+int main(int argc, char **argv)
+{
+	bench_raw_path("hydrasdr", bench_iterations(argc, argv));
+
+	return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Raw sample path shared by libairspy and libhydrasdr, which use the same
+ * kernel names: 12 bit unpacking, int16/float conversion and the IQ
+ * converters. Included by bench_airspy.c and bench_hydrasdr.c right after
+ * the driver .c file, whose file-static kernels it calls.
+ */
+
+#ifndef BENCH_RAW_PATH_H
+#define BENCH_RAW_PATH_H
+
+#include <string.h>
+
+#include "bench.h"
+
+/* 256 KiB of unpacked samples, the size of one USB transfer */
+#define RAW_BLOCK_SAMPLES (128 * 1024)
+
+typedef struct {
+	uint32_t *packed;
+	uint16_t *unpacked;
+	int16_t *out_int16;
+	float *out_float;
+	int16_t *iq_int16_src;
+	float *iq_float_src;
+	iqconverter_int16_t *cnv_i;
+	iqconverter_float_t *cnv_f;
+} raw_path_bench_t;
+
+static void run_unpack_samples(void *ctx)
+{
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+	unpack_samples(b->packed, b->unpacked, RAW_BLOCK_SAMPLES);
+}
+
+static void run_convert_samples_int16(void *ctx)
+{
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+	convert_samples_int16(b->unpacked, b->out_int16, RAW_BLOCK_SAMPLES);
+}
+
+static void run_convert_samples_float(void *ctx)
+{
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+	convert_samples_float(b->unpacked, b->out_float, RAW_BLOCK_SAMPLES);
+}
+
+/* The scalar tail of unpack_convert_samples_*() over the whole block */
+static void run_unpack_convert_int16_scalar(void *ctx)
+{
+	int i, j;
+	uint16_t samples[8];
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+
+	for (i = 0, j = 0; j < RAW_BLOCK_SAMPLES; i += 3, j += 8)
+	{
+		unpack_samples(b->packed + i, samples, 8);
+		convert_samples_int16(samples, b->out_int16 + j, 8);
+	}
+}
+
+static void run_unpack_convert_float_scalar(void *ctx)
+{
+	int i, j;
+	uint16_t samples[8];
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+
+	for (i = 0, j = 0; j < RAW_BLOCK_SAMPLES; i += 3, j += 8)
+	{
+		unpack_samples(b->packed + i, samples, 8);
+		convert_samples_float(samples, b->out_float + j, 8);
+	}
+}
+
+static void run_unpack_convert_int16(void *ctx)
+{
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+	unpack_convert_samples_int16(b->packed, b->out_int16, RAW_BLOCK_SAMPLES);
+}
+
+static void run_unpack_convert_float(void *ctx)
+{
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+	unpack_convert_samples_float(b->packed, b->out_float, RAW_BLOCK_SAMPLES);
+}
+
+static void prepare_iqconverter_int16(void *ctx)
+{
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+	memcpy(b->out_int16, b->iq_int16_src, RAW_BLOCK_SAMPLES * sizeof(int16_t));
+}
+
+static void run_iqconverter_int16(void *ctx)
+{
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+	iqconverter_int16_process(b->cnv_i, b->out_int16, RAW_BLOCK_SAMPLES);
+}
+
+static void prepare_iqconverter_float(void *ctx)
+{
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+	memcpy(b->out_float, b->iq_float_src, RAW_BLOCK_SAMPLES * sizeof(float));
+}
+
+static void run_iqconverter_float(void *ctx)
+{
+	raw_path_bench_t *b = (raw_path_bench_t *) ctx;
+	iqconverter_float_process(b->cnv_f, b->out_float, RAW_BLOCK_SAMPLES);
+}
+
+static void bench_raw_path(const char *driver, int iterations)
+{
+	static const char *simd_names[] = { "scalar", "sse2", "avx2", "neon" };
+	int i;
+	int simd;
+	int best_simd;
+	uint32_t seed = 0x2545f491;
+	char name[64];
+	raw_path_bench_t b;
+
+	b.packed = (uint32_t *) malloc(RAW_BLOCK_SAMPLES / 8 * 3 * sizeof(uint32_t));
+	b.unpacked = (uint16_t *) malloc(RAW_BLOCK_SAMPLES * sizeof(uint16_t));
+	b.out_int16 = (int16_t *) malloc(RAW_BLOCK_SAMPLES * sizeof(int16_t));
+	b.out_float = (float *) malloc(RAW_BLOCK_SAMPLES * sizeof(float));
+	b.iq_int16_src = (int16_t *) malloc(RAW_BLOCK_SAMPLES * sizeof(int16_t));
+	b.iq_float_src = (float *) malloc(RAW_BLOCK_SAMPLES * sizeof(float));
+
+	for (i = 0; i < RAW_BLOCK_SAMPLES / 8 * 3; i++)
+	{
+		b.packed[i] = bench_random(&seed);
+	}
+
+	/* The IQ converters see what the driver would feed them: converted 12 bit noise */
+	unpack_samples(b.packed, b.unpacked, RAW_BLOCK_SAMPLES);
+	convert_samples_int16(b.unpacked, b.iq_int16_src, RAW_BLOCK_SAMPLES);
+	convert_samples_float(b.unpacked, b.iq_float_src, RAW_BLOCK_SAMPLES);
+
+	snprintf(name, sizeof(name), "%s unpack_samples", driver);
+	bench_run(name, "scalar", NULL, run_unpack_samples, &b, RAW_BLOCK_SAMPLES, iterations);
+
+	snprintf(name, sizeof(name), "%s convert_samples_int16", driver);
+	bench_run(name, "scalar", NULL, run_convert_samples_int16, &b, RAW_BLOCK_SAMPLES, iterations);
+
+	snprintf(name, sizeof(name), "%s convert_samples_float", driver);
+	bench_run(name, "scalar", NULL, run_convert_samples_float, &b, RAW_BLOCK_SAMPLES, iterations);
+
+	snprintf(name, sizeof(name), "%s unpack_convert_samples_int16", driver);
+	bench_run(name, "scalar", NULL, run_unpack_convert_int16_scalar, &b, RAW_BLOCK_SAMPLES, iterations);
+#if defined(USE_SSSE3_UNPACK)
+	if (__builtin_cpu_supports("ssse3"))
+	{
+		bench_run(name, "ssse3", NULL, run_unpack_convert_int16, &b, RAW_BLOCK_SAMPLES, iterations);
+	}
+#elif defined(USE_NEON_UNPACK)
+	bench_run(name, "neon", NULL, run_unpack_convert_int16, &b, RAW_BLOCK_SAMPLES, iterations);
+#endif
+
+	snprintf(name, sizeof(name), "%s unpack_convert_samples_float", driver);
+	bench_run(name, "scalar", NULL, run_unpack_convert_float_scalar, &b, RAW_BLOCK_SAMPLES, iterations);
+#if defined(USE_SSSE3_UNPACK)
+	if (__builtin_cpu_supports("ssse3"))
+	{
+		bench_run(name, "ssse3", NULL, run_unpack_convert_float, &b, RAW_BLOCK_SAMPLES, iterations);
+	}
+#elif defined(USE_NEON_UNPACK)
+	bench_run(name, "neon", NULL, run_unpack_convert_float, &b, RAW_BLOCK_SAMPLES, iterations);
+#endif
+
+	/* iqconverter_int16.c picks its kernels at compile time */
+	b.cnv_i = iqconverter_int16_create(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN);
+	snprintf(name, sizeof(name), "%s iqconverter_int16_process", driver);
+	bench_run(name, BENCH_ISA, prepare_iqconverter_int16, run_iqconverter_int16, &b, RAW_BLOCK_SAMPLES, iterations);
+	iqconverter_int16_free(b.cnv_i);
+
+	/* iqconverter_float selects a variant at create time, each one the CPU runs is forced in turn */
+	b.cnv_f = iqconverter_float_create(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN);
+	best_simd = b.cnv_f->simd;
+	iqconverter_float_free(b.cnv_f);
+
+	snprintf(name, sizeof(name), "%s iqconverter_float_process", driver);
+	for (simd = IQCONVERTER_SIMD_NONE; simd <= IQCONVERTER_SIMD_NEON; simd++)
+	{
+		if (simd != IQCONVERTER_SIMD_NONE && simd != best_simd && !(simd == IQCONVERTER_SIMD_SSE2 && best_simd == IQCONVERTER_SIMD_AVX2))
+		{
+			continue;
+		}
+
+		b.cnv_f = iqconverter_float_create(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN);
+		b.cnv_f->simd = simd;
+		bench_run(name, simd_names[simd], prepare_iqconverter_float, run_iqconverter_float, &b, RAW_BLOCK_SAMPLES, iterations);
+		iqconverter_float_free(b.cnv_f);
+	}
+
+	free(b.packed);
+	free(b.unpacked);
+	free(b.out_int16);
+	free(b.out_float);
+	free(b.iq_int16_src);
+	free(b.iq_float_src);
+}
+
+#endif /* BENCH_RAW_PATH_H */
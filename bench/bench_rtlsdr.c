@@ -0,0 +1,70 @@
+/*
+ * librtlsdr converted sample path. iq_converter.c is compiled in so that
+ * each conversion variant the CPU supports can be forced in turn.
+ */
+
+#include "../librtlsdr/iq_converter.c"
+
+#include "bench.h"
+
+#define RTLSDR_TRANSFER_SAMPLES (128 * 1024)
+
+typedef struct {
+	uint8_t *raw;
+	iq_converter_t *cnv;
+} rtlsdr_bench_t;
+
+static void run_iq_converter_process(void *ctx)
+{
+	void *out;
+	rtlsdr_bench_t *b = (rtlsdr_bench_t *) ctx;
+
+	iq_converter_process(b->cnv, b->raw, RTLSDR_TRANSFER_SAMPLES, &out);
+}
+
+static void bench_iq_converter(rtlsdr_bench_t *b, enum rtlsdr_sample_format format, int dc_block, int decimation, int iterations)
+{
+	char name[64];
+
+	snprintf(name, sizeof(name), "rtlsdr iq_converter_process %s%s /%d", format == RTLSDR_SAMPLE_INT16_IQ ? "int16" : "float", dc_block ? " dc" : "", decimation);
+
+	b->cnv = iq_converter_create(format, dc_block, decimation);
+
+#if defined(USE_AVX2)
+	if (b->cnv->use_avx2)
+	{
+		bench_run(name, "avx2", NULL, run_iq_converter_process, b, RTLSDR_TRANSFER_SAMPLES, iterations);
+	}
+	b->cnv->use_avx2 = 0;
+	bench_run(name, "sse2", NULL, run_iq_converter_process, b, RTLSDR_TRANSFER_SAMPLES, iterations);
+#else
+	bench_run(name, BENCH_ISA, NULL, run_iq_converter_process, b, RTLSDR_TRANSFER_SAMPLES, iterations);
+#endif
+
+	iq_converter_free(b->cnv);
+}
+
+int main(int argc, char **argv)
+{
+	int i;
+	int iterations = bench_iterations(argc, argv);
+	uint32_t seed = 0x2545f491;
+	rtlsdr_bench_t b;
+
+	b.raw = (uint8_t *) malloc(RTLSDR_TRANSFER_SAMPLES * 2);
+	for (i = 0; i < RTLSDR_TRANSFER_SAMPLES * 2; i++)
+	{
+		b.raw[i] = (uint8_t) bench_random(&seed);
+	}
+
+	bench_iq_converter(&b, RTLSDR_SAMPLE_FLOAT32_IQ, 0, 1, iterations);
+	bench_iq_converter(&b, RTLSDR_SAMPLE_FLOAT32_IQ, 1, 1, iterations);
+	bench_iq_converter(&b, RTLSDR_SAMPLE_INT16_IQ, 1, 1, iterations);
+	bench_iq_converter(&b, RTLSDR_SAMPLE_FLOAT32_IQ, 1, 2, iterations);
+	bench_iq_converter(&b, RTLSDR_SAMPLE_FLOAT32_IQ, 1, 8, iterations);
+	bench_iq_converter(&b, RTLSDR_SAMPLE_INT16_IQ, 1, 8, iterations);
+
+	free(b.raw);
+
+	return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * Checks every SIMD variant of iqconverter_float against the scalar
+ * reference (IQCONVERTER_SIMD_NONE) on the same input:
+ *
+ * - fs/4 translation, half-band FIR and delay must be bit-identical;
+ * - the full process() output, which adds the unrolled DC removal, must
+ *   stay within PROCESS_TOLERANCE of the reference.
+ *
+ * The converter source is compiled in (IQCONVERTER_FLOAT_C names the
+ * libairspy or libhydrasdr copy) to reach its file-static stages. The test
+ * is built with -ffp-contract=off, as fused multiply-adds in the scalar
+ * reference would round differently from the vector kernels.
+ */
+
+#include IQCONVERTER_FLOAT_C
+#include IQCONVERTER_FILTERS_H
+
+#include <math.h>
+
+#include "bench.h"
+
+#define TEST_SAMPLES (1 << 20)
+
+/*
+ * The unrolled DC removal reassociates avg += SCALE * (x - avg), which is
+ * contractive (|1 - SCALE|^4 < 1), so rounding differences do not build up
+ * over the stream. 1e-5 is about 100 float ulps at the 0.5 full scale used
+ * here; a real state divergence would be orders of magnitude larger.
+ */
+#define PROCESS_TOLERANCE 1e-5f
+
+/* Block lengths in floats, all multiples of 4; the shortest ones are below the delay length */
+static const int block_lengths[] = { 16384, 4, 8, 1000, 20, 65536, 44, 4096, 12, 262144 };
+
+static float *make_input(void)
+{
+	int i;
+	uint32_t seed = 0x2545f491;
+	float *input = (float *) malloc(TEST_SAMPLES * sizeof(float));
+
+	/* Noise on a DC offset and a tone, the shape of a real capture */
+	for (i = 0; i < TEST_SAMPLES; i++)
+	{
+		input[i] = 0.1f + 0.25f * sinf(i * 0.01f) + ((int32_t) bench_random(&seed) >> 8) * (0.15f / (1 << 23));
+	}
+
+	return input;
+}
+
+static int supported(int simd, int best_simd)
+{
+	return simd == best_simd || (simd == IQCONVERTER_SIMD_SSE2 && best_simd == IQCONVERTER_SIMD_AVX2);
+}
+
+typedef void (*stage_fn)(iqconverter_float_t *cnv, float *samples, int len);
+
+static void translate_stage(iqconverter_float_t *cnv, float *samples, int len)
+{
+	translate_fs_4(cnv, samples, len);
+}
+
+static void process_stage(iqconverter_float_t *cnv, float *samples, int len)
+{
+	iqconverter_float_process(cnv, samples, len);
+}
+
+/* Runs the whole input through both converters block by block, returns the largest difference or -1 on a bit mismatch */
+static float compare(const float *kernel, int kernel_len, int simd, stage_fn stage, int exact, const float *input, float *a, float *b)
+{
+	int i, n, pos;
+	int block = 0;
+	float diff;
+	float max_diff = 0.0f;
+	iqconverter_float_t *ref = iqconverter_float_create(kernel, kernel_len);
+	iqconverter_float_t *cnv = iqconverter_float_create(kernel, kernel_len);
+
+	ref->simd = IQCONVERTER_SIMD_NONE;
+	cnv->simd = simd;
+
+	for (pos = 0; pos < TEST_SAMPLES; pos += n)
+	{
+		n = block_lengths[block++ % (sizeof(block_lengths) / sizeof(block_lengths[0]))];
+		if (n > TEST_SAMPLES - pos)
+		{
+			n = TEST_SAMPLES - pos;
+		}
+
+		memcpy(a, input + pos, n * sizeof(float));
+		memcpy(b, input + pos, n * sizeof(float));
+		stage(ref, a, n);
+		stage(cnv, b, n);
+
+		if (exact && memcmp(a, b, n * sizeof(float)) != 0)
+		{
+			for (i = 0; i < n && memcmp(a + i, b + i, sizeof(float)) == 0; i++)
+			{
+			}
+			fprintf(stderr, "  sample %d: %.9g != %.9g\n", pos + i, a[i], b[i]);
+			max_diff = -1.0f;
+			break;
+		}
+
+		for (i = 0; i < n; i++)
+		{
+			diff = fabsf(a[i] - b[i]);
+			if (diff > max_diff)
+			{
+				max_diff = diff;
+			}
+		}
+	}
+
+	iqconverter_float_free(ref);
+	iqconverter_float_free(cnv);
+
+	return max_diff;
+}
+
+int main(void)
+{
+	static const char *simd_names[] = { "scalar", "sse2", "avx2", "neon" };
+	/* 7, 15, 23 and 47 taps run the folded filters, 31 the generic one */
+	static const int kernel_lens[] = { 7, 15, 23, 31, HB_KERNEL_FLOAT_LEN };
+	float kernel[HB_KERNEL_FLOAT_LEN];
+	int i, k, simd, best_simd;
+	int failures = 0;
+	int checked = 0;
+	float diff;
+	float *input = make_input();
+	float *a = (float *) malloc(TEST_SAMPLES * sizeof(float));
+	float *b = (float *) malloc(TEST_SAMPLES * sizeof(float));
+	iqconverter_float_t *probe = iqconverter_float_create(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN);
+
+	best_simd = probe->simd;
+	iqconverter_float_free(probe);
+
+	for (k = 0; k < (int) (sizeof(kernel_lens) / sizeof(kernel_lens[0])); k++)
+	{
+		/* The shorter half-band kernels are the central taps of the 47 tap one */
+		for (i = 0; i < kernel_lens[k]; i++)
+		{
+			kernel[i] = HB_KERNEL_FLOAT[(HB_KERNEL_FLOAT_LEN - kernel_lens[k]) / 2 + i];
+		}
+
+		for (simd = IQCONVERTER_SIMD_SSE2; simd <= IQCONVERTER_SIMD_NEON; simd++)
+		{
+			if (!supported(simd, best_simd))
+			{
+				continue;
+			}
+
+			diff = compare(kernel, kernel_lens[k], simd, translate_stage, 1, input, a, b);
+			printf("%2d taps %-6s translate+fir+delay %s\n", kernel_lens[k], simd_names[simd], diff == 0.0f ? "bit-identical" : "MISMATCH");
+			failures += diff != 0.0f;
+
+			diff = compare(kernel, kernel_lens[k], simd, process_stage, 0, input, a, b);
+			printf("%2d taps %-6s process              max diff %.3g\n", kernel_lens[k], simd_names[simd], diff);
+			failures += diff > PROCESS_TOLERANCE;
+
+			checked++;
+		}
+	}
+
+	if (checked == 0)
+	{
+		printf("no SIMD variant on this CPU, nothing to compare\n");
+	}
+
+	free(input);
+	free(a);
+	free(b);
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/*
+ * Checks iqconverter_int16 against golden output of the scalar converter.
+ *
+ * The SIMD variant is chosen at build time, so there is no scalar path to
+ * compare with at runtime. The golden hashes and the excerpt below were
+ * taken from the original scalar-only converter on the same input and
+ * block sequence; the integer pipeline must reproduce them bit for bit on
+ * every variant.
+ *
+ * The converter source is compiled in: IQCONVERTER_INT16_C names the
+ * libairspy or libhydrasdr copy, which share the kernel and the expected
+ * output.
+ */
+
+#include IQCONVERTER_INT16_C
+#include IQCONVERTER_FILTERS_H
+
+#include "bench.h"
+
+#define TEST_SAMPLES (1 << 20)
+
+/* Excerpt of the 47 tap output, away from the start-up transient */
+#define GOLDEN_OFFSET 4096
+#define GOLDEN_EXCERPT_LEN 16
+
+typedef struct {
+	int kernel_len;
+	uint64_t hash;
+} golden_t;
+
+static const golden_t golden[] = {
+	{ 7, 0x8b02ab31ebc6b730ULL },
+	{ 15, 0xe0891a2419ea37f3ULL },
+	{ 23, 0x8e82bbf21a36bb69ULL },
+	{ 31, 0x6cf7c69644a99350ULL },
+	{ HB_KERNEL_INT16_LEN, 0x47aa06b447e6d29eULL }
+};
+
+static const int16_t golden_excerpt[GOLDEN_EXCERPT_LEN] = {
+	-2148, -1109, -633, -1388, 3735, 2366, 2403, -698,
+	-108, -422, 1598, -1405, 1945, 3108, -4647, 1687
+};
+
+/* Block lengths in int16, all multiples of 4; the shortest ones are below the delay length */
+static const int block_lengths[] = { 16384, 4, 8, 1000, 20, 65536, 44, 4096, 12, 262144 };
+
+static int16_t *make_input(void)
+{
+	int i, tone;
+	uint32_t seed = 0x2545f491;
+	int16_t *input = (int16_t *) malloc(TEST_SAMPLES * sizeof(int16_t));
+
+	/* Integer only, so the input does not depend on the libm: DC offset, triangle tone and noise at the ADC's 12 bits */
+	for (i = 0; i < TEST_SAMPLES; i++)
+	{
+		tone = (i & 1023) < 512 ? (i & 511) : 511 - (i & 511);
+		input[i] = (int16_t) ((300 + (tone - 256) * 4 + ((int32_t) bench_random(&seed) >> 22)) * 16);
+	}
+
+	return input;
+}
+
+/* FNV-1a over the samples, low byte first so the hash does not depend on the host byte order */
+static uint64_t hash_samples(uint64_t hash, const int16_t *samples, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+	{
+		hash = (hash ^ ((uint16_t) samples[i] & 0xff)) * 0x100000001b3ULL;
+		hash = (hash ^ ((uint16_t) samples[i] >> 8)) * 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+int main(void)
+{
+	int i, k, n, pos;
+	int block;
+	int failures = 0;
+	int16_t kernel[HB_KERNEL_INT16_LEN];
+	uint64_t hash;
+	int16_t *input = make_input();
+	int16_t *output = (int16_t *) malloc(TEST_SAMPLES * sizeof(int16_t));
+	iqconverter_int16_t *cnv;
+
+	for (k = 0; k < (int) (sizeof(golden) / sizeof(golden[0])); k++)
+	{
+		/* The shorter half-band kernels are the central taps of the 47 tap one */
+		for (i = 0; i < golden[k].kernel_len; i++)
+		{
+			kernel[i] = HB_KERNEL_INT16[(HB_KERNEL_INT16_LEN - golden[k].kernel_len) / 2 + i];
+		}
+
+		cnv = iqconverter_int16_create(kernel, golden[k].kernel_len);
+		memcpy(output, input, TEST_SAMPLES * sizeof(int16_t));
+
+		block = 0;
+		for (pos = 0; pos < TEST_SAMPLES; pos += n)
+		{
+			n = block_lengths[block++ % (sizeof(block_lengths) / sizeof(block_lengths[0]))];
+			if (n > TEST_SAMPLES - pos)
+			{
+				n = TEST_SAMPLES - pos;
+			}
+
+			iqconverter_int16_process(cnv, output + pos, n);
+		}
+
+		iqconverter_int16_free(cnv);
+
+		hash = hash_samples(0xcbf29ce484222325ULL, output, TEST_SAMPLES);
+		printf("%2d taps %-6s hash %016llx %s\n", golden[k].kernel_len, BENCH_ISA, (unsigned long long) hash, hash == golden[k].hash ? "matches" : "MISMATCH");
+		failures += hash != golden[k].hash;
+
+		if (golden[k].kernel_len == HB_KERNEL_INT16_LEN)
+		{
+			for (i = 0; i < GOLDEN_EXCERPT_LEN; i++)
+			{
+				if (output[GOLDEN_OFFSET + i] != golden_excerpt[i])
+				{
+					fprintf(stderr, "  sample %d: %d != %d\n", GOLDEN_OFFSET + i, output[GOLDEN_OFFSET + i], golden_excerpt[i]);
+					failures++;
+				}
+			}
+		}
+	}
+
+	free(input);
+	free(output);
+
+	return failures == 0 ? 0 : 1;
+}
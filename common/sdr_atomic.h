@@ -0,0 +1,28 @@
+/*
+ * Sequentially consistent loads and stores for the lock-free state of the
+ * drivers: 32 bit for the USB buffer rings (libairspy, libhackrf,
+ * librtlsdr), 64 bit for the IQ balancer coefficients (libairspyhf).
+ *
+ * On MSVC the Interlocked functions come from <windows.h>, which is pulled
+ * in here when libusb.h has not already done so.
+ */
+
+#ifndef SDR_ATOMIC_H
+#define SDR_ATOMIC_H
+
+#include <stdint.h>
+
+#if defined(_MSC_VER)
+#include <windows.h>
+#define ATOMIC_LOAD(p) ((uint32_t) InterlockedCompareExchange((volatile LONG *)(p), 0, 0))
+#define ATOMIC_STORE(p, v) InterlockedExchange((volatile LONG *)(p), (LONG)(v))
+#define ATOMIC_LOAD64(p) ((uint64_t) InterlockedCompareExchange64((volatile LONG64 *)(p), 0, 0))
+#define ATOMIC_STORE64(p, v) InterlockedExchange64((volatile LONG64 *)(p), (LONG64)(v))
+#else
+#define ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define ATOMIC_LOAD64(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE64(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#endif
+
+#endif /* SDR_ATOMIC_H */
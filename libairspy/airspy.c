@@ -26,6 +26,7 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <libusb.h>
 
 #if _MSC_VER > 1700  // To avoid error with Visual Studio 2017/2019 or more define which define timespec as it is already defined in pthread.h
@@ -33,11 +34,21 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #endif
 
 #include <pthread.h>
+#include <sched.h>
 
 #include "airspy.h"
 #include "iqconverter_float.h"
 #include "iqconverter_int16.h"
 #include "filters.h"
+#include "../common/sdr_atomic.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(AIRSPY_BIG_ENDIAN)
+#include <immintrin.h>
+#define USE_SSSE3_UNPACK
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(AIRSPY_BIG_ENDIAN)
+#include <arm_neon.h>
+#define USE_NEON_UNPACK
+#endif
 
 #ifndef bool
 typedef int bool;
@@ -48,6 +59,15 @@ typedef int bool;
 #define PACKET_SIZE (12)
 #define UNPACKED_SIZE (16)
 #define RAW_BUFFER_COUNT (8)
+#define RAW_BUFFER_COUNT_MAX (256)
+#define CONSUMER_SPIN_COUNT (16)
+#define WORKER_THREADS_MAX (8)
+/* Samples of the previous block replayed ahead of each pipelined block to settle the converter state */
+#define PIPELINE_OVERLAP (4096)
+#define POOL_RETAINED_BLOCKS_MAX (1024)
+#define EMULATED_SAMPLERATE_DEFAULT (20000000)
+/* How long stopping waits for cancelled transfers to come back from libusb */
+#define TRANSFER_CANCEL_TIMEOUT_US (1000000)
 
 #ifdef AIRSPY_BIG_ENDIAN
 #define TO_LE(x) __builtin_bswap32(x)
@@ -73,11 +93,38 @@ typedef struct {
 	uint32_t freq_hz;
 } set_freq_params_t;
 
+enum pipeline_job_state
+{
+	PIPELINE_JOB_IDLE = 0,
+	PIPELINE_JOB_PENDING = 1,
+	PIPELINE_JOB_DONE = 2
+};
+
+typedef struct pipeline_job
+{
+	struct airspy_device* device;
+	pthread_t thread;
+	pthread_cond_t cv;
+	volatile int state;
+	uint16_t *input_samples;
+	uint8_t *overlap_samples;
+	bool has_overlap;
+	void *output_buffer;
+	int sample_count;
+	uint32_t dropped_buffers;
+	iqconverter_float_t *cnv_f;
+	iqconverter_int16_t *cnv_i;
+	airspy_timing_stats_t convert_stats;
+	airspy_timing_stats_t filter_stats;
+} pipeline_job_t;
+
 typedef struct airspy_device
 {
 	libusb_context* usb_context;
 	libusb_device_handle* usb_device;
 	struct libusb_transfer** transfers;
+	/* Transfers owned by libusb, only changed with no event thread running or on the event thread */
+	uint32_t active_transfers;
 	airspy_sample_block_cb_fn callback;
 	volatile bool streaming;
 	volatile bool stop_requested;
@@ -90,16 +137,54 @@ typedef struct airspy_device
 	uint32_t transfer_count;
 	uint32_t buffer_size;
 	uint32_t dropped_buffers;
-	uint32_t dropped_buffers_queue[RAW_BUFFER_COUNT];
-	uint16_t *received_samples_queue[RAW_BUFFER_COUNT];
-	volatile int received_samples_queue_head;
-	volatile int received_samples_queue_tail;
-	volatile int received_buffer_count;
+	/*
+	 * Ring of raw_buffer_count slots: airspy_libusb_transfer_callback()
+	 * swaps the filled transfer buffer (or pool block) into the slot at
+	 * head, consumer_threadproc() or the pipeline frees the slot at tail.
+	 * consumer_mp and consumer_cv only come into play once the consumer
+	 * has spun without finding a buffer.
+	 */
+	uint32_t raw_buffer_count;
+	uint32_t *dropped_buffers_queue;
+	uint64_t *received_time_queue;
+	uint16_t **received_samples_queue;
+	volatile uint32_t received_samples_queue_head;
+	volatile uint32_t received_samples_queue_tail;
+	volatile uint32_t consumer_waiting;
 	void *output_buffer;
 	uint16_t *unpacked_samples;
 	bool packing_enabled;
 	iqconverter_float_t *cnv_f;
 	iqconverter_int16_t *cnv_i;
+	uint32_t decimation_stages;
+	/* Producer side fields are only written by the transfer thread, the rest by the consumer thread */
+	airspy_stream_stats_t stats;
+	uint32_t worker_count;
+	uint32_t pipeline_job_count;
+	pipeline_job_t *pipeline_jobs;
+	pthread_mutex_t pipeline_mp;
+	volatile bool pipeline_stop;
+	uint8_t *pipeline_carry;
+	bool pipeline_has_carry;
+	bool pooled;
+	uint8_t *pool_memory;
+	bool pool_dev_mem;
+	bool pool_detached;
+	uint32_t pool_block_count;
+	uint32_t pool_block_size;
+	uint32_t pool_held_count;
+	uint32_t *pool_refcount;
+	uint32_t *pool_free_stack;
+	uint32_t pool_free_count;
+	uint32_t *pool_queue;
+	uint8_t **pool_saved_buffers;
+	pthread_mutex_t pool_mp;
+	bool emulated;
+	bool emulated_throttle;
+	uint32_t emulated_samplerate; /* Real samples per second */
+	uint32_t emulated_stall_every;
+	uint32_t emulated_stall_us;
+	uint8_t *emulated_block;
 	void* ctx;
 	enum airspy_sample_type sample_type;
 } airspy_device_t;
@@ -128,7 +213,7 @@ static int cancel_transfers(airspy_device_t* device)
 	{
 		for (transfer_index = 0; transfer_index<device->transfer_count; transfer_index++)
 		{
-			if (device->transfers[transfer_index] != NULL)
+			if (device->transfers[transfer_index] != NULL && !device->emulated)
 			{
 				libusb_cancel_transfer(device->transfers[transfer_index]);
 			}
@@ -140,9 +225,34 @@ static int cancel_transfers(airspy_device_t* device)
 	}
 }
 
+static uint64_t monotonic_time_us(void);
+
+/*
+ * Handle events until libusb has given back every transfer, called once the
+ * transfer thread has exited. The transfer buffers (or pool blocks) must not
+ * be freed before this succeeds.
+ */
+static int wait_for_transfers(airspy_device_t* device)
+{
+	struct timeval timeout = { 0, 10000 };
+	uint64_t deadline = monotonic_time_us() + TRANSFER_CANCEL_TIMEOUT_US;
+
+	while (device->active_transfers > 0)
+	{
+		if (monotonic_time_us() > deadline)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
+	}
+
+	return AIRSPY_SUCCESS;
+}
+
 static int free_transfers(airspy_device_t* device)
 {
-	int i;
+	uint32_t i;
 	uint32_t transfer_index;
 
 	if (device->transfers != NULL)
@@ -159,27 +269,65 @@ static int free_transfers(airspy_device_t* device)
 		}
 		free(device->transfers);
 		device->transfers = NULL;
+	}
 
-		if (device->output_buffer != NULL)
-		{
-			free(device->output_buffer);
-			device->output_buffer = NULL;
-		}
+	/* allocate_transfers() may have failed before the transfers were created */
+	if (device->output_buffer != NULL)
+	{
+		free(device->output_buffer);
+		device->output_buffer = NULL;
+	}
 
-		if (device->unpacked_samples != NULL)
-		{
-			free(device->unpacked_samples);
-			device->unpacked_samples = NULL;
-		}
+	if (device->unpacked_samples != NULL)
+	{
+		free(device->unpacked_samples);
+		device->unpacked_samples = NULL;
+	}
 
-		for (i = 0; i < RAW_BUFFER_COUNT; i++)
+	if (device->received_samples_queue != NULL)
+	{
+		for (i = 0; i < device->raw_buffer_count; i++)
 		{
 			if (device->received_samples_queue[i] != NULL)
 			{
 				free(device->received_samples_queue[i]);
-				device->received_samples_queue[i] = NULL;
 			}
 		}
+		free(device->received_samples_queue);
+		device->received_samples_queue = NULL;
+	}
+
+	if (device->dropped_buffers_queue != NULL)
+	{
+		free(device->dropped_buffers_queue);
+		device->dropped_buffers_queue = NULL;
+	}
+
+	if (device->received_time_queue != NULL)
+	{
+		free(device->received_time_queue);
+		device->received_time_queue = NULL;
+	}
+
+	return AIRSPY_SUCCESS;
+}
+
+/* Only UINT16_REAL unpacks into a separate buffer, FLOAT32_IQ and INT16_IQ unpack and convert in one pass */
+static int allocate_unpacked_samples(airspy_device_t* const device, enum airspy_sample_type sample_type)
+{
+	size_t sample_count;
+
+	if (!device->packing_enabled || sample_type != AIRSPY_SAMPLE_UINT16_REAL || device->unpacked_samples != NULL)
+	{
+		return AIRSPY_SUCCESS;
+	}
+
+	sample_count = ((device->buffer_size / 2) * 4) / 3;
+
+	device->unpacked_samples = (uint16_t*)malloc(sample_count * sizeof(uint16_t));
+	if (device->unpacked_samples == NULL)
+	{
+		return AIRSPY_ERROR_NO_MEM;
 	}
 
 	return AIRSPY_SUCCESS;
@@ -187,13 +335,21 @@ static int free_transfers(airspy_device_t* device)
 
 static int allocate_transfers(airspy_device_t* const device)
 {
-	int i;
+	uint32_t i;
 	size_t sample_count;
 	uint32_t transfer_index;
 
 	if (device->transfers == NULL)
 	{
-		for (i = 0; i < RAW_BUFFER_COUNT; i++)
+		device->received_samples_queue = (uint16_t **)calloc(device->raw_buffer_count, sizeof(uint16_t *));
+		device->dropped_buffers_queue = (uint32_t *)calloc(device->raw_buffer_count, sizeof(uint32_t));
+		device->received_time_queue = (uint64_t *)calloc(device->raw_buffer_count, sizeof(uint64_t));
+		if (device->received_samples_queue == NULL || device->dropped_buffers_queue == NULL || device->received_time_queue == NULL)
+		{
+			return AIRSPY_ERROR_NO_MEM;
+		}
+
+		for (i = 0; i < device->raw_buffer_count; i++)
 		{
 			device->received_samples_queue[i] = (uint16_t *)malloc(device->buffer_size);
 			if (device->received_samples_queue[i] == NULL)
@@ -219,13 +375,9 @@ static int allocate_transfers(airspy_device_t* const device)
 			return AIRSPY_ERROR_NO_MEM;
 		}
 
-		if (device->packing_enabled)
+		if (allocate_unpacked_samples(device, device->sample_type) != AIRSPY_SUCCESS)
 		{
-			device->unpacked_samples = (uint16_t*)malloc(sample_count * sizeof(uint16_t));
-			if (device->unpacked_samples == NULL)
-			{
-				return AIRSPY_ERROR_NO_MEM;
-			}
+			return AIRSPY_ERROR_NO_MEM;
 		}
 
 		device->transfers = (struct libusb_transfer**) calloc(device->transfer_count, sizeof(struct libusb_transfer));
@@ -277,11 +429,17 @@ static int prepare_transfers(airspy_device_t* device, const uint_fast8_t endpoin
 			device->transfers[transfer_index]->endpoint = endpoint_address;
 			device->transfers[transfer_index]->callback = callback;
 
+			if (device->emulated)
+			{
+				continue;
+			}
+
 			error = libusb_submit_transfer(device->transfers[transfer_index]);
 			if (error != 0)
 			{
 				return AIRSPY_ERROR_LIBUSB;
 			}
+			device->active_transfers++;
 		}
 		return AIRSPY_SUCCESS;
 	}
@@ -332,157 +490,1164 @@ static inline void unpack_samples(uint32_t *input, uint16_t *output, int length)
 	}
 }
 
-static void* consumer_threadproc(void *arg)
+/*
+ * Fused unpack + convert for packed mode: every 3 words (12 bytes) carry 8
+ * big-endian 12-bit samples. The SIMD variants gather the two bytes of each
+ * sample with a byte shuffle, then fix up the odd/even nibble alignment.
+ * They read 16 bytes per 12 consumed, so they stop one group early and let
+ * the scalar loop finish the block.
+ */
+
+#ifdef USE_SSSE3_UNPACK
+
+__attribute__((target("ssse3")))
+static int unpack_convert_samples_int16_ssse3(uint32_t *input, int16_t *dest, int length)
 {
-	int sample_count;
-	uint16_t* input_samples;
-	uint32_t dropped_buffers;
-	airspy_device_t* device = (airspy_device_t*)arg;
-	airspy_transfer_t transfer;
+	int j;
+	const uint8_t *src = (const uint8_t *) input;
+	const __m128i shuffle = _mm_setr_epi8(2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9);
+	const __m128i even_mask = _mm_setr_epi16(0x0fff, 0, 0x0fff, 0, 0x0fff, 0, 0x0fff, 0);
+	const __m128i odd_mask = _mm_setr_epi16(0, 0x0fff, 0, 0x0fff, 0, 0x0fff, 0, 0x0fff);
+	const __m128i offset = _mm_set1_epi16(2048);
+
+	for (j = 0; j + 16 <= length; j += 8, src += 12)
+	{
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src), shuffle);
+		v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 4), even_mask), _mm_and_si128(v, odd_mask));
+		v = _mm_slli_epi16(_mm_sub_epi16(v, offset), SAMPLE_SHIFT);
+		_mm_storeu_si128((__m128i *) (dest + j), v);
+	}
+
+	return j;
+}
+
+__attribute__((target("ssse3")))
+static int unpack_convert_samples_float_ssse3(uint32_t *input, float *dest, int length)
+{
+	int j;
+	const uint8_t *src = (const uint8_t *) input;
+	const __m128i shuffle = _mm_setr_epi8(2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9);
+	const __m128i even_mask = _mm_setr_epi16(0x0fff, 0, 0x0fff, 0, 0x0fff, 0, 0x0fff, 0);
+	const __m128i odd_mask = _mm_setr_epi16(0, 0x0fff, 0, 0x0fff, 0, 0x0fff, 0, 0x0fff);
+	const __m128i offset = _mm_set1_epi16(2048);
+	const __m128 scale = _mm_set1_ps(SAMPLE_SCALE);
+
+	for (j = 0; j + 16 <= length; j += 8, src += 12)
+	{
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src), shuffle);
+		v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 4), even_mask), _mm_and_si128(v, odd_mask));
+		v = _mm_sub_epi16(v, offset);
+		_mm_storeu_ps(dest + j, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), scale));
+		_mm_storeu_ps(dest + j + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), scale));
+	}
+
+	return j;
+}
+
+#endif
+
+#ifdef USE_NEON_UNPACK
+
+static const uint8_t unpack_shuffle[16] = { 2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9 };
+static const uint16_t unpack_even_lanes[8] = { 0xffff, 0, 0xffff, 0, 0xffff, 0, 0xffff, 0 };
+
+static inline int16x8_t unpack_samples_neon(const uint8_t *src)
+{
+	uint16x8_t v;
+
+#if defined(__aarch64__)
+	v = vreinterpretq_u16_u8(vqtbl1q_u8(vld1q_u8(src), vld1q_u8(unpack_shuffle)));
+#else
+	uint8x16_t raw = vld1q_u8(src);
+	uint8x8x2_t table = { { vget_low_u8(raw), vget_high_u8(raw) } };
+	v = vreinterpretq_u16_u8(vcombine_u8(vtbl2_u8(table, vld1_u8(unpack_shuffle)), vtbl2_u8(table, vld1_u8(unpack_shuffle + 8))));
+#endif
+
+	v = vbslq_u16(vld1q_u16(unpack_even_lanes), vshrq_n_u16(v, 4), vandq_u16(v, vdupq_n_u16(0x0fff)));
+
+	return vsubq_s16(vreinterpretq_s16_u16(v), vdupq_n_s16(2048));
+}
+
+static int unpack_convert_samples_int16_neon(uint32_t *input, int16_t *dest, int length)
+{
+	int j;
+	const uint8_t *src = (const uint8_t *) input;
+
+	for (j = 0; j + 16 <= length; j += 8, src += 12)
+	{
+		vst1q_s16(dest + j, vshlq_n_s16(unpack_samples_neon(src), SAMPLE_SHIFT));
+	}
+
+	return j;
+}
+
+static int unpack_convert_samples_float_neon(uint32_t *input, float *dest, int length)
+{
+	int j;
+	const uint8_t *src = (const uint8_t *) input;
+
+	for (j = 0; j + 16 <= length; j += 8, src += 12)
+	{
+		int16x8_t v = unpack_samples_neon(src);
+		vst1q_f32(dest + j, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), SAMPLE_SCALE));
+		vst1q_f32(dest + j + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), SAMPLE_SCALE));
+	}
+
+	return j;
+}
+
+#endif
+
+static void unpack_convert_samples_int16(uint32_t *input, int16_t *dest, int length)
+{
+	int i, j;
+	uint16_t samples[8];
+
+	j = 0;
+
+#if defined(USE_SSSE3_UNPACK)
+	if (__builtin_cpu_supports("ssse3"))
+	{
+		j = unpack_convert_samples_int16_ssse3(input, dest, length);
+	}
+#elif defined(USE_NEON_UNPACK)
+	j = unpack_convert_samples_int16_neon(input, dest, length);
+#endif
 
+	for (i = (j / 8) * 3; j < length; i += 3, j += 8)
+	{
+		unpack_samples(input + i, samples, 8);
+		convert_samples_int16(samples, dest + j, 8);
+	}
+}
+
+static void unpack_convert_samples_float(uint32_t *input, float *dest, int length)
+{
+	int i, j;
+	uint16_t samples[8];
+
+	j = 0;
+
+#if defined(USE_SSSE3_UNPACK)
+	if (__builtin_cpu_supports("ssse3"))
+	{
+		j = unpack_convert_samples_float_ssse3(input, dest, length);
+	}
+#elif defined(USE_NEON_UNPACK)
+	j = unpack_convert_samples_float_neon(input, dest, length);
+#endif
+
+	for (i = (j / 8) * 3; j < length; i += 3, j += 8)
+	{
+		unpack_samples(input + i, samples, 8);
+		convert_samples_float(samples, dest + j, 8);
+	}
+}
+
+static uint64_t monotonic_time_us(void)
+{
 #ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
 
-	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return (uint64_t) (counter.QuadPart / frequency.QuadPart) * 1000000 + (uint64_t) (counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+	struct timespec ts;
 
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 #endif
+}
 
-	pthread_mutex_lock(&device->consumer_mp);
+static void record_timing(airspy_timing_stats_t* timing, uint64_t us)
+{
+	uint32_t bin = 0;
+	uint64_t v = us;
 
-	while (device->streaming && !device->stop_requested)
+	while (v > 1 && bin < AIRSPY_STATS_HISTOGRAM_BINS - 1)
 	{
-		while (device->received_buffer_count == 0 && device->streaming && !device->stop_requested)
-		{
-			pthread_cond_wait(&device->consumer_cv, &device->consumer_mp);
-		}
-		if (!device->streaming || device->stop_requested)
-		{
-			break;
-		}
+		v >>= 1;
+		bin++;
+	}
 
-		input_samples = device->received_samples_queue[device->received_samples_queue_tail];
-		dropped_buffers = device->dropped_buffers_queue[device->received_samples_queue_tail];
-		device->received_samples_queue_tail = (device->received_samples_queue_tail + 1) & (RAW_BUFFER_COUNT - 1);
+	timing->count++;
+	timing->total_us += us;
+	if (us > timing->max_us)
+	{
+		timing->max_us = (uint32_t) us;
+	}
+	timing->histogram[bin]++;
+}
 
-		pthread_mutex_unlock(&device->consumer_mp);
+static void merge_timing(airspy_timing_stats_t* dst, const airspy_timing_stats_t* src)
+{
+	int i;
 
-		if (device->packing_enabled)
-		{
-			sample_count = ((device->buffer_size / 2) * 4) / 3;
+	dst->count += src->count;
+	dst->total_us += src->total_us;
+	if (src->max_us > dst->max_us)
+	{
+		dst->max_us = src->max_us;
+	}
+	for (i = 0; i < AIRSPY_STATS_HISTOGRAM_BINS; i++)
+	{
+		dst->histogram[i] += src->histogram[i];
+	}
+}
 
-			if (device->sample_type != AIRSPY_SAMPLE_RAW)
-			{
-				unpack_samples((uint32_t*)input_samples, device->unpacked_samples, sample_count);
+static void convert_raw_int16(airspy_device_t* device, uint16_t *src, int16_t *dest, int count)
+{
+	if (device->packing_enabled)
+	{
+		unpack_convert_samples_int16((uint32_t*)src, dest, count);
+	}
+	else
+	{
+		convert_samples_int16(src, dest, count);
+	}
+}
 
-				input_samples = device->unpacked_samples;
-			}
-		}
-		else
-		{
-			sample_count = device->buffer_size / 2;
-		}
+static void convert_raw_float(airspy_device_t* device, uint16_t *src, float *dest, int count)
+{
+	if (device->packing_enabled)
+	{
+		unpack_convert_samples_float((uint32_t*)src, dest, count);
+	}
+	else
+	{
+		convert_samples_float(src, dest, count);
+	}
+}
 
-		switch (device->sample_type)
-		{
-		case AIRSPY_SAMPLE_FLOAT32_IQ:
-			convert_samples_float(input_samples, (float *)device->output_buffer, sample_count);
-			iqconverter_float_process(device->cnv_f, (float *) device->output_buffer, sample_count);
-			sample_count /= 2;
-			transfer.samples = device->output_buffer;
-			break;
+static int block_sample_count(airspy_device_t* device)
+{
+	if (device->packing_enabled)
+	{
+		return ((device->buffer_size / 2) * 4) / 3;
+	}
 
-		case AIRSPY_SAMPLE_FLOAT32_REAL:
-			convert_samples_float(input_samples, (float *)device->output_buffer, sample_count);
-			transfer.samples = device->output_buffer;
-			break;
+	return device->buffer_size / 2;
+}
 
-		case AIRSPY_SAMPLE_INT16_IQ:
-			convert_samples_int16(input_samples, (int16_t *)device->output_buffer, sample_count);
-			iqconverter_int16_process(device->cnv_i, (int16_t *) device->output_buffer, sample_count);
-			sample_count /= 2;
-			transfer.samples = device->output_buffer;
-			break;
+/*
+ * Zero-copy pool: in pooled mode the USB transfers and the ring share one
+ * block of pool memory, allocated with libusb_dev_mem_alloc() when the
+ * backend supports it. Completed transfers are queued as-is and resubmitted
+ * with a free block. A block is reference counted while the application
+ * holds it and goes back to the free stack once released.
+ */
+
+static inline uint8_t* pool_block(airspy_device_t* device, uint32_t block)
+{
+	return device->pool_memory + (size_t) block * device->pool_block_size;
+}
 
-		case AIRSPY_SAMPLE_INT16_REAL:
-			convert_samples_int16(input_samples, (int16_t *)device->output_buffer, sample_count);
-			transfer.samples = device->output_buffer;
-			break;
+static int pool_block_index(airspy_device_t* device, const void* samples)
+{
+	size_t offset;
 
-		case AIRSPY_SAMPLE_UINT16_REAL:
-		case AIRSPY_SAMPLE_RAW:
-			transfer.samples = input_samples;
-			break;
+	if (device->pool_memory == NULL || (const uint8_t *) samples < device->pool_memory)
+	{
+		return -1;
+	}
 
-		case AIRSPY_SAMPLE_END:
-			// Just to shut GCC's moaning
-			break;
-		}
+	offset = (const uint8_t *) samples - device->pool_memory;
+	if (offset % device->pool_block_size != 0 || offset / device->pool_block_size >= device->pool_block_count)
+	{
+		return -1;
+	}
 
-		transfer.device = device;
-		transfer.ctx = device->ctx;
-		transfer.sample_count = sample_count;
-		transfer.sample_type = device->sample_type;
-		transfer.dropped_samples = (uint64_t) dropped_buffers * (uint64_t) sample_count;
+	return (int) (offset / device->pool_block_size);
+}
 
-		if (device->callback(&transfer) != 0)
-		{
-			device->stop_requested = true;
+static void free_pool(airspy_device_t* device)
+{
+	if (device->pool_memory == NULL)
+	{
+		return;
+	}
+
+	if (device->pool_dev_mem)
+	{
+		libusb_dev_mem_free(device->usb_device, device->pool_memory, (size_t) device->pool_block_count * device->pool_block_size);
+	}
+	else
+	{
+		free(device->pool_memory);
+	}
+
+	device->pool_memory = NULL;
+	device->pool_block_count = 0;
+
+	free(device->pool_refcount);
+	free(device->pool_free_stack);
+	free(device->pool_queue);
+	free(device->pool_saved_buffers);
+	device->pool_refcount = NULL;
+	device->pool_free_stack = NULL;
+	device->pool_queue = NULL;
+	device->pool_saved_buffers = NULL;
+
+	pthread_mutex_destroy(&device->pool_mp);
+}
+
+static int allocate_pool(airspy_device_t* device, uint32_t retained_blocks)
+{
+	uint32_t i;
+	size_t pool_size;
+
+	device->pool_block_count = device->transfer_count + device->raw_buffer_count + retained_blocks;
+	device->pool_block_size = device->buffer_size;
+	pool_size = (size_t) device->pool_block_count * device->pool_block_size;
+
+	device->pool_memory = device->emulated ? NULL : libusb_dev_mem_alloc(device->usb_device, pool_size);
+	device->pool_dev_mem = device->pool_memory != NULL;
+	if (device->pool_memory == NULL)
+	{
+		device->pool_memory = (uint8_t *) malloc(pool_size);
+	}
+
+	device->pool_refcount = (uint32_t *) calloc(device->pool_block_count, sizeof(uint32_t));
+	device->pool_free_stack = (uint32_t *) malloc(device->pool_block_count * sizeof(uint32_t));
+	device->pool_queue = (uint32_t *) calloc(device->raw_buffer_count, sizeof(uint32_t));
+	device->pool_saved_buffers = (uint8_t **) calloc(device->transfer_count, sizeof(uint8_t *));
+	pthread_mutex_init(&device->pool_mp, NULL);
+
+	if (device->pool_memory == NULL || device->pool_refcount == NULL || device->pool_free_stack == NULL ||
+		device->pool_queue == NULL || device->pool_saved_buffers == NULL)
+	{
+		free_pool(device);
+		return AIRSPY_ERROR_NO_MEM;
+	}
+
+	/* The first blocks go to the transfers, the rest start on the free stack */
+	for (i = 0; i < device->transfer_count; i++)
+	{
+		device->pool_saved_buffers[i] = device->transfers[i]->buffer;
+		device->transfers[i]->buffer = pool_block(device, i);
+	}
+
+	device->pool_free_count = 0;
+	for (i = device->pool_block_count; i > device->transfer_count; i--)
+	{
+		device->pool_free_stack[device->pool_free_count++] = i - 1;
+	}
+
+	device->pool_held_count = 0;
+	device->pool_detached = false;
+
+	return AIRSPY_SUCCESS;
+}
+
+/* Called once streaming has stopped: the transfers get their own buffers back and the pool is freed as soon as the application holds no block */
+static void detach_pool(airspy_device_t* device)
+{
+	uint32_t i;
+	bool held;
+
+	for (i = 0; i < device->transfer_count; i++)
+	{
+		device->transfers[i]->buffer = device->pool_saved_buffers[i];
+	}
+
+	pthread_mutex_lock(&device->pool_mp);
+	device->pool_detached = true;
+	held = device->pool_held_count > 0;
+	pthread_mutex_unlock(&device->pool_mp);
+
+	device->pooled = false;
+
+	if (!held)
+	{
+		free_pool(device);
+	}
+}
+
+static int pool_pop_block(airspy_device_t* device)
+{
+	int block = -1;
+
+	pthread_mutex_lock(&device->pool_mp);
+	if (device->pool_free_count > 0)
+	{
+		block = (int) device->pool_free_stack[--device->pool_free_count];
+	}
+	pthread_mutex_unlock(&device->pool_mp);
+
+	return block;
+}
+
+static void pool_acquire_block(airspy_device_t* device, uint32_t block)
+{
+	pthread_mutex_lock(&device->pool_mp);
+	device->pool_refcount[block] = 1;
+	device->pool_held_count++;
+	pthread_mutex_unlock(&device->pool_mp);
+}
+
+static int pool_release_block(airspy_device_t* device, uint32_t block)
+{
+	bool release_pool = false;
+
+	pthread_mutex_lock(&device->pool_mp);
+
+	if (device->pool_refcount[block] == 0)
+	{
+		pthread_mutex_unlock(&device->pool_mp);
+		return AIRSPY_ERROR_INVALID_PARAM;
+	}
+
+	if (--device->pool_refcount[block] == 0)
+	{
+		device->pool_free_stack[device->pool_free_count++] = block;
+		device->pool_held_count--;
+		release_pool = device->pool_detached && device->pool_held_count == 0;
+	}
+
+	pthread_mutex_unlock(&device->pool_mp);
+
+	if (release_pool)
+	{
+		free_pool(device);
+	}
+
+	return AIRSPY_SUCCESS;
+}
+
+static bool wait_for_samples(airspy_device_t* device, uint32_t tail)
+{
+	int spin;
+
+	for (spin = 0; spin < CONSUMER_SPIN_COUNT; spin++)
+	{
+		if (ATOMIC_LOAD(&device->received_samples_queue_head) != tail)
+		{
+			return true;
+		}
+
+		if (!device->streaming || device->stop_requested)
+		{
+			return false;
+		}
+
+		sched_yield();
+	}
+
+	pthread_mutex_lock(&device->consumer_mp);
+
+	ATOMIC_STORE(&device->consumer_waiting, 1);
+
+	while (ATOMIC_LOAD(&device->received_samples_queue_head) == tail && device->streaming && !device->stop_requested)
+	{
+		pthread_cond_wait(&device->consumer_cv, &device->consumer_mp);
+	}
+
+	ATOMIC_STORE(&device->consumer_waiting, 0);
+
+	pthread_mutex_unlock(&device->consumer_mp);
+
+	return device->streaming && !device->stop_requested;
+}
+
+static void* consumer_threadproc(void *arg)
+{
+	int sample_count;
+	uint16_t* input_samples;
+	uint32_t dropped_buffers;
+	uint32_t tail;
+	uint32_t index;
+	uint32_t pool_index = 0;
+	uint64_t start_us;
+	uint64_t convert_us;
+	uint64_t filter_us;
+	uint64_t callback_us;
+	airspy_device_t* device = (airspy_device_t*)arg;
+	airspy_transfer_t transfer;
+
+#ifdef _WIN32
+
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+#endif
+
+	while (device->streaming && !device->stop_requested)
+	{
+		tail = device->received_samples_queue_tail;
+
+		if (!wait_for_samples(device, tail))
+		{
+			break;
+		}
+
+		index = tail & (device->raw_buffer_count - 1);
+		dropped_buffers = device->dropped_buffers_queue[index];
+
+		start_us = monotonic_time_us();
+		convert_us = 0;
+		filter_us = 0;
+		record_timing(&device->stats.latency, start_us - device->received_time_queue[index]);
+
+		if (device->pooled)
+		{
+			pool_index = device->pool_queue[index];
+			pool_acquire_block(device, pool_index);
+			input_samples = (uint16_t *) pool_block(device, pool_index);
+		}
+		else
+		{
+			input_samples = device->received_samples_queue[index];
+		}
+
+		sample_count = block_sample_count(device);
+
+		if (device->packing_enabled && device->sample_type == AIRSPY_SAMPLE_UINT16_REAL)
+		{
+			unpack_samples((uint32_t*)input_samples, device->unpacked_samples, sample_count);
+
+			input_samples = device->unpacked_samples;
+			convert_us = monotonic_time_us();
+		}
+
+		switch (device->sample_type)
+		{
+		case AIRSPY_SAMPLE_FLOAT32_IQ:
+			convert_raw_float(device, input_samples, (float *)device->output_buffer, sample_count);
+			convert_us = monotonic_time_us();
+			iqconverter_float_process(device->cnv_f, (float *) device->output_buffer, sample_count);
+			sample_count = iqconverter_float_decimate(device->cnv_f, (float *) device->output_buffer, sample_count);
+			filter_us = monotonic_time_us();
+			sample_count /= 2;
+			transfer.samples = device->output_buffer;
+			break;
+
+		case AIRSPY_SAMPLE_FLOAT32_REAL:
+			convert_raw_float(device, input_samples, (float *)device->output_buffer, sample_count);
+			convert_us = monotonic_time_us();
+			transfer.samples = device->output_buffer;
+			break;
+
+		case AIRSPY_SAMPLE_INT16_IQ:
+			convert_raw_int16(device, input_samples, (int16_t *)device->output_buffer, sample_count);
+			convert_us = monotonic_time_us();
+			iqconverter_int16_process(device->cnv_i, (int16_t *) device->output_buffer, sample_count);
+			filter_us = monotonic_time_us();
+			sample_count /= 2;
+			transfer.samples = device->output_buffer;
+			break;
+
+		case AIRSPY_SAMPLE_INT16_REAL:
+			convert_raw_int16(device, input_samples, (int16_t *)device->output_buffer, sample_count);
+			convert_us = monotonic_time_us();
+			transfer.samples = device->output_buffer;
+			break;
+
+		case AIRSPY_SAMPLE_UINT16_REAL:
+		case AIRSPY_SAMPLE_RAW:
+			transfer.samples = input_samples;
+			break;
+
+		case AIRSPY_SAMPLE_END:
+			// Just to shut GCC's moaning
+			break;
+		}
+
+		transfer.device = device;
+		transfer.ctx = device->ctx;
+		transfer.sample_count = sample_count;
+		transfer.sample_type = device->sample_type;
+		transfer.dropped_samples = (uint64_t) dropped_buffers * (uint64_t) sample_count;
+
+		if (convert_us != 0)
+		{
+			record_timing(&device->stats.convert, convert_us - start_us);
+		}
+
+		if (filter_us != 0)
+		{
+			record_timing(&device->stats.filter, filter_us - convert_us);
+		}
+
+		device->stats.dropped_samples += transfer.dropped_samples;
+
+		callback_us = monotonic_time_us();
+
+		if (device->callback(&transfer) != 0)
+		{
+			device->stop_requested = true;
+		}
+
+		record_timing(&device->stats.callback, monotonic_time_us() - callback_us);
+
+		if (device->pooled)
+		{
+			pool_release_block(device, pool_index);
+		}
+
+		/* The next transfer may swap its buffer into this slot from here on */
+		ATOMIC_STORE(&device->received_samples_queue_tail, tail + 1);
+	}
+
+	pthread_exit(NULL);
+
+	return NULL;
+}
+
+/*
+ * Pipeline mode: the consumer thread hands consecutive IQ blocks to a pool of
+ * worker threads and delivers the results to the user callback in order.
+ * Each worker runs its own converter from a reset state over the last
+ * PIPELINE_OVERLAP samples of the previous block followed by the new block,
+ * so the FIR, delay line and DC filter are settled when the new block starts.
+ * Raw buffers stay owned by the ring until their block has been delivered.
+ */
+
+static void pipeline_process_job(airspy_device_t* device, pipeline_job_t* job)
+{
+	int total_count = PIPELINE_OVERLAP + job->sample_count;
+	uint64_t start_us = monotonic_time_us();
+	uint64_t convert_us;
+
+	if (device->sample_type == AIRSPY_SAMPLE_FLOAT32_IQ)
+	{
+		float *output = (float *) job->output_buffer;
+
+		if (job->has_overlap)
+		{
+			convert_raw_float(device, (uint16_t *) job->overlap_samples, output, PIPELINE_OVERLAP);
+		}
+		else
+		{
+			memset(output, 0, PIPELINE_OVERLAP * sizeof(float));
+		}
+
+		convert_raw_float(device, job->input_samples, output + PIPELINE_OVERLAP, job->sample_count);
+		convert_us = monotonic_time_us();
+
+		iqconverter_float_reset(job->cnv_f);
+		iqconverter_float_process(job->cnv_f, output, total_count);
+		iqconverter_float_decimate(job->cnv_f, output, total_count);
+	}
+	else
+	{
+		int16_t *output = (int16_t *) job->output_buffer;
+
+		if (job->has_overlap)
+		{
+			convert_raw_int16(device, (uint16_t *) job->overlap_samples, output, PIPELINE_OVERLAP);
+		}
+		else
+		{
+			memset(output, 0, PIPELINE_OVERLAP * sizeof(int16_t));
+		}
+
+		convert_raw_int16(device, job->input_samples, output + PIPELINE_OVERLAP, job->sample_count);
+		convert_us = monotonic_time_us();
+
+		iqconverter_int16_reset(job->cnv_i);
+		iqconverter_int16_process(job->cnv_i, output, total_count);
+	}
+
+	record_timing(&job->convert_stats, convert_us - start_us);
+	record_timing(&job->filter_stats, monotonic_time_us() - convert_us);
+}
+
+static void* pipeline_worker_threadproc(void *arg)
+{
+	pipeline_job_t* job = (pipeline_job_t*)arg;
+	airspy_device_t* device = job->device;
+
+	pthread_mutex_lock(&device->pipeline_mp);
+
+	while (!device->pipeline_stop)
+	{
+		if (job->state != PIPELINE_JOB_PENDING)
+		{
+			pthread_cond_wait(&job->cv, &device->pipeline_mp);
+			continue;
+		}
+
+		pthread_mutex_unlock(&device->pipeline_mp);
+
+		pipeline_process_job(device, job);
+
+		pthread_mutex_lock(&device->pipeline_mp);
+		job->state = PIPELINE_JOB_DONE;
+		pthread_cond_broadcast(&job->cv);
+	}
+
+	pthread_mutex_unlock(&device->pipeline_mp);
+
+	pthread_exit(NULL);
+
+	return NULL;
+}
+
+static void* pipeline_consumer_threadproc(void *arg)
+{
+	uint32_t tail;
+	uint32_t index;
+	uint32_t in_flight;
+	uint32_t oldest;
+	uint16_t *input_samples;
+	size_t overlap_size;
+	int sample_count;
+	uint64_t callback_us;
+	pipeline_job_t* job;
+	airspy_device_t* device = (airspy_device_t*)arg;
+	airspy_transfer_t transfer;
+
+#ifdef _WIN32
+
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+
+#endif
+
+	in_flight = 0;
+	oldest = 0;
+	sample_count = block_sample_count(device);
+	overlap_size = device->packing_enabled ? (PIPELINE_OVERLAP * 3) / 2 : PIPELINE_OVERLAP * sizeof(uint16_t);
+
+	while (device->streaming && !device->stop_requested)
+	{
+		tail = device->received_samples_queue_tail;
+
+		if (in_flight > 0 && (in_flight == device->pipeline_job_count || ATOMIC_LOAD(&device->received_samples_queue_head) == tail + in_flight))
+		{
+			/* Pool full or nothing new to dispatch: deliver the oldest block */
+			job = &device->pipeline_jobs[oldest];
+
+			pthread_mutex_lock(&device->pipeline_mp);
+			while (job->state != PIPELINE_JOB_DONE && !device->pipeline_stop)
+			{
+				pthread_cond_wait(&job->cv, &device->pipeline_mp);
+			}
+			pthread_mutex_unlock(&device->pipeline_mp);
+
+			if (job->state != PIPELINE_JOB_DONE)
+			{
+				break;
+			}
+
+			if (device->sample_type == AIRSPY_SAMPLE_FLOAT32_IQ)
+			{
+				/* The overlap and the block are a multiple of 2^stages samples, so the block starts right after the decimated overlap */
+				transfer.samples = (float *) job->output_buffer + (PIPELINE_OVERLAP >> device->decimation_stages);
+				transfer.sample_count = (job->sample_count / 2) >> device->decimation_stages;
+			}
+			else
+			{
+				transfer.samples = (int16_t *) job->output_buffer + PIPELINE_OVERLAP;
+				transfer.sample_count = job->sample_count / 2;
+			}
+
+			transfer.device = device;
+			transfer.ctx = device->ctx;
+			transfer.sample_type = device->sample_type;
+			transfer.dropped_samples = (uint64_t) job->dropped_buffers * (uint64_t) transfer.sample_count;
+
+			device->stats.dropped_samples += transfer.dropped_samples;
+
+			callback_us = monotonic_time_us();
+			record_timing(&device->stats.latency, callback_us - device->received_time_queue[tail & (device->raw_buffer_count - 1)]);
+
+			if (device->callback(&transfer) != 0)
+			{
+				device->stop_requested = true;
+			}
+
+			record_timing(&device->stats.callback, monotonic_time_us() - callback_us);
+
+			job->state = PIPELINE_JOB_IDLE;
+			oldest = (oldest + 1) % device->pipeline_job_count;
+			in_flight--;
+
+			ATOMIC_STORE(&device->received_samples_queue_tail, tail + 1);
+			continue;
+		}
+
+		if (!wait_for_samples(device, tail + in_flight))
+		{
+			break;
+		}
+
+		index = (tail + in_flight) & (device->raw_buffer_count - 1);
+		input_samples = device->received_samples_queue[index];
+
+		job = &device->pipeline_jobs[(oldest + in_flight) % device->pipeline_job_count];
+		job->input_samples = input_samples;
+		job->dropped_buffers = device->dropped_buffers_queue[index];
+		job->sample_count = sample_count;
+		job->has_overlap = device->pipeline_has_carry;
+		memcpy(job->overlap_samples, device->pipeline_carry, overlap_size);
+
+		memcpy(device->pipeline_carry, (uint8_t *) input_samples + device->buffer_size - overlap_size, overlap_size);
+		device->pipeline_has_carry = true;
+
+		pthread_mutex_lock(&device->pipeline_mp);
+		job->state = PIPELINE_JOB_PENDING;
+		pthread_cond_broadcast(&job->cv);
+		pthread_mutex_unlock(&device->pipeline_mp);
+
+		in_flight++;
+	}
+
+	pthread_exit(NULL);
+
+	return NULL;
+}
+
+static void free_pipeline(airspy_device_t* device)
+{
+	uint32_t i;
+	pipeline_job_t* job;
+
+	if (device->pipeline_jobs != NULL)
+	{
+		for (i = 0; i < device->pipeline_job_count; i++)
+		{
+			job = &device->pipeline_jobs[i];
+
+			merge_timing(&device->stats.convert, &job->convert_stats);
+			merge_timing(&device->stats.filter, &job->filter_stats);
+
+			free(job->overlap_samples);
+			free(job->output_buffer);
+
+			if (job->cnv_f != NULL)
+			{
+				iqconverter_float_free(job->cnv_f);
+			}
+
+			if (job->cnv_i != NULL)
+			{
+				iqconverter_int16_free(job->cnv_i);
+			}
+
+			pthread_cond_destroy(&job->cv);
+		}
+
+		free(device->pipeline_jobs);
+		device->pipeline_jobs = NULL;
+		device->pipeline_job_count = 0;
+
+		pthread_mutex_destroy(&device->pipeline_mp);
+	}
+
+	free(device->pipeline_carry);
+	device->pipeline_carry = NULL;
+}
+
+static int allocate_pipeline(airspy_device_t* device)
+{
+	uint32_t i;
+	size_t output_size;
+	pipeline_job_t* job;
+
+	output_size = (PIPELINE_OVERLAP + block_sample_count(device)) * sizeof(float);
+
+	device->pipeline_jobs = (pipeline_job_t *) calloc(device->worker_count, sizeof(pipeline_job_t));
+	device->pipeline_carry = (uint8_t *) calloc(PIPELINE_OVERLAP, sizeof(uint16_t));
+	if (device->pipeline_jobs == NULL || device->pipeline_carry == NULL)
+	{
+		return AIRSPY_ERROR_NO_MEM;
+	}
+
+	device->pipeline_job_count = device->worker_count;
+	device->pipeline_has_carry = false;
+	device->pipeline_stop = false;
+	pthread_mutex_init(&device->pipeline_mp, NULL);
+
+	for (i = 0; i < device->pipeline_job_count; i++)
+	{
+		job = &device->pipeline_jobs[i];
+		job->device = device;
+		job->state = PIPELINE_JOB_IDLE;
+		pthread_cond_init(&job->cv, NULL);
+
+		job->overlap_samples = (uint8_t *) malloc(PIPELINE_OVERLAP * sizeof(uint16_t));
+		job->output_buffer = malloc(output_size);
+		if (job->overlap_samples == NULL || job->output_buffer == NULL)
+		{
+			return AIRSPY_ERROR_NO_MEM;
+		}
+
+		if (device->sample_type == AIRSPY_SAMPLE_FLOAT32_IQ)
+		{
+			job->cnv_f = iqconverter_float_clone(device->cnv_f);
+		}
+		else
+		{
+			job->cnv_i = iqconverter_int16_clone(device->cnv_i);
+		}
+	}
+
+	return AIRSPY_SUCCESS;
+}
+
+static void stop_pipeline_workers(airspy_device_t* device, uint32_t count)
+{
+	uint32_t i;
+
+	pthread_mutex_lock(&device->pipeline_mp);
+	device->pipeline_stop = true;
+	for (i = 0; i < device->pipeline_job_count; i++)
+	{
+		pthread_cond_broadcast(&device->pipeline_jobs[i].cv);
+	}
+	pthread_mutex_unlock(&device->pipeline_mp);
+
+	for (i = 0; i < count; i++)
+	{
+		pthread_join(device->pipeline_jobs[i].thread, NULL);
+	}
+}
+
+/* A transfer the callback does not resubmit is back in our hands */
+static void retire_transfer(airspy_device_t* device)
+{
+	if (!device->emulated)
+	{
+		device->active_transfers--;
+	}
+}
+
+static void airspy_libusb_transfer_callback(struct libusb_transfer* usb_transfer)
+{
+	uint16_t *temp;
+	uint32_t head;
+	uint32_t index;
+	uint32_t depth;
+	int free_block = 0;
+	airspy_device_t* device = (airspy_device_t*)usb_transfer->user_data;
+
+	if (!device->streaming || device->stop_requested)
+	{
+		retire_transfer(device);
+		return;
+	}
+
+	if (usb_transfer->status == LIBUSB_TRANSFER_COMPLETED && usb_transfer->actual_length == usb_transfer->length)
+	{
+		head = device->received_samples_queue_head;
+		device->stats.received_buffers++;
+
+		if (device->pooled && head - ATOMIC_LOAD(&device->received_samples_queue_tail) < device->raw_buffer_count)
+		{
+			free_block = pool_pop_block(device);
+		}
+
+		if (head - ATOMIC_LOAD(&device->received_samples_queue_tail) < device->raw_buffer_count && free_block >= 0)
+		{
+			index = head & (device->raw_buffer_count - 1);
+
+			if (device->pooled)
+			{
+				device->pool_queue[index] = (uint32_t) pool_block_index(device, usb_transfer->buffer);
+				usb_transfer->buffer = pool_block(device, (uint32_t) free_block);
+			}
+			else
+			{
+				temp = device->received_samples_queue[index];
+				device->received_samples_queue[index] = (uint16_t *)usb_transfer->buffer;
+				usb_transfer->buffer = (uint8_t *)temp;
+			}
+
+			device->dropped_buffers_queue[index] = device->dropped_buffers;
+			device->dropped_buffers = 0;
+			device->received_time_queue[index] = monotonic_time_us();
+
+			depth = head + 1 - ATOMIC_LOAD(&device->received_samples_queue_tail);
+			if (depth > device->stats.queue_depth_max)
+			{
+				device->stats.queue_depth_max = depth;
+			}
+
+			ATOMIC_STORE(&device->received_samples_queue_head, head + 1);
+
+			if (ATOMIC_LOAD(&device->consumer_waiting))
+			{
+				pthread_mutex_lock(&device->consumer_mp);
+				pthread_cond_signal(&device->consumer_cv);
+				pthread_mutex_unlock(&device->consumer_mp);
+			}
+		}
+		else
+		{
+			device->dropped_buffers++;
+			device->stats.dropped_buffers++;
+		}
+
+		if (!device->emulated && libusb_submit_transfer(usb_transfer) != 0)
+		{
+			retire_transfer(device);
+			device->stop_requested = true;
+		}
+	}
+	else
+	{
+		retire_transfer(device);
+		device->stop_requested = true;
+	}
+}
+
+/*
+ * Emulated device: no USB handle is opened. Control requests succeed
+ * without doing anything, and a generator thread stands in for libusb
+ * event handling. That thread completes the transfers in turn with a
+ * precomputed block and runs them through airspy_libusb_transfer_callback(),
+ * so the ring, the drop accounting and the consumer thread are the real
+ * ones.
+ */
+
+static int airspy_control_transfer(airspy_device_t* device, uint8_t request_type, uint8_t request, uint16_t value, uint16_t index, unsigned char* data, uint16_t length, unsigned int timeout)
+{
+	uint32_t samplerate;
+
+	if (!device->emulated)
+	{
+		return libusb_control_transfer(device->usb_device, request_type, request, value, index, data, length, timeout);
+	}
+
+	if (request == AIRSPY_SET_SAMPLERATE)
+	{
+		/* Either an index into the samplerate list or a real samplerate in kHz, see airspy_set_samplerate() */
+		if (index < device->supported_samplerate_count)
+		{
+			samplerate = device->supported_samplerates[index] * 2;
+		}
+		else
+		{
+			samplerate = index * 1000;
+		}
+
+		device->emulated_samplerate = samplerate;
+	}
+
+	if ((request_type & LIBUSB_ENDPOINT_IN) && data != NULL)
+	{
+		memset(data, 0, length);
+	}
+
+	return length;
+}
+
+static void emulation_sleep_us(uint64_t us)
+{
+#ifdef _WIN32
+	Sleep((DWORD) (us / 1000));
+#else
+	struct timespec ts;
+
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * 1000;
+	nanosleep(&ts, NULL);
+#endif
+}
+
+/* One block of a deterministic test signal: a tone at fs/64 plus LCG noise, 12-bit offset binary, packed when packing is enabled */
+static int create_emulated_block(airspy_device_t* device)
+{
+	int i;
+	int sample_count;
+	uint32_t seed = 0x12345678;
+	uint16_t *samples;
+	uint32_t *packed;
+	static const int16_t tone[8] = { 0, 383, 707, 924, 1000, 924, 707, 383 };
+
+	free(device->emulated_block);
+
+	sample_count = block_sample_count(device);
+
+	device->emulated_block = (uint8_t *) malloc(device->buffer_size);
+	samples = (uint16_t *) malloc(sample_count * sizeof(uint16_t));
+	if (device->emulated_block == NULL || samples == NULL)
+	{
+		free(samples);
+		return AIRSPY_ERROR_NO_MEM;
+	}
+
+	for (i = 0; i < sample_count; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		samples[i] = (uint16_t) (2048 + ((i & 32) ? -tone[(i >> 2) & 7] : tone[(i >> 2) & 7]) + (int) ((seed >> 24) & 0x3f) - 32);
+	}
+
+	if (device->packing_enabled)
+	{
+		packed = (uint32_t *) device->emulated_block;
+
+		for (i = 0; i < sample_count; i += 8, packed += 3)
+		{
+			packed[0] = ((uint32_t) samples[i + 0] << 20) | ((uint32_t) samples[i + 1] << 8) | (samples[i + 2] >> 4);
+			packed[1] = ((uint32_t) (samples[i + 2] & 0xf) << 28) | ((uint32_t) samples[i + 3] << 16) | ((uint32_t) samples[i + 4] << 4) | (samples[i + 5] >> 8);
+			packed[2] = ((uint32_t) (samples[i + 5] & 0xff) << 24) | ((uint32_t) samples[i + 6] << 12) | samples[i + 7];
 		}
-
-		pthread_mutex_lock(&device->consumer_mp);
-		device->received_buffer_count--;
+	}
+	else
+	{
+		memcpy(device->emulated_block, samples, device->buffer_size);
 	}
 
-	pthread_mutex_unlock(&device->consumer_mp);
-
-	pthread_exit(NULL);
+	free(samples);
 
-	return NULL;
+	return AIRSPY_SUCCESS;
 }
 
-static void airspy_libusb_transfer_callback(struct libusb_transfer* usb_transfer)
+static void* emulated_transfer_threadproc(void* arg)
 {
-	uint16_t *temp;
-	airspy_device_t* device = (airspy_device_t*)usb_transfer->user_data;
+	airspy_device_t* device = (airspy_device_t*)arg;
+	struct libusb_transfer* usb_transfer;
+	uint32_t transfer_index = 0;
+	uint64_t block_count = 0;
+	uint64_t start_us;
+	uint64_t due_us;
+	uint64_t now_us;
+	int sample_count;
 
-	if (!device->streaming || device->stop_requested)
-	{
-		return;
-	}
+#ifdef _WIN32
 
-	if (usb_transfer->status == LIBUSB_TRANSFER_COMPLETED && usb_transfer->actual_length == usb_transfer->length)
-	{
-		pthread_mutex_lock(&device->consumer_mp);
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
 
-		if (device->received_buffer_count < RAW_BUFFER_COUNT)
-		{
-			temp = device->received_samples_queue[device->received_samples_queue_head];
-			device->received_samples_queue[device->received_samples_queue_head] = (uint16_t *)usb_transfer->buffer;
-			usb_transfer->buffer = (uint8_t *)temp;
+#endif
 
-			device->dropped_buffers_queue[device->received_samples_queue_head] = device->dropped_buffers;
-			device->dropped_buffers = 0;
-			
-			device->received_samples_queue_head = (device->received_samples_queue_head + 1) & (RAW_BUFFER_COUNT - 1);
-			device->received_buffer_count++;
+	sample_count = block_sample_count(device);
+	start_us = monotonic_time_us();
 
-			pthread_cond_signal(&device->consumer_cv);
-		}
-		else
+	while (device->streaming && !device->stop_requested)
+	{
+		if (device->emulated_throttle && device->emulated_samplerate > 0)
 		{
-			device->dropped_buffers++;
+			due_us = start_us + block_count * sample_count * 1000000 / device->emulated_samplerate;
+			now_us = monotonic_time_us();
+			if (due_us > now_us)
+			{
+				emulation_sleep_us(due_us - now_us);
+			}
 		}
 
-		pthread_mutex_unlock(&device->consumer_mp);
+		block_count++;
 
-		if (libusb_submit_transfer(usb_transfer) != 0)
+		if (device->emulated_stall_every > 0 && block_count % device->emulated_stall_every == 0)
 		{
-			device->stop_requested = true;
+			emulation_sleep_us(device->emulated_stall_us);
 		}
+
+		usb_transfer = device->transfers[transfer_index];
+		memcpy(usb_transfer->buffer, device->emulated_block, device->buffer_size);
+		usb_transfer->status = LIBUSB_TRANSFER_COMPLETED;
+		usb_transfer->actual_length = usb_transfer->length;
+
+		airspy_libusb_transfer_callback(usb_transfer);
+
+		transfer_index = (transfer_index + 1) % device->transfer_count;
 	}
-	else
-	{
-		device->stop_requested = true;
-	}
+
+	pthread_exit(NULL);
+
+	return NULL;
 }
 
 static void* transfer_threadproc(void* arg)
@@ -514,8 +1679,6 @@ static void* transfer_threadproc(void* arg)
 
 static int kill_io_threads(airspy_device_t* device)
 {
-	struct timeval timeout = { 0, 0 };
-
 	if (device->streaming)
 	{
 		device->stop_requested = true;
@@ -525,10 +1688,28 @@ static int kill_io_threads(airspy_device_t* device)
 		pthread_cond_signal(&device->consumer_cv);
 		pthread_mutex_unlock(&device->consumer_mp);
 
+		if (device->pipeline_jobs != NULL)
+		{
+			stop_pipeline_workers(device, device->pipeline_job_count);
+		}
+
 		pthread_join(device->transfer_thread, NULL);
 		pthread_join(device->consumer_thread, NULL);
 
-		libusb_handle_events_timeout_completed(device->usb_context, &timeout, NULL);
+		free_pipeline(device);
+
+		if (wait_for_transfers(device) != AIRSPY_SUCCESS && device->pooled)
+		{
+			/* The kernel may still write into the pool, keep it allocated for good */
+			pthread_mutex_lock(&device->pool_mp);
+			device->pool_held_count++;
+			pthread_mutex_unlock(&device->pool_mp);
+		}
+
+		if (device->pooled)
+		{
+			detach_pool(device);
+		}
 
 		device->stop_requested = false;
 		device->streaming = false;
@@ -540,7 +1721,9 @@ static int kill_io_threads(airspy_device_t* device)
 static int create_io_threads(airspy_device_t* device, airspy_sample_block_cb_fn callback)
 {
 	int result;
+	uint32_t i;
 	pthread_attr_t attr;
+	void* (*consumer_proc)(void *);
 
 	if (!device->streaming && !device->stop_requested)
 	{
@@ -555,18 +1738,51 @@ static int create_io_threads(airspy_device_t* device, airspy_sample_block_cb_fn
 
 		device->received_samples_queue_head = 0;
 		device->received_samples_queue_tail = 0;
-		device->received_buffer_count = 0;
+		device->consumer_waiting = 0;
 
 		pthread_attr_init(&attr);
 		pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
 
-		result = pthread_create(&device->consumer_thread, &attr, consumer_threadproc, device);
+		consumer_proc = consumer_threadproc;
+
+		if (device->worker_count > 0 && SAMPLE_TYPE_IS_IQ(device->sample_type))
+		{
+			if (allocate_pipeline(device) != AIRSPY_SUCCESS)
+			{
+				free_pipeline(device);
+				return AIRSPY_ERROR_NO_MEM;
+			}
+
+			for (i = 0; i < device->pipeline_job_count; i++)
+			{
+				result = pthread_create(&device->pipeline_jobs[i].thread, &attr, pipeline_worker_threadproc, &device->pipeline_jobs[i]);
+				if (result != 0)
+				{
+					stop_pipeline_workers(device, i);
+					free_pipeline(device);
+					return AIRSPY_ERROR_THREAD;
+				}
+			}
+
+			consumer_proc = pipeline_consumer_threadproc;
+		}
+
+		result = pthread_create(&device->consumer_thread, &attr, consumer_proc, device);
 		if (result != 0)
 		{
 			return AIRSPY_ERROR_THREAD;
 		}
 
-		result = pthread_create(&device->transfer_thread, &attr, transfer_threadproc, device);
+		if (device->emulated)
+		{
+			result = create_emulated_block(device);
+			if (result != AIRSPY_SUCCESS)
+			{
+				return result;
+			}
+		}
+
+		result = pthread_create(&device->transfer_thread, &attr, device->emulated ? emulated_transfer_threadproc : transfer_threadproc, device);
 		if (result != 0)
 		{
 			return AIRSPY_ERROR_THREAD;
@@ -589,8 +1805,11 @@ static void airspy_open_exit(airspy_device_t* device)
 		libusb_close(device->usb_device);
 		device->usb_device = NULL;
 	}
-	libusb_exit(device->usb_context);
-	device->usb_context = NULL;
+	if (device->usb_context != NULL)
+	{
+		libusb_exit(device->usb_context);
+		device->usb_context = NULL;
+	}
 }
 
 static void airspy_open_device(airspy_device_t* device,
@@ -796,8 +2015,8 @@ static int airspy_read_samplerates_from_fw(struct airspy_device* device, uint32_
 {
 	int result;
 
-	result = libusb_control_transfer(
-		device->usb_device,
+	result = airspy_control_transfer(
+		device,
 		LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 		AIRSPY_GET_SAMPLERATES,
 		0,
@@ -851,6 +2070,7 @@ static int airspy_open_init(airspy_device_t** device, uint64_t serial_number)
 	lib_device->callback = NULL;
 	lib_device->transfer_count = 16;
 	lib_device->buffer_size = 262144;
+	lib_device->raw_buffer_count = RAW_BUFFER_COUNT;
 	lib_device->packing_enabled = false;
 	lib_device->streaming = false;
 	lib_device->stop_requested = false;
@@ -932,6 +2152,7 @@ static int airspy_open_init_fd(airspy_device_t** device, int fd)
 	lib_device->callback = NULL;
 	lib_device->transfer_count = 16;
 	lib_device->buffer_size = 262144;
+	lib_device->raw_buffer_count = RAW_BUFFER_COUNT;
 	lib_device->packing_enabled = false;
 	lib_device->streaming = false;
 	lib_device->stop_requested = false;
@@ -1109,6 +2330,81 @@ int airspy_list_devices(uint64_t *serials, int count)
 		return result;
 	}
 
+	int ADDCALL airspy_open_emulated(airspy_device_t** device)
+	{
+		int result;
+		airspy_device_t* lib_device;
+
+		*device = NULL;
+
+		lib_device = (airspy_device_t*)calloc(1, sizeof(airspy_device_t));
+		if (lib_device == NULL)
+		{
+			return AIRSPY_ERROR_NO_MEM;
+		}
+
+		lib_device->emulated = true;
+		lib_device->emulated_throttle = true;
+		lib_device->emulated_samplerate = EMULATED_SAMPLERATE_DEFAULT;
+		lib_device->transfers = NULL;
+		lib_device->callback = NULL;
+		lib_device->transfer_count = 16;
+		lib_device->buffer_size = 262144;
+		lib_device->raw_buffer_count = RAW_BUFFER_COUNT;
+		lib_device->packing_enabled = false;
+		lib_device->streaming = false;
+		lib_device->stop_requested = false;
+		lib_device->sample_type = AIRSPY_SAMPLE_FLOAT32_IQ;
+
+		lib_device->supported_samplerate_count = 2;
+		lib_device->supported_samplerates = (uint32_t *) malloc(lib_device->supported_samplerate_count * sizeof(uint32_t));
+		if (lib_device->supported_samplerates == NULL)
+		{
+			free(lib_device);
+			return AIRSPY_ERROR_NO_MEM;
+		}
+		lib_device->supported_samplerates[0] = 10000000;
+		lib_device->supported_samplerates[1] = 2500000;
+
+		result = allocate_transfers(lib_device);
+		if (result != 0)
+		{
+			free_transfers(lib_device);
+			free(lib_device->supported_samplerates);
+			free(lib_device);
+			return AIRSPY_ERROR_NO_MEM;
+		}
+
+		lib_device->cnv_f = iqconverter_float_create(HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN);
+		lib_device->cnv_i = iqconverter_int16_create(HB_KERNEL_INT16, HB_KERNEL_INT16_LEN);
+
+		pthread_cond_init(&lib_device->consumer_cv, NULL);
+		pthread_mutex_init(&lib_device->consumer_mp, NULL);
+
+		*device = lib_device;
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_set_emulation(airspy_device_t* device, uint8_t throttle, uint32_t stall_every, uint32_t stall_us)
+	{
+		if (!device->emulated)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		if (device->streaming)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		device->emulated_throttle = throttle ? true : false;
+		device->emulated_stall_every = stall_every;
+		device->emulated_stall_us = stall_us;
+
+		return AIRSPY_SUCCESS;
+	}
+
 	int ADDCALL airspy_close(airspy_device_t* device)
 	{
 		int result;
@@ -1125,7 +2421,13 @@ int airspy_list_devices(uint64_t *serials, int count)
 			pthread_cond_destroy(&device->consumer_cv);
 			pthread_mutex_destroy(&device->consumer_mp);
 
-			free_transfers(device);
+			/* Leak rather than free buffers a late completion could still write to */
+			if (wait_for_transfers(device) == AIRSPY_SUCCESS)
+			{
+				free_pool(device);
+				free_transfers(device);
+			}
+			free(device->emulated_block);
 			airspy_open_exit(device);
 			free(device->supported_samplerates);
 			free(device);
@@ -1190,12 +2492,15 @@ int airspy_list_devices(uint64_t *serials, int count)
 			}
 		}
 
-		libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		if (!device->emulated)
+		{
+			libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		}
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_SAMPLERATE,
 			0,
@@ -1217,8 +2522,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	int ADDCALL airspy_set_receiver_mode(airspy_device_t* device, receiver_mode_t value)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_RECEIVER_MODE,
 			value,
@@ -1244,8 +2549,9 @@ int airspy_list_devices(uint64_t *serials, int count)
 		iqconverter_float_reset(device->cnv_f);
 		iqconverter_int16_reset(device->cnv_i);
 
-		memset(device->dropped_buffers_queue, 0, RAW_BUFFER_COUNT * sizeof(uint32_t));
+		memset(device->dropped_buffers_queue, 0, device->raw_buffer_count * sizeof(uint32_t));
 		device->dropped_buffers = 0;
+		memset(&device->stats, 0, sizeof(device->stats));
 
 		result = airspy_set_receiver_mode(device, RECEIVER_MODE_OFF);
 		if (result != AIRSPY_SUCCESS)
@@ -1253,7 +2559,10 @@ int airspy_list_devices(uint64_t *serials, int count)
 			return result;
 		}
 
-		libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		if (!device->emulated)
+		{
+			libusb_clear_halt(device->usb_device, LIBUSB_ENDPOINT_IN | 1);
+		}
 
 		result = airspy_set_receiver_mode(device, RECEIVER_MODE_RX);
 		if (result == AIRSPY_SUCCESS)
@@ -1265,6 +2574,80 @@ int airspy_list_devices(uint64_t *serials, int count)
 		return result;
 	}
 
+	int ADDCALL airspy_start_rx_pooled(airspy_device_t* device, airspy_sample_block_cb_fn callback, void* ctx, uint32_t retained_blocks)
+	{
+		int result;
+
+		if (device->streaming || device->pool_memory != NULL)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		if (device->sample_type != AIRSPY_SAMPLE_RAW && (device->sample_type != AIRSPY_SAMPLE_UINT16_REAL || device->packing_enabled))
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		if (retained_blocks > POOL_RETAINED_BLOCKS_MAX)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		result = allocate_pool(device, retained_blocks);
+		if (result != AIRSPY_SUCCESS)
+		{
+			return result;
+		}
+
+		device->pooled = true;
+
+		result = airspy_start_rx(device, callback, ctx);
+		if (result != AIRSPY_SUCCESS && !device->streaming)
+		{
+			detach_pool(device);
+		}
+
+		return result;
+	}
+
+	int ADDCALL airspy_retain_block(airspy_device_t* device, void* samples)
+	{
+		int block;
+
+		block = pool_block_index(device, samples);
+		if (block < 0)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		pthread_mutex_lock(&device->pool_mp);
+
+		if (device->pool_refcount[block] == 0)
+		{
+			pthread_mutex_unlock(&device->pool_mp);
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		device->pool_refcount[block]++;
+
+		pthread_mutex_unlock(&device->pool_mp);
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_release_block(airspy_device_t* device, void* samples)
+	{
+		int block;
+
+		block = pool_block_index(device, samples);
+		if (block < 0)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		return pool_release_block(device, (uint32_t) block);
+	}
+
 	int ADDCALL airspy_stop_rx(airspy_device_t* device)
 	{
 		int result1, result2;
@@ -1284,8 +2667,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		int result;
 
 		temp_value = 0;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SI5351C_READ,
 			0,
@@ -1308,8 +2691,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SI5351C_WRITE,
 			value,
@@ -1331,8 +2714,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_R820T_READ,
 			0,
@@ -1354,8 +2737,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_R820T_WRITE,
 			value,
@@ -1381,8 +2764,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_GPIO_READ,
 			0,
@@ -1408,8 +2791,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_GPIO_WRITE,
 			value,
@@ -1436,8 +2819,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_GPIODIR_READ,
 			0,
@@ -1463,8 +2846,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		port_pin = ((uint8_t)port) << 5;
 		port_pin = port_pin | pin;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_GPIODIR_WRITE,
 			value,
@@ -1485,8 +2868,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	int ADDCALL airspy_spiflash_erase(airspy_device_t* device)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SPIFLASH_ERASE,
 			0,
@@ -1507,8 +2890,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	int ADDCALL airspy_spiflash_erase_sector(airspy_device_t* device, const uint16_t sector_num)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SPIFLASH_ERASE_SECTOR,
 			sector_num,
@@ -1535,8 +2918,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 			return AIRSPY_ERROR_INVALID_PARAM;
 		}
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SPIFLASH_WRITE,
 			address >> 16,
@@ -1558,8 +2941,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	{
 		int result;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SPIFLASH_READ,
 			address >> 16,
@@ -1580,8 +2963,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 	int ADDCALL airspy_board_id_read(airspy_device_t* device, uint8_t* value)
 	{
 		int result;
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_BOARD_ID_READ,
 			0,
@@ -1605,8 +2988,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		int result;
 		char version_local[VERSION_LOCAL_SIZE];
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_VERSION_STRING_READ,
 			0,
@@ -1640,8 +3023,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		int result;
 
 		length = sizeof(airspy_read_partid_serialno_t);
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_BOARD_PARTID_SERIALNO_READ,
 			0,
@@ -1669,6 +3052,12 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 	int ADDCALL airspy_set_sample_type(struct airspy_device* device, enum airspy_sample_type sample_type)
 	{
+		/* The unpack buffer must exist before the sample path can see the new type */
+		if (allocate_unpacked_samples(device, sample_type) != AIRSPY_SUCCESS)
+		{
+			return AIRSPY_ERROR_NO_MEM;
+		}
+
 		device->sample_type = sample_type;
 		return AIRSPY_SUCCESS;
 	}
@@ -1682,8 +3071,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 		set_freq_params.freq_hz = TO_LE(freq_hz);
 		length = sizeof(set_freq_params_t);
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_FREQ,
 			0,
@@ -1711,6 +3100,7 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		iqconverter_float_free(device->cnv_f);
 		device->cnv_f = iqconverter_float_create(kernel, len);
+		iqconverter_float_set_decimation(device->cnv_f, HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN, device->decimation_stages);
 
 		return AIRSPY_SUCCESS;
 	}
@@ -1739,8 +3129,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_LNA_GAIN,
 			0,
@@ -1770,8 +3160,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_MIXER_GAIN,
 			0,
@@ -1801,8 +3191,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_VGA_GAIN,
 			0,
@@ -1829,8 +3219,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_LNA_AGC,
 			0,
@@ -1857,8 +3247,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 
 		length = 1;
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_MIXER_AGC,
 			0,
@@ -1950,6 +3340,28 @@ int airspy_list_devices(uint64_t *serials, int count)
 		return airspy_gpio_write(device, GPIO_PORT1, GPIO_PIN13, value);
 	}
 
+	int ADDCALL airspy_set_decimation(airspy_device_t* device, uint32_t decimation)
+	{
+		uint32_t stages;
+
+		if (device->streaming)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		for (stages = 0; stages <= IQCONVERTER_DECIMATION_STAGES_MAX; stages++)
+		{
+			if (decimation == (1u << stages))
+			{
+				device->decimation_stages = stages;
+				iqconverter_float_set_decimation(device->cnv_f, HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN, stages);
+				return AIRSPY_SUCCESS;
+			}
+		}
+
+		return AIRSPY_ERROR_INVALID_PARAM;
+	}
+
 	int ADDCALL airspy_set_packing(airspy_device_t* device, uint8_t value)
 	{
 		int result;
@@ -1961,8 +3373,8 @@ int airspy_list_devices(uint64_t *serials, int count)
 			return AIRSPY_ERROR_BUSY;
 		}
 
-		result = libusb_control_transfer(
-			device->usb_device,
+		result = airspy_control_transfer(
+			device,
 			LIBUSB_ENDPOINT_IN | LIBUSB_REQUEST_TYPE_VENDOR | LIBUSB_RECIPIENT_DEVICE,
 			AIRSPY_SET_PACKING,
 			0,
@@ -1980,6 +3392,10 @@ int airspy_list_devices(uint64_t *serials, int count)
 		if (packing_enabled != device->packing_enabled)
 		{
 			cancel_transfers(device);
+			if (wait_for_transfers(device) != AIRSPY_SUCCESS)
+			{
+				return AIRSPY_ERROR_BUSY;
+			}
 			free_transfers(device);
 
 			device->packing_enabled = packing_enabled;
@@ -1995,6 +3411,81 @@ int airspy_list_devices(uint64_t *serials, int count)
 		return AIRSPY_SUCCESS;
 	}
 
+	int ADDCALL airspy_set_buffer_count(airspy_device_t* device, uint32_t count)
+	{
+		if (device->streaming)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		if (count < 2 || count > RAW_BUFFER_COUNT_MAX || (count & (count - 1)) != 0)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		if (count != device->raw_buffer_count)
+		{
+			cancel_transfers(device);
+			if (wait_for_transfers(device) != AIRSPY_SUCCESS)
+			{
+				return AIRSPY_ERROR_BUSY;
+			}
+			free_transfers(device);
+
+			device->raw_buffer_count = count;
+
+			if (allocate_transfers(device) != 0)
+			{
+				return AIRSPY_ERROR_NO_MEM;
+			}
+		}
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_set_worker_threads(airspy_device_t* device, uint32_t count)
+	{
+		if (device->streaming)
+		{
+			return AIRSPY_ERROR_BUSY;
+		}
+
+		if (count > WORKER_THREADS_MAX)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		device->worker_count = count;
+
+		return AIRSPY_SUCCESS;
+	}
+
+	int ADDCALL airspy_get_stream_stats(airspy_device_t* device, airspy_stream_stats_t* stats)
+	{
+		uint32_t i;
+
+		if (stats == NULL)
+		{
+			return AIRSPY_ERROR_INVALID_PARAM;
+		}
+
+		/* Lock free snapshot: counters being updated concurrently may be one block apart */
+		memcpy(stats, &device->stats, sizeof(airspy_stream_stats_t));
+
+		stats->queue_depth = device->streaming ? ATOMIC_LOAD(&device->received_samples_queue_head) - ATOMIC_LOAD(&device->received_samples_queue_tail) : 0;
+
+		if (device->streaming && device->pipeline_jobs != NULL)
+		{
+			for (i = 0; i < device->pipeline_job_count; i++)
+			{
+				merge_timing(&stats->convert, &device->pipeline_jobs[i].convert_stats);
+				merge_timing(&stats->filter, &device->pipeline_jobs[i].filter_stats);
+			}
+		}
+
+		return AIRSPY_SUCCESS;
+	}
+
 	int ADDCALL airspy_is_streaming(airspy_device_t* device)
 	{
 		return (device->streaming == true && device->stop_requested == false);
@@ -115,6 +115,28 @@ typedef struct {
 	uint32_t revision;
 } airspy_lib_version_t;
 
+/* Histogram bin i counts durations in [2^i, 2^(i+1)) microseconds, bin 0 also counts 0 us and the last bin is open ended */
+#define AIRSPY_STATS_HISTOGRAM_BINS 16
+
+typedef struct {
+	uint64_t count;
+	uint64_t total_us;
+	uint32_t max_us;
+	uint32_t histogram[AIRSPY_STATS_HISTOGRAM_BINS];
+} airspy_timing_stats_t;
+
+typedef struct {
+	uint64_t received_buffers; /* USB transfers completed */
+	uint64_t dropped_buffers;  /* Transfers discarded because the queue was full */
+	uint64_t dropped_samples;  /* Sum of dropped_samples reported to the callback */
+	uint32_t queue_depth;      /* Blocks waiting for the consumer */
+	uint32_t queue_depth_max;
+	airspy_timing_stats_t latency;  /* USB completion to callback */
+	airspy_timing_stats_t convert;  /* Unpacking and conversion to float/int16 */
+	airspy_timing_stats_t filter;   /* IQ conversion: DC removal, fs/4 translation, FIR and decimation */
+	airspy_timing_stats_t callback; /* Time spent in the user callback */
+} airspy_stream_stats_t;
+
 typedef int (*airspy_sample_block_cb_fn)(airspy_transfer* transfer);
 
 extern ADDAPI void ADDCALL airspy_lib_version(airspy_lib_version_t* lib_version);
@@ -128,6 +150,13 @@ extern ADDAPI int ADDCALL airspy_list_devices(uint64_t *serials, int count);
 extern ADDAPI int ADDCALL airspy_open_sn(struct airspy_device** device, uint64_t serial_number);
 extern ADDAPI int ADDCALL airspy_open(struct airspy_device** device);
 extern ADDAPI int ADDCALL airspy_open_fd(struct airspy_device** device, int fd);
+
+/* Software-emulated device without USB: a deterministic test signal is generated at the selected samplerate (or as fast as possible)
+   and goes through the same ring, conversion and consumer thread as real transfers. Control requests succeed without effect */
+extern ADDAPI int ADDCALL airspy_open_emulated(struct airspy_device** device);
+/* Emulated devices only. Parameter throttle: 1 paces blocks at the samplerate, 0 generates them as fast as possible.
+   Every stall_every blocks (0 disables) the producer stalls for stall_us microseconds */
+extern ADDAPI int ADDCALL airspy_set_emulation(struct airspy_device* device, uint8_t throttle, uint32_t stall_every, uint32_t stall_us);
 extern ADDAPI int ADDCALL airspy_close(struct airspy_device* device);
 
 /* Use airspy_get_samplerates(device, buffer, 0) to get the number of available sample rates. It will be returned in the first element of buffer */
@@ -139,12 +168,28 @@ extern ADDAPI int ADDCALL airspy_set_samplerate(struct airspy_device* device, ui
 extern ADDAPI int ADDCALL airspy_set_conversion_filter_float32(struct airspy_device* device, const float *kernel, const uint32_t len);
 extern ADDAPI int ADDCALL airspy_set_conversion_filter_int16(struct airspy_device* device, const int16_t *kernel, const uint32_t len);
 
+/* Parameter decimation shall be 1, 2, 4, 8 or 16: AIRSPY_SAMPLE_FLOAT32_IQ output is decimated by a cascade of half-band filters, 1 (default) disables it.
+   Callbacks then deliver decimation times fewer samples per block */
+extern ADDAPI int ADDCALL airspy_set_decimation(struct airspy_device* device, uint32_t decimation);
+
 extern ADDAPI int ADDCALL airspy_start_rx(struct airspy_device* device, airspy_sample_block_cb_fn callback, void* rx_ctx);
+
+/* Zero-copy variant of airspy_start_rx() for AIRSPY_SAMPLE_RAW, or AIRSPY_SAMPLE_UINT16_REAL with packing disabled.
+   transfer->samples points straight into the USB buffer pool. The callback may keep the block past its return with
+   airspy_retain_block() and give it back later with airspy_release_block(), from any thread.
+   Parameter retained_blocks (up to 1024) is the number of blocks the application may hold at once; incoming blocks are dropped when the pool runs dry.
+   Stop with airspy_stop_rx(). Every retained block shall be released before the next airspy_start_rx_pooled() or airspy_close() */
+extern ADDAPI int ADDCALL airspy_start_rx_pooled(struct airspy_device* device, airspy_sample_block_cb_fn callback, void* rx_ctx, uint32_t retained_blocks);
+extern ADDAPI int ADDCALL airspy_retain_block(struct airspy_device* device, void* samples);
+extern ADDAPI int ADDCALL airspy_release_block(struct airspy_device* device, void* samples);
 extern ADDAPI int ADDCALL airspy_stop_rx(struct airspy_device* device);
 
 /* return AIRSPY_TRUE if success */
 extern ADDAPI int ADDCALL airspy_is_streaming(struct airspy_device* device);
 
+/* Counters are reset by airspy_start_rx() and kept after airspy_stop_rx(). Cheap enough to poll while streaming */
+extern ADDAPI int ADDCALL airspy_get_stream_stats(struct airspy_device* device, airspy_stream_stats_t* stats);
+
 extern ADDAPI int ADDCALL airspy_si5351c_write(struct airspy_device* device, uint8_t register_number, uint8_t value);
 extern ADDAPI int ADDCALL airspy_si5351c_read(struct airspy_device* device, uint8_t register_number, uint8_t* value);
 
@@ -210,6 +255,14 @@ extern ADDAPI int ADDCALL airspy_set_rf_bias(struct airspy_device* dev, uint8_t
 /* Parameter value shall be 0=Disable Packing or 1=Enable Packing */
 extern ADDAPI int ADDCALL airspy_set_packing(struct airspy_device* device, uint8_t value);
 
+/* Parameter count is the number of buffers queued between the USB and consumer threads (default 8).
+   It shall be a power of two between 2 and 256 and can only be changed while not streaming */
+extern ADDAPI int ADDCALL airspy_set_buffer_count(struct airspy_device* device, uint32_t count);
+
+/* Parameter count shall be between 0 and 8: number of worker threads converting IQ blocks in parallel.
+   0 (default) converts on the consumer thread. Blocks are still delivered to the callback in order */
+extern ADDAPI int ADDCALL airspy_set_worker_threads(struct airspy_device* device, uint32_t count);
+
 extern ADDAPI const char* ADDCALL airspy_error_name(enum airspy_error errcode);
 extern ADDAPI const char* ADDCALL airspy_board_id_name(enum airspy_board_id board_id);
 
@@ -39,8 +39,6 @@ THE SOFTWARE.
   #define _inline inline
   #define FIR_STANDARD
 #elif defined(__FreeBSD__)
-  #define USE_SSE2
-#include <immintrin.h>
   #define _inline inline
   #define _aligned_free(mem) free(mem)
 void *_aligned_malloc(size_t size, size_t alignment)
@@ -62,6 +60,16 @@ void *_aligned_malloc(size_t size, size_t alignment)
 	#endif
 #endif
 
+#if defined(__GNUC__) && defined(__SSE2__)
+  #define USE_SSE2
+  #include <immintrin.h>
+  /* AVX2 kernels are built with a target attribute and selected at runtime */
+  #define USE_AVX2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define USE_NEON
+  #include <arm_neon.h>
+#endif
+
 #define SIZE_FACTOR 32
 #define DEFAULT_ALIGNMENT 16
 #define HPF_COEFF 0.01f
@@ -72,6 +80,183 @@ void *_aligned_malloc(size_t size, size_t alignment)
 	#define ALIGNED
 #endif
 
+static int detect_simd(void)
+{
+#ifdef USE_AVX2
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return IQCONVERTER_SIMD_AVX2;
+	}
+#endif
+
+#if defined(USE_SSE2)
+	return IQCONVERTER_SIMD_SSE2;
+#elif defined(USE_NEON)
+	return IQCONVERTER_SIMD_NEON;
+#else
+	return IQCONVERTER_SIMD_NONE;
+#endif
+}
+
+/*
+ * Optional cascade of half-band decimators run on the IQ output.
+ * Each stage keeps a linear history of the last span-1 complex samples;
+ * the input is copied behind it in chunks so the outputs can be written
+ * back in place at half the rate.
+ */
+
+#define DECIMATION_CHUNK 1024
+
+static void free_decimation(iqconverter_float_t *cnv)
+{
+	int i;
+
+	for (i = 0; i < IQCONVERTER_DECIMATION_STAGES_MAX; i++)
+	{
+		if (cnv->dec_history[i] != NULL)
+		{
+			_aligned_free(cnv->dec_history[i]);
+			cnv->dec_history[i] = NULL;
+		}
+	}
+
+	if (cnv->dec_kernel != NULL)
+	{
+		_aligned_free(cnv->dec_kernel);
+		cnv->dec_kernel = NULL;
+	}
+
+	cnv->dec_stages = 0;
+}
+
+static void reset_decimation(iqconverter_float_t *cnv)
+{
+	int i;
+	int span;
+
+	if (cnv->dec_stages == 0)
+	{
+		return;
+	}
+
+	span = 2 * cnv->dec_len - 1;
+
+	for (i = 0; i < cnv->dec_stages; i++)
+	{
+		memset(cnv->dec_history[i], 0, (span - 1) * 2 * sizeof(float));
+		cnv->dec_history_count[i] = span - 1;
+	}
+}
+
+void iqconverter_float_set_decimation(iqconverter_float_t *cnv, const float *hb_kernel, int len, int stages)
+{
+	int i;
+	int span;
+
+	free_decimation(cnv);
+
+	if (stages <= 0)
+	{
+		return;
+	}
+
+	if (stages > IQCONVERTER_DECIMATION_STAGES_MAX)
+	{
+		stages = IQCONVERTER_DECIMATION_STAGES_MAX;
+	}
+
+	cnv->dec_len = len / 2 + 1;
+	cnv->dec_hbc = hb_kernel[len / 2];
+	cnv->dec_kernel = (float *) _aligned_malloc(cnv->dec_len * sizeof(float), DEFAULT_ALIGNMENT);
+
+	for (i = 0; i < cnv->dec_len; i++)
+	{
+		cnv->dec_kernel[i] = hb_kernel[i * 2];
+	}
+
+	span = 2 * cnv->dec_len - 1;
+
+	for (i = 0; i < stages; i++)
+	{
+		cnv->dec_history[i] = (float *) _aligned_malloc((span + DECIMATION_CHUNK) * 2 * sizeof(float), DEFAULT_ALIGNMENT);
+	}
+
+	cnv->dec_stages = stages;
+
+	reset_decimation(cnv);
+}
+
+static int decimate_stage(iqconverter_float_t *cnv, int stage, float *samples, int count)
+{
+	int i, p, chunk;
+	int out = 0;
+	int taps = cnv->dec_len;
+	int span = 2 * taps - 1;
+	int n = cnv->dec_history_count[stage];
+	float hbc = cnv->dec_hbc;
+	float acc_i, acc_q;
+	const float *kernel = cnv->dec_kernel;
+	const float *input = samples;
+	float *history = cnv->dec_history[stage];
+	const float *x;
+
+	while (count > 0)
+	{
+		chunk = count < DECIMATION_CHUNK ? count : DECIMATION_CHUNK;
+
+		memcpy(history + n * 2, input, chunk * 2 * sizeof(float));
+		input += chunk * 2;
+		count -= chunk;
+		n += chunk;
+
+		for (p = 0; p + span <= n; p += 2)
+		{
+			x = history + p * 2;
+
+			/* Odd taps are zero except the center one; the kernel is symmetric */
+			acc_i = hbc * x[(taps - 1) * 2];
+			acc_q = hbc * x[(taps - 1) * 2 + 1];
+
+			for (i = 0; i < taps / 2; i++)
+			{
+				acc_i += kernel[i] * (x[i * 4] + x[(taps - 1 - i) * 4]);
+				acc_q += kernel[i] * (x[i * 4 + 1] + x[(taps - 1 - i) * 4 + 1]);
+			}
+
+			if (taps & 1)
+			{
+				acc_i += kernel[taps / 2] * x[(taps / 2) * 4];
+				acc_q += kernel[taps / 2] * x[(taps / 2) * 4 + 1];
+			}
+
+			samples[out * 2] = acc_i;
+			samples[out * 2 + 1] = acc_q;
+			out++;
+		}
+
+		memmove(history, history + p * 2, (n - p) * 2 * sizeof(float));
+		n -= p;
+	}
+
+	cnv->dec_history_count[stage] = n;
+
+	return out;
+}
+
+int iqconverter_float_decimate(iqconverter_float_t *cnv, float *samples, int len)
+{
+	int i;
+	int count = len / 2;
+
+	for (i = 0; i < cnv->dec_stages; i++)
+	{
+		count = decimate_stage(cnv, i, samples, count);
+	}
+
+	return count * 2;
+}
+
 iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len)
 {
 	int i, j;
@@ -80,12 +265,17 @@ iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len)
 
 	cnv->len = len / 2 + 1;
 	cnv->hbc = hb_kernel[len / 2];
+	cnv->simd = detect_simd();
+	cnv->dec_stages = 0;
+	cnv->dec_len = 0;
+	cnv->dec_kernel = NULL;
+	memset(cnv->dec_history, 0, sizeof(cnv->dec_history));
 
 	buffer_size = cnv->len * sizeof(float);
 
 	cnv->fir_kernel = (float *) _aligned_malloc(buffer_size, DEFAULT_ALIGNMENT);
 	cnv->fir_queue = (float *) _aligned_malloc(buffer_size * SIZE_FACTOR, DEFAULT_ALIGNMENT);
-	cnv->delay_line = (float *) _aligned_malloc(buffer_size / 2, DEFAULT_ALIGNMENT);
+	cnv->delay_line = (float *) _aligned_malloc(buffer_size, DEFAULT_ALIGNMENT);
 
 	iqconverter_float_reset(cnv);
 
@@ -97,8 +287,52 @@ iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len)
 	return cnv;
 }
 
+iqconverter_float_t *iqconverter_float_clone(const iqconverter_float_t *src)
+{
+	int i;
+	size_t buffer_size;
+	iqconverter_float_t *cnv = (iqconverter_float_t *) _aligned_malloc(sizeof(iqconverter_float_t), DEFAULT_ALIGNMENT);
+
+	cnv->len = src->len;
+	cnv->hbc = src->hbc;
+	cnv->simd = src->simd;
+	cnv->dec_stages = 0;
+	cnv->dec_len = 0;
+	cnv->dec_kernel = NULL;
+	memset(cnv->dec_history, 0, sizeof(cnv->dec_history));
+
+	buffer_size = cnv->len * sizeof(float);
+
+	cnv->fir_kernel = (float *) _aligned_malloc(buffer_size, DEFAULT_ALIGNMENT);
+	cnv->fir_queue = (float *) _aligned_malloc(buffer_size * SIZE_FACTOR, DEFAULT_ALIGNMENT);
+	cnv->delay_line = (float *) _aligned_malloc(buffer_size, DEFAULT_ALIGNMENT);
+
+	iqconverter_float_reset(cnv);
+
+	memcpy(cnv->fir_kernel, src->fir_kernel, buffer_size);
+
+	if (src->dec_stages > 0)
+	{
+		cnv->dec_stages = src->dec_stages;
+		cnv->dec_len = src->dec_len;
+		cnv->dec_hbc = src->dec_hbc;
+		cnv->dec_kernel = (float *) _aligned_malloc(cnv->dec_len * sizeof(float), DEFAULT_ALIGNMENT);
+		memcpy(cnv->dec_kernel, src->dec_kernel, cnv->dec_len * sizeof(float));
+
+		for (i = 0; i < cnv->dec_stages; i++)
+		{
+			cnv->dec_history[i] = (float *) _aligned_malloc((2 * cnv->dec_len - 1 + DECIMATION_CHUNK) * 2 * sizeof(float), DEFAULT_ALIGNMENT);
+		}
+
+		reset_decimation(cnv);
+	}
+
+	return cnv;
+}
+
 void iqconverter_float_free(iqconverter_float_t *cnv)
 {
+	free_decimation(cnv);
 	_aligned_free(cnv->fir_kernel);
 	_aligned_free(cnv->fir_queue);
 	_aligned_free(cnv->delay_line);
@@ -112,6 +346,7 @@ void iqconverter_float_reset(iqconverter_float_t *cnv)
 	cnv->delay_index = 0;
 	memset(cnv->delay_line, 0, cnv->len * sizeof(float) / 2);
 	memset(cnv->fir_queue, 0, cnv->len * sizeof(float) * SIZE_FACTOR);
+	reset_decimation(cnv);
 }
 
 static _inline float process_fir_taps(const float *kernel, const float *queue, int len)
@@ -134,22 +369,22 @@ static _inline float process_fir_taps(const float *kernel, const float *queue, i
 
 #ifdef USE_SSE2
 
-		for (i = 0; i < it; i++)
-		{
-			__m128 head1 = _mm_loadu_ps(queue);
-			__m128 kern1 = _mm_load_ps(kernel);
-			__m128 head2 = _mm_loadu_ps(queue + 4);
-			__m128 kern2 = _mm_load_ps(kernel + 4);
-
-			__m128 mul1 = _mm_mul_ps(kern1, head1);
-			__m128 mul2 = _mm_mul_ps(kern2, head2);
-
-			mul1 = _mm_add_ps(mul1, mul2);
-
-			acc = _mm_add_ps(acc, mul1);
-
-			queue += 8;
-			kernel += 8;
+		for (i = 0; i < it; i++)
+		{
+			__m128 head1 = _mm_loadu_ps(queue);
+			__m128 kern1 = _mm_load_ps(kernel);
+			__m128 head2 = _mm_loadu_ps(queue + 4);
+			__m128 kern2 = _mm_load_ps(kernel + 4);
+
+			__m128 mul1 = _mm_mul_ps(kern1, head1);
+			__m128 mul2 = _mm_mul_ps(kern2, head2);
+
+			mul1 = _mm_add_ps(mul1, mul2);
+
+			acc = _mm_add_ps(acc, mul1);
+
+			queue += 8;
+			kernel += 8;
 		}
 
 #else
@@ -163,9 +398,9 @@ static _inline float process_fir_taps(const float *kernel, const float *queue, i
 				+ kernel[4] * queue[4]
 				+ kernel[5] * queue[5]
 				+ kernel[6] * queue[6]
-				+ kernel[7] * queue[7];
-
-			queue += 8;
+				+ kernel[7] * queue[7];
+
+			queue += 8;
 			kernel += 8;
 		}
 
@@ -178,8 +413,8 @@ static _inline float process_fir_taps(const float *kernel, const float *queue, i
 
 #ifdef USE_SSE2
 
-		__m128 head = _mm_loadu_ps(queue);
-		__m128 kern = _mm_load_ps(kernel);
+		__m128 head = _mm_loadu_ps(queue);
+		__m128 kern = _mm_load_ps(kernel);
 		__m128 mul = _mm_mul_ps(kern, head);
 		acc = _mm_add_ps(acc, mul);
 
@@ -195,18 +430,14 @@ static _inline float process_fir_taps(const float *kernel, const float *queue, i
 		kernel += 4;
 		queue += 4;
 		len &= 3;
-	}
-
+	}
+
 #ifdef USE_SSE2
-
-	__m128 t = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+
+	__m128 t = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
 	acc = _mm_add_ss(t, _mm_shuffle_ps(t, t, 1));
 
-#ifdef __FreeBSD__
-	float sum = acc[0];
-#else
-	float sum = acc.m128_f32[0];
-#endif
+	float sum = _mm_cvtss_f32(acc);
 
 #endif
 
@@ -395,8 +626,230 @@ static void fir_interleaved_generic(iqconverter_float_t *cnv, float *samples, in
 	cnv->fir_index = fir_index;
 }
 
+/*
+ * SIMD FIR variants: fir_queue holds the last (len - 1) input samples in
+ * chronological order followed by a chunk of new samples, so that several
+ * consecutive outputs are computed per vector without horizontal sums.
+ * The taps are folded and summed in the same order as fir_interleaved_N(),
+ * with separate multiplies and adds, so the output is bit-identical to the
+ * scalar filters. Only the folded lengths 4, 8, 12 and 24 use them.
+ */
+
+static _inline float fir_folded_tap(const float *kernel, const float *x, int len)
+{
+	int j;
+	float acc = kernel[0] * (x[len - 1] + x[0]);
+
+	for (j = 1; j < len / 2; j++)
+	{
+		acc += kernel[j] * (x[len - 1 - j] + x[j]);
+	}
+
+	return acc;
+}
+
+#ifdef USE_SSE2
+
+static void fir_interleaved_sse2(iqconverter_float_t *cnv, float *samples, int len)
+{
+	int i, j, m, count;
+	int fir_len = cnv->len;
+	int chunk_len = fir_len * (SIZE_FACTOR - 1);
+	const float *fir_kernel = cnv->fir_kernel;
+	float *history = cnv->fir_queue;
+	float *chunk = history + fir_len - 1;
+	ALIGNED float res[8];
+
+	for (i = 0; i < len; i += count * 2)
+	{
+		count = (len - i + 1) / 2;
+		if (count > chunk_len)
+		{
+			count = chunk_len;
+		}
+
+		for (m = 0; m < count; m++)
+		{
+			chunk[m] = samples[i + m * 2];
+		}
+
+		for (m = 0; m + 8 <= count; m += 8)
+		{
+			const float *x = history + m;
+			__m128 kern = _mm_set1_ps(fir_kernel[0]);
+			__m128 acc0 = _mm_mul_ps(kern, _mm_add_ps(_mm_loadu_ps(x + fir_len - 1), _mm_loadu_ps(x)));
+			__m128 acc1 = _mm_mul_ps(kern, _mm_add_ps(_mm_loadu_ps(x + fir_len + 3), _mm_loadu_ps(x + 4)));
+
+			for (j = 1; j < fir_len / 2; j++)
+			{
+				kern = _mm_set1_ps(fir_kernel[j]);
+				acc0 = _mm_add_ps(acc0, _mm_mul_ps(kern, _mm_add_ps(_mm_loadu_ps(x + fir_len - 1 - j), _mm_loadu_ps(x + j))));
+				acc1 = _mm_add_ps(acc1, _mm_mul_ps(kern, _mm_add_ps(_mm_loadu_ps(x + fir_len + 3 - j), _mm_loadu_ps(x + j + 4))));
+			}
+
+			_mm_storeu_ps(res, acc0);
+			_mm_storeu_ps(res + 4, acc1);
+
+			for (j = 0; j < 8; j++)
+			{
+				samples[i + (m + j) * 2] = res[j];
+			}
+		}
+
+		for (; m < count; m++)
+		{
+			samples[i + m * 2] = fir_folded_tap(fir_kernel, history + m, fir_len);
+		}
+
+		memmove(history, history + count, (fir_len - 1) * sizeof(float));
+	}
+}
+
+#endif
+
+#ifdef USE_AVX2
+
+/* No FMA on purpose: fused products would round differently from the scalar filters */
+__attribute__((target("avx2")))
+static void fir_interleaved_avx2(iqconverter_float_t *cnv, float *samples, int len)
+{
+	int i, j, m, count;
+	int fir_len = cnv->len;
+	int chunk_len = fir_len * (SIZE_FACTOR - 1);
+	const float *fir_kernel = cnv->fir_kernel;
+	float *history = cnv->fir_queue;
+	float *chunk = history + fir_len - 1;
+	ALIGNED float res[16];
+
+	for (i = 0; i < len; i += count * 2)
+	{
+		count = (len - i + 1) / 2;
+		if (count > chunk_len)
+		{
+			count = chunk_len;
+		}
+
+		for (m = 0; m < count; m++)
+		{
+			chunk[m] = samples[i + m * 2];
+		}
+
+		for (m = 0; m + 16 <= count; m += 16)
+		{
+			const float *x = history + m;
+			__m256 kern = _mm256_broadcast_ss(fir_kernel);
+			__m256 acc0 = _mm256_mul_ps(kern, _mm256_add_ps(_mm256_loadu_ps(x + fir_len - 1), _mm256_loadu_ps(x)));
+			__m256 acc1 = _mm256_mul_ps(kern, _mm256_add_ps(_mm256_loadu_ps(x + fir_len + 7), _mm256_loadu_ps(x + 8)));
+
+			for (j = 1; j < fir_len / 2; j++)
+			{
+				kern = _mm256_broadcast_ss(fir_kernel + j);
+				acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(kern, _mm256_add_ps(_mm256_loadu_ps(x + fir_len - 1 - j), _mm256_loadu_ps(x + j))));
+				acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(kern, _mm256_add_ps(_mm256_loadu_ps(x + fir_len + 7 - j), _mm256_loadu_ps(x + j + 8))));
+			}
+
+			_mm256_storeu_ps(res, acc0);
+			_mm256_storeu_ps(res + 8, acc1);
+
+			for (j = 0; j < 16; j++)
+			{
+				samples[i + (m + j) * 2] = res[j];
+			}
+		}
+
+		for (; m < count; m++)
+		{
+			samples[i + m * 2] = fir_folded_tap(fir_kernel, history + m, fir_len);
+		}
+
+		memmove(history, history + count, (fir_len - 1) * sizeof(float));
+	}
+}
+
+#endif
+
+#ifdef USE_NEON
+
+static void fir_interleaved_neon(iqconverter_float_t *cnv, float *samples, int len)
+{
+	int i, j, m, count;
+	int fir_len = cnv->len;
+	int chunk_len = fir_len * (SIZE_FACTOR - 1);
+	const float *fir_kernel = cnv->fir_kernel;
+	float *history = cnv->fir_queue;
+	float *chunk = history + fir_len - 1;
+	ALIGNED float res[8];
+
+	for (i = 0; i < len; i += count * 2)
+	{
+		count = (len - i + 1) / 2;
+		if (count > chunk_len)
+		{
+			count = chunk_len;
+		}
+
+		for (m = 0; m < count; m++)
+		{
+			chunk[m] = samples[i + m * 2];
+		}
+
+		for (m = 0; m + 8 <= count; m += 8)
+		{
+			const float *x = history + m;
+			float32x4_t acc0 = vmulq_n_f32(vaddq_f32(vld1q_f32(x + fir_len - 1), vld1q_f32(x)), fir_kernel[0]);
+			float32x4_t acc1 = vmulq_n_f32(vaddq_f32(vld1q_f32(x + fir_len + 3), vld1q_f32(x + 4)), fir_kernel[0]);
+
+			for (j = 1; j < fir_len / 2; j++)
+			{
+				acc0 = vaddq_f32(acc0, vmulq_n_f32(vaddq_f32(vld1q_f32(x + fir_len - 1 - j), vld1q_f32(x + j)), fir_kernel[j]));
+				acc1 = vaddq_f32(acc1, vmulq_n_f32(vaddq_f32(vld1q_f32(x + fir_len + 3 - j), vld1q_f32(x + j + 4)), fir_kernel[j]));
+			}
+
+			vst1q_f32(res, acc0);
+			vst1q_f32(res + 4, acc1);
+
+			for (j = 0; j < 8; j++)
+			{
+				samples[i + (m + j) * 2] = res[j];
+			}
+		}
+
+		for (; m < count; m++)
+		{
+			samples[i + m * 2] = fir_folded_tap(fir_kernel, history + m, fir_len);
+		}
+
+		memmove(history, history + count, (fir_len - 1) * sizeof(float));
+	}
+}
+
+#endif
+
 static void fir_interleaved(iqconverter_float_t *cnv, float *samples, int len)
 {
+	int folded = cnv->len == 4 || cnv->len == 8 || cnv->len == 12 || cnv->len == 24;
+
+	switch (folded ? cnv->simd : IQCONVERTER_SIMD_NONE)
+	{
+#ifdef USE_AVX2
+	case IQCONVERTER_SIMD_AVX2:
+		fir_interleaved_avx2(cnv, samples, len);
+		return;
+#endif
+#ifdef USE_SSE2
+	case IQCONVERTER_SIMD_SSE2:
+		fir_interleaved_sse2(cnv, samples, len);
+		return;
+#endif
+#ifdef USE_NEON
+	case IQCONVERTER_SIMD_NEON:
+		fir_interleaved_neon(cnv, samples, len);
+		return;
+#endif
+	default:
+		break;
+	}
+
 	switch (cnv->len)
 	{
 	case 4:
@@ -417,7 +870,7 @@ static void fir_interleaved(iqconverter_float_t *cnv, float *samples, int len)
 	}
 }
 
-static void delay_interleaved(iqconverter_float_t *cnv, float *samples, int len)
+static void delay_interleaved_scalar(iqconverter_float_t *cnv, float *samples, int len)
 {
 	int i;
 	ALIGNED int index;
@@ -442,14 +895,178 @@ static void delay_interleaved(iqconverter_float_t *cnv, float *samples, int len)
 	cnv->delay_index = index;
 }
 
+/*
+ * Vector delay: with the delay line kept in order (oldest first) a block
+ * is delayed by shifting its own samples back by half_len positions from
+ * the end, then filling the head from the delay line. Same output as the
+ * ring above, which still handles blocks shorter than the delay.
+ */
+static void delay_interleaved(iqconverter_float_t *cnv, float *samples, int len)
+{
+	int k;
+	int half_len = cnv->len >> 1;
+	int count = len / 2;
+	int index = cnv->delay_index;
+	float *saved;
+
+	if (cnv->simd == IQCONVERTER_SIMD_NONE || count < half_len || half_len == 0)
+	{
+		delay_interleaved_scalar(cnv, samples, len);
+		return;
+	}
+
+	/* The delay line is allocated with len entries, its upper half is scratch space */
+	saved = cnv->delay_line + half_len;
+
+	if (index != 0)
+	{
+		for (k = 0; k < half_len; k++)
+		{
+			saved[k] = cnv->delay_line[(index + k) % half_len];
+		}
+		memcpy(cnv->delay_line, saved, half_len * sizeof(float));
+	}
+
+	for (k = 0; k < half_len; k++)
+	{
+		saved[k] = samples[(count - half_len + k) * 2];
+	}
+
+	/* Walk down so every source is read before it is overwritten; the top item goes scalar as the last vector would run past the block */
+	k = count - 1;
+
+	for (; k >= count - 1 && k >= half_len; k--)
+	{
+		samples[k * 2] = samples[(k - half_len) * 2];
+	}
+
+#if defined(USE_SSE2)
+
+	{
+		const __m128 even_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, 0, -1));
+
+		for (; k - 1 >= half_len; k -= 2)
+		{
+			__m128 dst = _mm_loadu_ps(samples + (k - 1) * 2);
+			__m128 src = _mm_loadu_ps(samples + (k - 1 - half_len) * 2);
+			dst = _mm_or_ps(_mm_andnot_ps(even_mask, dst), _mm_and_ps(even_mask, src));
+			_mm_storeu_ps(samples + (k - 1) * 2, dst);
+		}
+	}
+
+#elif defined(USE_NEON)
+
+	{
+		const uint32_t even_lanes[4] = { 0xffffffff, 0, 0xffffffff, 0 };
+		const uint32x4_t even_mask = vld1q_u32(even_lanes);
+
+		for (; k - 1 >= half_len; k -= 2)
+		{
+			float32x4_t dst = vld1q_f32(samples + (k - 1) * 2);
+			float32x4_t src = vld1q_f32(samples + (k - 1 - half_len) * 2);
+			vst1q_f32(samples + (k - 1) * 2, vbslq_f32(even_mask, src, dst));
+		}
+	}
+
+#endif
+
+	for (; k >= half_len; k--)
+	{
+		samples[k * 2] = samples[(k - half_len) * 2];
+	}
+
+	for (k = 0; k < half_len; k++)
+	{
+		samples[k * 2] = cnv->delay_line[k];
+	}
+
+	memcpy(cnv->delay_line, saved, half_len * sizeof(float));
+
+	cnv->delay_index = 0;
+}
+
 #define SCALE (0.01f)
 
 static void remove_dc(iqconverter_float_t *cnv, float *samples, int len)
 {
-	int i;
+	int i = 0;
 	ALIGNED float avg = cnv->avg;
 
-	for (i = 0; i < len; i++)
+#if defined(USE_SSE2) || defined(USE_NEON)
+
+	/*
+	 * Unroll the one-pole recurrence avg += SCALE * (x - avg) by 4 so that
+	 * only avg[n + 4] = a^4 * avg[n] + q[n] remains serial, with a = 1 - SCALE.
+	 * Being reassociated, it only matches the scalar loop to rounding.
+	 */
+	const float a = 1.0f - SCALE;
+	ALIGNED const float pw_coeffs[4] = { 1.0f, a, a * a, a * a * a };
+	ALIGNED const float c0_coeffs[4] = { 0.0f, SCALE, SCALE * a, SCALE * a * a };
+	ALIGNED const float c1_coeffs[4] = { 0.0f, 0.0f, SCALE, SCALE * a };
+	ALIGNED const float c2_coeffs[4] = { 0.0f, 0.0f, 0.0f, SCALE };
+	ALIGNED const float w_coeffs[4] = { SCALE * a * a * a, SCALE * a * a, SCALE * a, SCALE };
+	const float a4 = a * a * a * a;
+
+#endif
+
+#if defined(USE_SSE2)
+
+	__m128 pw = _mm_loadu_ps(pw_coeffs);
+	__m128 c0 = _mm_loadu_ps(c0_coeffs);
+	__m128 c1 = _mm_loadu_ps(c1_coeffs);
+	__m128 c2 = _mm_loadu_ps(c2_coeffs);
+	__m128 w = _mm_loadu_ps(w_coeffs);
+
+	for (; cnv->simd != IQCONVERTER_SIMD_NONE && i + 4 <= len; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(samples + i);
+		__m128 p = _mm_mul_ps(c0, _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 0, 0, 0)));
+		__m128 q = _mm_mul_ps(w, x);
+
+		p = _mm_add_ps(p, _mm_mul_ps(c1, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1))));
+		p = _mm_add_ps(p, _mm_mul_ps(c2, _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 2, 2, 2))));
+		p = _mm_add_ps(p, _mm_mul_ps(pw, _mm_set1_ps(avg)));
+
+		_mm_storeu_ps(samples + i, _mm_sub_ps(x, p));
+
+		q = _mm_add_ps(q, _mm_movehl_ps(q, q));
+		q = _mm_add_ss(q, _mm_shuffle_ps(q, q, 1));
+		avg = a4 * avg + _mm_cvtss_f32(q);
+	}
+
+#elif defined(USE_NEON)
+
+	float32x4_t pw = vld1q_f32(pw_coeffs);
+	float32x4_t c0 = vld1q_f32(c0_coeffs);
+	float32x4_t c1 = vld1q_f32(c1_coeffs);
+	float32x4_t c2 = vld1q_f32(c2_coeffs);
+	float32x4_t w = vld1q_f32(w_coeffs);
+
+	for (; cnv->simd != IQCONVERTER_SIMD_NONE && i + 4 <= len; i += 4)
+	{
+		float32x4_t x = vld1q_f32(samples + i);
+		float32x4_t p = vmulq_n_f32(c0, vgetq_lane_f32(x, 0));
+		float32x4_t q = vmulq_f32(w, x);
+
+		p = vmlaq_n_f32(p, c1, vgetq_lane_f32(x, 1));
+		p = vmlaq_n_f32(p, c2, vgetq_lane_f32(x, 2));
+		p = vmlaq_n_f32(p, pw, avg);
+
+		vst1q_f32(samples + i, vsubq_f32(x, p));
+
+#if defined(__aarch64__)
+		avg = a4 * avg + vaddvq_f32(q);
+#else
+		{
+			float32x2_t t = vadd_f32(vget_low_f32(q), vget_high_f32(q));
+			avg = a4 * avg + vget_lane_f32(vpadd_f32(t, t), 0);
+		}
+#endif
+	}
+
+#endif
+
+	for (; i < len; i++)
 	{
 		samples[i] -= avg;
 		avg += SCALE * samples[i];
@@ -460,7 +1077,8 @@ static void remove_dc(iqconverter_float_t *cnv, float *samples, int len)
 
 static void translate_fs_4(iqconverter_float_t *cnv, float *samples, int len)
 {
-	int i;
+	int i = 0;
+	int j;
 	ALIGNED float hbc = cnv->hbc;
 
 #ifdef USE_SSE2
@@ -469,18 +1087,36 @@ static void translate_fs_4(iqconverter_float_t *cnv, float *samples, int len)
 	ALIGNED __m128 vec;
 	ALIGNED __m128 rot = _mm_set_ps(hbc, 1.0f, -hbc, -1.0f);
 
-	for (i = 0; i < len / 4; i++, buf +=4)
+	if (cnv->simd != IQCONVERTER_SIMD_NONE)
 	{
-		vec = _mm_loadu_ps(buf);
-		vec = _mm_mul_ps(vec, rot);
-		_mm_storeu_ps(buf, vec);
+		for (; i < len / 4; i++, buf +=4)
+		{
+			vec = _mm_loadu_ps(buf);
+			vec = _mm_mul_ps(vec, rot);
+			_mm_storeu_ps(buf, vec);
+		}
 	}
 
-#else
+#elif defined(USE_NEON)
 
-	int j;
+	float *buf = samples;
+	const float rot_coeffs[4] = { -1.0f, -hbc, 1.0f, hbc };
+	float32x4_t vec;
+	float32x4_t rot = vld1q_f32(rot_coeffs);
 
-	for (i = 0; i < len / 4; i++)
+	if (cnv->simd != IQCONVERTER_SIMD_NONE)
+	{
+		for (; i < len / 4; i++, buf += 4)
+		{
+			vec = vld1q_f32(buf);
+			vec = vmulq_f32(vec, rot);
+			vst1q_f32(buf, vec);
+		}
+	}
+
+#endif
+
+	for (; i < len / 4; i++)
 	{
 		j = i << 2;
 		samples[j + 0] = -samples[j + 0];
@@ -489,8 +1125,6 @@ static void translate_fs_4(iqconverter_float_t *cnv, float *samples, int len)
 		samples[j + 3] = samples[j + 3] * hbc;
 	}
 
-#endif
-
 	fir_interleaved(cnv, samples, len);
 	delay_interleaved(cnv, samples + 1, len);
 }
@@ -45,9 +45,36 @@ void * _aligned_malloc(size_t size, size_t alignment);
   #define _inline inline
 #endif
 
+#if defined(__GNUC__) && defined(__SSE2__)
+  #define USE_SSE2
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define USE_NEON
+  #include <arm_neon.h>
+#endif
+
 #define SIZE_FACTOR 16
 #define DEFAULT_ALIGNMENT 16
 
+/* Reversed kernel padded to an even tap count for the vector FIR, NULL when built without SIMD */
+static void create_simd_kernel(iqconverter_int16_t *cnv)
+{
+#if defined(USE_SSE2) || defined(USE_NEON)
+	int i;
+
+	cnv->simd_taps = (cnv->len + 1) & ~1;
+	cnv->simd_kernel = (int16_t *) _aligned_malloc(cnv->simd_taps * sizeof(int16_t), DEFAULT_ALIGNMENT);
+
+	for (i = 0; i < cnv->simd_taps; i++)
+	{
+		cnv->simd_kernel[i] = i < cnv->len ? (int16_t) cnv->fir_kernel[cnv->len - 1 - i] : 0;
+	}
+#else
+	cnv->simd_taps = 0;
+	cnv->simd_kernel = NULL;
+#endif
+}
+
 iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len)
 {
 	int i;
@@ -60,7 +87,7 @@ iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len)
 
 	cnv->fir_kernel = (int32_t *) _aligned_malloc(buffer_size, DEFAULT_ALIGNMENT);
 	cnv->fir_queue = (int32_t *) _aligned_malloc(buffer_size * SIZE_FACTOR, DEFAULT_ALIGNMENT);
-	cnv->delay_line = (int16_t *) _aligned_malloc(buffer_size / 4, DEFAULT_ALIGNMENT);
+	cnv->delay_line = (int16_t *) _aligned_malloc(buffer_size / 2, DEFAULT_ALIGNMENT);
 
 	iqconverter_int16_reset(cnv);
 
@@ -69,6 +96,30 @@ iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len)
 		cnv->fir_kernel[i] = hb_kernel[i * 2];
 	}
 
+	create_simd_kernel(cnv);
+
+	return cnv;
+}
+
+iqconverter_int16_t *iqconverter_int16_clone(const iqconverter_int16_t *src)
+{
+	size_t buffer_size;
+	iqconverter_int16_t *cnv = (iqconverter_int16_t *) _aligned_malloc(sizeof(iqconverter_int16_t), DEFAULT_ALIGNMENT);
+
+	cnv->len = src->len;
+
+	buffer_size = cnv->len * sizeof(int32_t);
+
+	cnv->fir_kernel = (int32_t *) _aligned_malloc(buffer_size, DEFAULT_ALIGNMENT);
+	cnv->fir_queue = (int32_t *) _aligned_malloc(buffer_size * SIZE_FACTOR, DEFAULT_ALIGNMENT);
+	cnv->delay_line = (int16_t *) _aligned_malloc(buffer_size / 2, DEFAULT_ALIGNMENT);
+
+	iqconverter_int16_reset(cnv);
+
+	memcpy(cnv->fir_kernel, src->fir_kernel, buffer_size);
+
+	create_simd_kernel(cnv);
+
 	return cnv;
 }
 
@@ -77,6 +128,10 @@ void iqconverter_int16_free(iqconverter_int16_t *cnv)
 	_aligned_free(cnv->fir_kernel);
 	_aligned_free(cnv->fir_queue);
 	_aligned_free(cnv->delay_line);
+	if (cnv->simd_kernel != NULL)
+	{
+		_aligned_free(cnv->simd_kernel);
+	}
 	_aligned_free(cnv);
 }
 
@@ -87,10 +142,112 @@ void iqconverter_int16_reset(iqconverter_int16_t *cnv)
 	cnv->old_x = 0;
 	cnv->old_y = 0;
 	cnv->old_e = 0;
-	memset(cnv->delay_line, 0, cnv->len * sizeof(int16_t) / 4);
+	memset(cnv->delay_line, 0, cnv->len * sizeof(int32_t) / 4);
 	memset(cnv->fir_queue, 0, cnv->len * sizeof(int16_t) * SIZE_FACTOR);
 }
 
+#if defined(USE_SSE2) || defined(USE_NEON)
+
+/*
+ * Vector FIR: the even (I) samples are gathered into a linear int16 history
+ * held in fir_queue (fir_len - 1 past samples followed by the new ones) and
+ * eight outputs are computed per iteration against the reversed kernel.
+ * Products are accumulated exactly in 32 bits and the final narrowing
+ * truncates, so the output matches the scalar code bit for bit.
+ */
+static void fir_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
+{
+	int n, m, count, chunk;
+	int fir_len;
+	int taps;
+	int16_t *history;
+	const int16_t *kernel;
+	int32_t acc;
+
+	fir_len = cnv->len;
+	taps = cnv->simd_taps;
+	history = (int16_t *) cnv->fir_queue;
+	kernel = cnv->simd_kernel;
+	chunk = (fir_len * SIZE_FACTOR * 2 - fir_len - 8) & ~7;
+
+	while (len > 0)
+	{
+		count = len / 2 < chunk ? len / 2 : chunk;
+
+		for (n = 0; n + 8 <= count; n += 8)
+		{
+#ifdef USE_SSE2
+			__m128i v0 = _mm_loadu_si128((const __m128i *) (samples + n * 2));
+			__m128i v1 = _mm_loadu_si128((const __m128i *) (samples + n * 2 + 8));
+			__m128i acc_lo = _mm_setzero_si128();
+			__m128i acc_hi = _mm_setzero_si128();
+			__m128i odd_mask = _mm_set1_epi32((int) 0xffff0000);
+			__m128i a, b, k, y;
+
+			a = _mm_srai_epi32(_mm_slli_epi32(v0, 16), 16);
+			b = _mm_srai_epi32(_mm_slli_epi32(v1, 16), 16);
+			_mm_storeu_si128((__m128i *) (history + fir_len - 1 + n), _mm_packs_epi32(a, b));
+
+			for (m = 0; m < taps; m += 2)
+			{
+				a = _mm_loadu_si128((const __m128i *) (history + n + m));
+				b = _mm_loadu_si128((const __m128i *) (history + n + m + 1));
+				k = _mm_set1_epi32((int) (((uint32_t) (uint16_t) kernel[m + 1] << 16) | (uint16_t) kernel[m]));
+				acc_lo = _mm_add_epi32(acc_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), k));
+				acc_hi = _mm_add_epi32(acc_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), k));
+			}
+
+			/* Keep the low 16 bits like the scalar store does, then narrow */
+			acc_lo = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(acc_lo, 15), 16), 16);
+			acc_hi = _mm_srai_epi32(_mm_slli_epi32(_mm_srai_epi32(acc_hi, 15), 16), 16);
+			y = _mm_packs_epi32(acc_lo, acc_hi);
+
+			v0 = _mm_or_si128(_mm_and_si128(v0, odd_mask), _mm_unpacklo_epi16(y, _mm_setzero_si128()));
+			v1 = _mm_or_si128(_mm_and_si128(v1, odd_mask), _mm_unpackhi_epi16(y, _mm_setzero_si128()));
+			_mm_storeu_si128((__m128i *) (samples + n * 2), v0);
+			_mm_storeu_si128((__m128i *) (samples + n * 2 + 8), v1);
+#else
+			int16x8x2_t v = vld2q_s16(samples + n * 2);
+			int32x4_t acc_lo = vdupq_n_s32(0);
+			int32x4_t acc_hi = vdupq_n_s32(0);
+			int16x8_t h;
+
+			vst1q_s16(history + fir_len - 1 + n, v.val[0]);
+
+			for (m = 0; m < taps; m++)
+			{
+				h = vld1q_s16(history + n + m);
+				acc_lo = vmlal_n_s16(acc_lo, vget_low_s16(h), kernel[m]);
+				acc_hi = vmlal_n_s16(acc_hi, vget_high_s16(h), kernel[m]);
+			}
+
+			v.val[0] = vcombine_s16(vmovn_s32(vshrq_n_s32(acc_lo, 15)), vmovn_s32(vshrq_n_s32(acc_hi, 15)));
+			vst2q_s16(samples + n * 2, v);
+#endif
+		}
+
+		for (; n < count; n++)
+		{
+			history[fir_len - 1 + n] = samples[n * 2];
+
+			acc = 0;
+			for (m = 0; m < fir_len; m++)
+			{
+				acc += kernel[m] * history[n + m];
+			}
+
+			samples[n * 2] = acc >> 15;
+		}
+
+		memmove(history, history + count, (fir_len - 1) * sizeof(int16_t));
+
+		samples += count * 2;
+		len -= count * 2;
+	}
+}
+
+#else
+
 static void fir_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
 {
 	int i;
@@ -129,6 +286,104 @@ static void fir_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
 	cnv->fir_index = fir_index;
 }
 
+#endif
+
+#if defined(USE_SSE2) || defined(USE_NEON)
+
+/*
+ * Vector delay: with the delay line kept in order (oldest first) a block
+ * is delayed by shifting its own samples back by half_len positions from
+ * the end, then filling the head from the delay line.
+ */
+static void delay_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
+{
+	int i, k;
+	int half_len;
+	int count;
+	int index;
+	int16_t res;
+	int16_t *saved;
+
+	half_len = cnv->len >> 1;
+	count = len / 2;
+	index = cnv->delay_index;
+
+	if (count < half_len || half_len == 0)
+	{
+		for (i = 0; i < len; i += 2)
+		{
+			res = cnv->delay_line[index];
+			cnv->delay_line[index] = samples[i];
+			samples[i] = res;
+
+			if (++index >= half_len)
+			{
+				index = 0;
+			}
+		}
+
+		cnv->delay_index = index;
+		return;
+	}
+
+	/* The delay line is allocated with len entries, its upper half is scratch space */
+	saved = cnv->delay_line + half_len;
+
+	if (index != 0)
+	{
+		for (k = 0; k < half_len; k++)
+		{
+			saved[k] = cnv->delay_line[(index + k) % half_len];
+		}
+		memcpy(cnv->delay_line, saved, half_len * sizeof(int16_t));
+	}
+
+	for (k = 0; k < half_len; k++)
+	{
+		saved[k] = samples[(count - half_len + k) * 2];
+	}
+
+	/* Walk down so every source is read before it is overwritten; the top items go scalar as the last vector would run past the block */
+	k = count - 1;
+
+	for (; k >= count - 4 && k >= half_len; k--)
+	{
+		samples[k * 2] = samples[(k - half_len) * 2];
+	}
+
+	for (; k - 3 >= half_len; k -= 4)
+	{
+#ifdef USE_SSE2
+		__m128i even_mask = _mm_set1_epi32(0x0000ffff);
+		__m128i dst = _mm_loadu_si128((const __m128i *) (samples + (k - 3) * 2));
+		__m128i src = _mm_loadu_si128((const __m128i *) (samples + (k - 3 - half_len) * 2));
+		dst = _mm_or_si128(_mm_andnot_si128(even_mask, dst), _mm_and_si128(even_mask, src));
+		_mm_storeu_si128((__m128i *) (samples + (k - 3) * 2), dst);
+#else
+		uint16x8_t even_mask = vreinterpretq_u16_u32(vdupq_n_u32(0x0000ffff));
+		int16x8_t dst = vld1q_s16(samples + (k - 3) * 2);
+		int16x8_t src = vld1q_s16(samples + (k - 3 - half_len) * 2);
+		vst1q_s16(samples + (k - 3) * 2, vbslq_s16(even_mask, src, dst));
+#endif
+	}
+
+	for (; k >= half_len; k--)
+	{
+		samples[k * 2] = samples[(k - half_len) * 2];
+	}
+
+	for (k = 0; k < half_len; k++)
+	{
+		samples[k * 2] = cnv->delay_line[k];
+	}
+
+	memcpy(cnv->delay_line, saved, half_len * sizeof(int16_t));
+
+	cnv->delay_index = 0;
+}
+
+#else
+
 static void delay_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int len)
 {
 	int i;
@@ -154,6 +409,8 @@ static void delay_interleaved(iqconverter_int16_t *cnv, int16_t *samples, int le
 	cnv->delay_index = index;
 }
 
+#endif
+
 static void remove_dc(iqconverter_int16_t *cnv, int16_t *samples, int len)
 {
 	int i;
@@ -184,9 +441,54 @@ static void remove_dc(iqconverter_int16_t *cnv, int16_t *samples, int len)
 
 static void translate_fs_4(iqconverter_int16_t *cnv, int16_t *samples, int len)
 {
-	int i;
+	int i = 0;
+
+#ifdef USE_SSE2
+
+	/* Lanes 0..3 of each group: -x, (-x) >> 1, x, x >> 1. (-x) >> 1 is computed as -((x >> 1) + (x & 1)) to stay exact for -32768 */
+	__m128i neg_mask = _mm_set_epi16(0, 0, 0, -1, 0, 0, 0, -1);
+	__m128i nhalf_mask = _mm_set_epi16(0, 0, -1, 0, 0, 0, -1, 0);
+	__m128i half_mask = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+	__m128i keep_mask = _mm_set_epi16(0, -1, 0, 0, 0, -1, 0, 0);
+	__m128i one = _mm_set1_epi16(1);
+	__m128i zero = _mm_setzero_si128();
+
+	for (; i + 8 <= len; i += 8)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *) (samples + i));
+		__m128i half = _mm_srai_epi16(x, 1);
+		__m128i neg = _mm_sub_epi16(zero, x);
+		__m128i nhalf = _mm_sub_epi16(zero, _mm_add_epi16(half, _mm_and_si128(x, one)));
+		__m128i y = _mm_or_si128(
+			_mm_or_si128(_mm_and_si128(neg, neg_mask), _mm_and_si128(nhalf, nhalf_mask)),
+			_mm_or_si128(_mm_and_si128(x, keep_mask), _mm_and_si128(half, half_mask)));
+		_mm_storeu_si128((__m128i *) (samples + i), y);
+	}
+
+#elif defined(USE_NEON)
+
+	/* Same lane pattern as the SSE2 path */
+	const int16_t neg_lanes[8] = { -1, 0, 0, 0, -1, 0, 0, 0 };
+	const int16_t nhalf_lanes[8] = { 0, -1, 0, 0, 0, -1, 0, 0 };
+	const int16_t half_lanes[8] = { 0, 0, 0, -1, 0, 0, 0, -1 };
+	uint16x8_t neg_mask = vreinterpretq_u16_s16(vld1q_s16(neg_lanes));
+	uint16x8_t nhalf_mask = vreinterpretq_u16_s16(vld1q_s16(nhalf_lanes));
+	uint16x8_t half_mask = vreinterpretq_u16_s16(vld1q_s16(half_lanes));
+	int16x8_t one = vdupq_n_s16(1);
+
+	for (; i + 8 <= len; i += 8)
+	{
+		int16x8_t x = vld1q_s16(samples + i);
+		int16x8_t half = vshrq_n_s16(x, 1);
+		int16x8_t y = vbslq_s16(neg_mask, vnegq_s16(x), x);
+		y = vbslq_s16(nhalf_mask, vnegq_s16(vaddq_s16(half, vandq_s16(x, one))), y);
+		y = vbslq_s16(half_mask, half, y);
+		vst1q_s16(samples + i, y);
+	}
+
+#endif
 
-	for (i = 0; i < len; i += 4)
+	for (; i < len; i += 4)
 	{
 		samples[i + 0] = -samples[i + 0];
 		samples[i + 1] = -samples[i + 1] >> 1;
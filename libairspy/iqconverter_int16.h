@@ -35,9 +35,13 @@ typedef struct {
 	int32_t *fir_kernel;
 	int32_t *fir_queue;
 	int16_t *delay_line;
+	int simd_taps;
+	int16_t *simd_kernel;
 } iqconverter_int16_t;
 
 iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len);
+/* New converter with the same kernel as src and a freshly reset state */
+iqconverter_int16_t *iqconverter_int16_clone(const iqconverter_int16_t *src);
 void iqconverter_int16_free(iqconverter_int16_t *cnv);
 void iqconverter_int16_reset(iqconverter_int16_t *cnv);
 void iqconverter_int16_process(iqconverter_int16_t *cnv, int16_t *samples, int len);
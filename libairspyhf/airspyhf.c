@@ -36,6 +36,7 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #include <math.h>
 
 #include "iqbalancer.h"
+#include "channelizer.h"
 #include "airspyhf.h"
 #include "airspyhf_commands.h"
 
@@ -49,6 +50,16 @@ typedef int bool;
 #define M_PI (3.14159265359)
 #endif
 
+#if defined(__GNUC__) && defined(__SSE2__)
+  #define USE_SSE2
+  #include <immintrin.h>
+  /* The AVX2/FMA mixer is built with a target attribute and selected at runtime */
+  #define USE_AVX2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define USE_NEON
+  #include <arm_neon.h>
+#endif
+
 #define MAX(a,b) ((a) > (b) ? a : b)
 #define MIN(a,b) ((a) < (b) ? a : b)
 
@@ -56,6 +67,11 @@ typedef int bool;
 #define SERIAL_NUMBER_UNUSED (0)
 #define FILE_DESCRIPTOR_UNUSED (-1)
 #define RAW_BUFFER_COUNT (8)
+#define DEFAULT_TRANSFER_COUNT (16)
+#define MAX_TRANSFER_COUNT (256)
+#define TRANSFER_SAMPLE_ALIGNMENT (128)
+#define MAX_SAMPLES_PER_TRANSFER (1024 * 256)
+#define MAX_CALLBACK_BATCH (256)
 #define AIRSPYHF_SERIAL_SIZE (28)
 
 #define MAX_SAMPLERATE_INDEX (100)
@@ -63,6 +79,8 @@ typedef int bool;
 
 #define CALIBRATION_MAGIC (0xA5CA71B0)
 
+#define NCO_LANES (8)
+
 #define DEFAULT_IF_SHIFT (5000)
 #define MIN_ZERO_IF_LO (180)
 #define MIN_LOW_IF_LO (84)
@@ -74,6 +92,10 @@ static const char str_prefix_serial_airspyhf[STR_PREFIX_SERIAL_AIRSPYHF_SIZE] =
 #define INITIAL_PHASE (0.00006f)
 #define INITIAL_AMPLITUDE (-0.0045f)
 
+#define IQ_CALIBRATION_MAGIC (0xA5CA71B1)
+#define IQ_CALIBRATION_BAND_HZ (500000)
+#define IQ_CALIBRATION_TABLE_SIZE (1024)
+
 #pragma pack(push,1)
 
 typedef struct {
@@ -83,6 +105,15 @@ typedef struct {
 
 #pragma pack(pop)
 
+typedef struct
+{
+	uint32_t band;
+	uint16_t gain_state;
+	uint16_t used;
+	float phase;
+	float amplitude;
+} iq_calibration_entry_t;
+
 typedef struct airspyhf_device
 {
 	libusb_context* usb_context;
@@ -105,19 +136,33 @@ typedef struct airspyhf_device
 	uint8_t enable_dsp;
 	uint8_t is_low_if;
 	float filter_gain;
-	airspyhf_complex_float_t vec;
+	double nco_phase;
+	bool use_avx2;
 	struct iq_balancer_t *iq_balancer;
+	uint8_t hf_att;
+	uint8_t hf_lna;
+	uint8_t hf_agc;
+	uint8_t iq_calibration_enabled;
+	uint32_t iq_calibration_band;
+	uint16_t iq_calibration_gain_state;
+	iq_calibration_entry_t *iq_calibration_table;
+	struct pfb_channelizer_t *channelizer;
+	airspyhf_channel_block_cb_fn channel_callback;
+	airspyhf_complex_float_t **channel_buffers;
+	uint32_t channelizer_channel_count;
 	uint32_t transfer_count;
 	int32_t transfer_live;
 	uint32_t buffer_size;
+	uint32_t callback_batch;
+	uint32_t raw_buffer_count;
 	uint32_t dropped_buffers;
-	uint32_t dropped_buffers_queue[RAW_BUFFER_COUNT];
-	airspyhf_complex_int16_t *received_samples_queue[RAW_BUFFER_COUNT];
+	uint32_t *dropped_buffers_queue;
+	airspyhf_complex_int16_t **received_samples_queue;
 	volatile bool streaming;
 	volatile bool stop_requested;
 	volatile int received_samples_queue_head;
 	volatile int received_samples_queue_tail;
-	volatile int received_buffer_count;
+	volatile uint32_t received_buffer_count;
 	airspyhf_complex_float_t *output_buffer;
 	void* ctx;
 } airspyhf_device_t;
@@ -161,14 +206,11 @@ static int cancel_transfers(airspyhf_device_t* device)
 
 static int free_transfers(airspyhf_device_t* device)
 {
-	int i;
+	uint32_t i;
 	uint32_t transfer_index;
 
 	if (device->transfers != NULL)
 	{
-		free(device->output_buffer);
-		device->output_buffer = NULL;
-
 		for (transfer_index = 0; transfer_index < device->transfer_count; transfer_index++)
 		{
 			if (device->transfers[transfer_index] != NULL)
@@ -180,30 +222,55 @@ static int free_transfers(airspyhf_device_t* device)
 		}
 		free(device->transfers);
 		device->transfers = NULL;
+	}
+
+	free(device->output_buffer);
+	device->output_buffer = NULL;
 
-		for (i = 0; i < RAW_BUFFER_COUNT; i++)
+	if (device->received_samples_queue != NULL)
+	{
+		for (i = 0; i < device->raw_buffer_count; i++)
 		{
-			if (device->received_samples_queue[i] != NULL)
-			{
-				free(device->received_samples_queue[i]);
-				device->received_samples_queue[i] = NULL;
-			}
+			free(device->received_samples_queue[i]);
 		}
 	}
 
+	free(device->received_samples_queue);
+	device->received_samples_queue = NULL;
+	free(device->dropped_buffers_queue);
+	device->dropped_buffers_queue = NULL;
+
 	return AIRSPYHF_SUCCESS;
 }
 
 static int allocate_transfers(airspyhf_device_t* const device)
 {
-	int i;
+	uint32_t i;
 	uint32_t transfer_index;
 
 	if (device->transfers == NULL)
 	{
-		device->output_buffer = (airspyhf_complex_float_t *) malloc((device->buffer_size / sizeof(airspyhf_complex_int16_t)) * sizeof(airspyhf_complex_float_t));
+		device->output_buffer = (airspyhf_complex_float_t *) malloc((device->buffer_size / sizeof(airspyhf_complex_int16_t)) * device->callback_batch * sizeof(airspyhf_complex_float_t));
+		if (device->output_buffer == NULL)
+		{
+			return AIRSPYHF_ERROR;
+		}
 
-		for (i = 0; i < RAW_BUFFER_COUNT; i++)
+		// The raw queue grows with the transfer count, it must stay a power of two
+		device->raw_buffer_count = RAW_BUFFER_COUNT;
+		while (device->raw_buffer_count < device->transfer_count)
+		{
+			device->raw_buffer_count <<= 1;
+		}
+
+		device->dropped_buffers_queue = (uint32_t *) calloc(device->raw_buffer_count, sizeof(uint32_t));
+		device->received_samples_queue = (airspyhf_complex_int16_t **) calloc(device->raw_buffer_count, sizeof(airspyhf_complex_int16_t *));
+		if (device->dropped_buffers_queue == NULL || device->received_samples_queue == NULL)
+		{
+			return AIRSPYHF_ERROR;
+		}
+
+		for (i = 0; i < device->raw_buffer_count; i++)
 		{
 			device->received_samples_queue[i] = (airspyhf_complex_int16_t *) malloc(device->buffer_size);
 			if (device->received_samples_queue[i] == NULL)
@@ -277,46 +344,269 @@ static int prepare_transfers(airspyhf_device_t* device, const uint_fast8_t endpo
 	return AIRSPYHF_ERROR;
 }
 
-static void multiply_complex_complex(airspyhf_complex_float_t *a, const airspyhf_complex_float_t *b)
+static bool detect_avx2(void)
+{
+#ifdef USE_AVX2
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+	return false;
+#endif
+}
+
+static void scale_samples(const airspyhf_complex_int16_t *src, airspyhf_complex_float_t *dest, int count, float gain)
+{
+	int i = 0;
+
+#if defined(USE_SSE2)
+
+	const __m128 g = _mm_set1_ps(gain);
+
+	for (; i <= count - 4; i += 4)
+	{
+		// {im, re} pairs are swapped to {re, im} before widening
+		__m128i x = _mm_loadu_si128((const __m128i *) (src + i));
+		x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+		__m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+		_mm_storeu_ps((float *) (dest + i), _mm_mul_ps(lo, g));
+		_mm_storeu_ps((float *) (dest + i + 2), _mm_mul_ps(hi, g));
+	}
+
+#elif defined(USE_NEON)
+
+	for (; i <= count - 4; i += 4)
+	{
+		int16x8_t x = vrev32q_s16(vld1q_s16((const int16_t *) (src + i)));
+		float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(x)));
+		float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(x)));
+		vst1q_f32((float *) (dest + i), vmulq_n_f32(lo, gain));
+		vst1q_f32((float *) (dest + i + 2), vmulq_n_f32(hi, gain));
+	}
+
+#endif
+
+	for (; i < count; i++)
+	{
+		dest[i].re = src[i].re * gain;
+		dest[i].im = src[i].im * gain;
+	}
+}
+
+/*
+ * The mixer kernels advance NCO_LANES independent phasors by rot^NCO_LANES,
+ * which breaks the sample-to-sample dependency of a single recursive rotator.
+ * count shall be a multiple of NCO_LANES.
+ */
+
+#if !defined(USE_SSE2) && !defined(USE_NEON)
+
+static void mix_samples_generic(float *dest, int count, const float *lanes, const float *rot)
 {
-	float re = a->re * b->re - a->im * b->im;
-	a->im = a->im * b->re + a->re * b->im;
-	a->re = re;
+	int i;
+	int j;
+	float p[NCO_LANES * 2];
+	float re;
+
+	memcpy(p, lanes, sizeof(p));
+
+	for (i = 0; i < count; i += NCO_LANES)
+	{
+		for (j = 0; j < NCO_LANES; j++)
+		{
+			re = dest[0] * p[j * 2] - dest[1] * p[j * 2 + 1];
+			dest[1] = dest[1] * p[j * 2] + dest[0] * p[j * 2 + 1];
+			dest[0] = re;
+			dest += 2;
+
+			re = p[j * 2] * rot[0] - p[j * 2 + 1] * rot[1];
+			p[j * 2 + 1] = p[j * 2 + 1] * rot[0] + p[j * 2] * rot[1];
+			p[j * 2] = re;
+		}
+	}
 }
 
-static void multiply_complex_real(airspyhf_complex_float_t *a, const float b)
+#endif
+
+#ifdef USE_SSE2
+
+static inline __m128 multiply_complex_sse2(__m128 x, __m128 y, __m128 sign)
 {
-	a->re *= b;
-	a->im *= b;
+	__m128 y_re = _mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 2, 0, 0));
+	__m128 y_im = _mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 3, 1, 1));
+	__m128 x_sw = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_add_ps(_mm_mul_ps(x, y_re), _mm_xor_ps(_mm_mul_ps(x_sw, y_im), sign));
 }
 
-static inline void rotate_complex(airspyhf_complex_float_t *vec, const airspyhf_complex_float_t *rot)
+static void mix_samples_sse2(float *dest, int count, const float *lanes, const float *rot)
 {
-	multiply_complex_complex(vec, rot);
+	int i;
+	const __m128 sign = _mm_castsi128_ps(_mm_set_epi32(0, (int) 0x80000000, 0, (int) 0x80000000));
+	const __m128 r = _mm_setr_ps(rot[0], rot[1], rot[0], rot[1]);
+	__m128 p0 = _mm_loadu_ps(lanes);
+	__m128 p1 = _mm_loadu_ps(lanes + 4);
+	__m128 p2 = _mm_loadu_ps(lanes + 8);
+	__m128 p3 = _mm_loadu_ps(lanes + 12);
 
-	float norm = 1.99f - (vec->re * vec->re + vec->im * vec->im);
+	for (i = 0; i < count; i += NCO_LANES, dest += NCO_LANES * 2)
+	{
+		_mm_storeu_ps(dest, multiply_complex_sse2(_mm_loadu_ps(dest), p0, sign));
+		_mm_storeu_ps(dest + 4, multiply_complex_sse2(_mm_loadu_ps(dest + 4), p1, sign));
+		_mm_storeu_ps(dest + 8, multiply_complex_sse2(_mm_loadu_ps(dest + 8), p2, sign));
+		_mm_storeu_ps(dest + 12, multiply_complex_sse2(_mm_loadu_ps(dest + 12), p3, sign));
 
-	multiply_complex_real(vec, norm);
+		p0 = multiply_complex_sse2(p0, r, sign);
+		p1 = multiply_complex_sse2(p1, r, sign);
+		p2 = multiply_complex_sse2(p2, r, sign);
+		p3 = multiply_complex_sse2(p3, r, sign);
+	}
 }
 
-static void convert_samples(airspyhf_device_t* device, airspyhf_complex_int16_t *src, airspyhf_complex_float_t *dest, int count)
+#endif
+
+#ifdef USE_AVX2
+
+__attribute__((target("avx2,fma")))
+static inline __m256 multiply_complex_avx2(__m256 x, __m256 y)
 {
-	const float scale = 1.0f / 32768;
+	__m256 y_re = _mm256_moveldup_ps(y);
+	__m256 y_im = _mm256_movehdup_ps(y);
+	__m256 x_sw = _mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm256_fmaddsub_ps(x, y_re, _mm256_mul_ps(x_sw, y_im));
+}
+
+__attribute__((target("avx2,fma")))
+static void mix_samples_avx2(float *dest, int count, const float *lanes, const float *rot)
+{
+	int i;
+	const __m256 r = _mm256_setr_ps(rot[0], rot[1], rot[0], rot[1], rot[0], rot[1], rot[0], rot[1]);
+	__m256 p0 = _mm256_loadu_ps(lanes);
+	__m256 p1 = _mm256_loadu_ps(lanes + 8);
+
+	for (i = 0; i < count; i += NCO_LANES, dest += NCO_LANES * 2)
+	{
+		_mm256_storeu_ps(dest, multiply_complex_avx2(_mm256_loadu_ps(dest), p0));
+		_mm256_storeu_ps(dest + 8, multiply_complex_avx2(_mm256_loadu_ps(dest + 8), p1));
+
+		p0 = multiply_complex_avx2(p0, r);
+		p1 = multiply_complex_avx2(p1, r);
+	}
+}
+
+#endif
 
+#ifdef USE_NEON
+
+static void mix_samples_neon(float *dest, int count, const float *lanes, const float *rot)
+{
 	int i;
-	airspyhf_complex_float_t vec;
-	airspyhf_complex_float_t rot;
+	float32x4x2_t x;
+	float32x4x2_t y;
+	float32x4x2_t p0 = vld2q_f32(lanes);
+	float32x4x2_t p1 = vld2q_f32(lanes + 8);
+	float32x4_t re;
+
+	for (i = 0; i < count; i += NCO_LANES, dest += NCO_LANES * 2)
+	{
+		x = vld2q_f32(dest);
+		y.val[0] = vmlsq_f32(vmulq_f32(x.val[0], p0.val[0]), x.val[1], p0.val[1]);
+		y.val[1] = vmlaq_f32(vmulq_f32(x.val[1], p0.val[0]), x.val[0], p0.val[1]);
+		vst2q_f32(dest, y);
+
+		x = vld2q_f32(dest + 8);
+		y.val[0] = vmlsq_f32(vmulq_f32(x.val[0], p1.val[0]), x.val[1], p1.val[1]);
+		y.val[1] = vmlaq_f32(vmulq_f32(x.val[1], p1.val[0]), x.val[0], p1.val[1]);
+		vst2q_f32(dest + 8, y);
+
+		re = vmlsq_n_f32(vmulq_n_f32(p0.val[0], rot[0]), p0.val[1], rot[1]);
+		p0.val[1] = vmlaq_n_f32(vmulq_n_f32(p0.val[1], rot[0]), p0.val[0], rot[1]);
+		p0.val[0] = re;
+
+		re = vmlsq_n_f32(vmulq_n_f32(p1.val[0], rot[0]), p1.val[1], rot[1]);
+		p1.val[1] = vmlaq_n_f32(vmulq_n_f32(p1.val[1], rot[0]), p1.val[0], rot[1]);
+		p1.val[0] = re;
+	}
+}
+
+#endif
+
+static void mix_samples(airspyhf_device_t* device, airspyhf_complex_float_t *dest, int count, float gain)
+{
+	int i;
+	int n;
+	double step;
+	double phase;
 	double angle;
+	float lanes[NCO_LANES * 2];
+	float rot[2];
+	float re;
+	float im;
+
+	// The phase is kept in cycles and the lane phasors are rebuilt in double
+	// precision for every block, so the float rotators never drift in amplitude
+	step = -(double) device->freq_shift / (double) device->current_samplerate;
+	phase = device->nco_phase;
+
+	for (i = 0; i < NCO_LANES; i++)
+	{
+		angle = 2.0 * M_PI * (phase + (i + 1) * step);
+		lanes[i * 2] = (float) (gain * cos(angle));
+		lanes[i * 2 + 1] = (float) (gain * sin(angle));
+	}
+
+	angle = 2.0 * M_PI * NCO_LANES * step;
+	rot[0] = (float) cos(angle);
+	rot[1] = (float) sin(angle);
+
+	n = count & ~(NCO_LANES - 1);
+
+#if defined(USE_AVX2)
+	if (device->use_avx2)
+		mix_samples_avx2((float *) dest, n, lanes, rot);
+	else
+		mix_samples_sse2((float *) dest, n, lanes, rot);
+#elif defined(USE_SSE2)
+	mix_samples_sse2((float *) dest, n, lanes, rot);
+#elif defined(USE_NEON)
+	mix_samples_neon((float *) dest, n, lanes, rot);
+#else
+	mix_samples_generic((float *) dest, n, lanes, rot);
+#endif
+
+	for (i = n; i < count; i++)
+	{
+		angle = 2.0 * M_PI * (phase + (i + 1) * step);
+		re = (float) (gain * cos(angle));
+		im = (float) (gain * sin(angle));
+		lanes[0] = dest[i].re * re - dest[i].im * im;
+		dest[i].im = dest[i].im * re + dest[i].re * im;
+		dest[i].re = lanes[0];
+	}
+
+	phase += count * step;
+	device->nco_phase = phase - floor(phase);
+}
+
+static void convert_samples(airspyhf_device_t* device, airspyhf_complex_int16_t *src, airspyhf_complex_float_t *dest, int count)
+{
+	const float scale = 1.0f / 32768;
+
 	float conversion_gain;
+	bool mix;
 
 	conversion_gain = scale * device->filter_gain;
+	mix = device->enable_dsp && device->freq_shift != 0;
 
-	for (i = 0; i < count; i++)
+	if (mix && device->is_low_if)
 	{
-		dest[i].re = src[i].re * conversion_gain;
-		dest[i].im = src[i].im * conversion_gain;
+		// No IQ correction in between: fold the conversion gain into the NCO
+		scale_samples(src, dest, count, 1.0f);
+		mix_samples(device, dest, count, conversion_gain);
+		return;
 	}
 
+	scale_samples(src, dest, count, conversion_gain);
+
 	if (device->enable_dsp)
 	{
 		if (!device->is_low_if)
@@ -326,22 +616,9 @@ static void convert_samples(airspyhf_device_t* device, airspyhf_complex_int16_t
 		}
 
 		// Fine tuning
-		if (device->freq_shift != 0)
+		if (mix)
 		{
-			angle = 2.0 * M_PI * device->freq_shift / (double) device->current_samplerate;
-
-			vec = device->vec;
-
-			rot.re = (float) cos(angle);
-			rot.im = (float) -sin(angle);
-
-			for (i = 0; i < count; i++)
-			{
-				rotate_complex(&vec, &rot);
-				multiply_complex_complex(&dest[i], &vec);
-			}
-
-			device->vec = vec;
+			mix_samples(device, dest, count, 1.0f);
 		}
 	}
 }
@@ -351,6 +628,8 @@ static void* consumer_threadproc(void *arg)
 	int sample_count;
 	airspyhf_complex_int16_t *input_samples;
 	uint32_t dropped_buffers;
+	uint32_t batch_fill = 0;
+	uint64_t batch_dropped_buffers = 0;
 	airspyhf_device_t* device = (airspyhf_device_t*) arg;
 	airspyhf_transfer_t transfer;
 
@@ -375,23 +654,33 @@ static void* consumer_threadproc(void *arg)
 
 		input_samples = (airspyhf_complex_int16_t *) device->received_samples_queue[device->received_samples_queue_tail];
 		dropped_buffers = device->dropped_buffers_queue[device->received_samples_queue_tail];
-		device->received_samples_queue_tail = (device->received_samples_queue_tail + 1) & (RAW_BUFFER_COUNT - 1);
+		device->received_samples_queue_tail = (device->received_samples_queue_tail + 1) & (device->raw_buffer_count - 1);
 
 		pthread_mutex_unlock(&device->consumer_mp);
 
 		sample_count = device->buffer_size / sizeof(airspyhf_complex_int16_t);
 
-		convert_samples(device, input_samples, device->output_buffer, sample_count);
+		convert_samples(device, input_samples, device->output_buffer + batch_fill * sample_count, sample_count);
 
-		transfer.device = device;
-		transfer.ctx = device->ctx;
-		transfer.samples = device->output_buffer;
-		transfer.sample_count = sample_count;
-		transfer.dropped_samples = (uint64_t) dropped_buffers * (uint64_t) sample_count;
+		batch_dropped_buffers += dropped_buffers;
 
-		if (device->callback(&transfer) != 0)
+		// Transfers are aggregated into one contiguous callback block, drops
+		// that happened anywhere inside the batch are reported with it
+		if (++batch_fill == device->callback_batch)
 		{
-			device->stop_requested = true;
+			transfer.device = device;
+			transfer.ctx = device->ctx;
+			transfer.samples = device->output_buffer;
+			transfer.sample_count = sample_count * device->callback_batch;
+			transfer.dropped_samples = batch_dropped_buffers * (uint64_t) sample_count;
+
+			batch_fill = 0;
+			batch_dropped_buffers = 0;
+
+			if (device->callback(&transfer) != 0)
+			{
+				device->stop_requested = true;
+			}
 		}
 
 		pthread_mutex_lock(&device->consumer_mp);
@@ -420,7 +709,7 @@ static void LIBUSB_CALL airspyhf_libusb_transfer_callback(struct libusb_transfer
 	{
 		pthread_mutex_lock(&device->consumer_mp);
 
-		if (device->received_buffer_count < RAW_BUFFER_COUNT)
+		if (device->received_buffer_count < device->raw_buffer_count)
 		{
 			temp = device->received_samples_queue[device->received_samples_queue_head];
 			device->received_samples_queue[device->received_samples_queue_head] = (airspyhf_complex_int16_t *) usb_transfer->buffer;
@@ -429,7 +718,7 @@ static void LIBUSB_CALL airspyhf_libusb_transfer_callback(struct libusb_transfer
 			device->dropped_buffers_queue[device->received_samples_queue_head] = device->dropped_buffers;
 			device->dropped_buffers = 0;
 			
-			device->received_samples_queue_head = (device->received_samples_queue_head + 1) & (RAW_BUFFER_COUNT - 1);
+			device->received_samples_queue_head = (device->received_samples_queue_head + 1) & (device->raw_buffer_count - 1);
 			device->received_buffer_count++;
 
 			pthread_cond_signal(&device->consumer_cv);
@@ -923,8 +1212,16 @@ static int airspyhf_open_init(airspyhf_device_t** device, uint64_t serial_number
 
 	lib_device->transfers = NULL;
 	lib_device->callback = NULL;
-	lib_device->transfer_count = 16;
+	lib_device->transfer_count = DEFAULT_TRANSFER_COUNT;
 	lib_device->buffer_size = SAMPLES_TO_TRANSFER * sizeof(airspyhf_complex_int16_t);
+	lib_device->callback_batch = 1;
+	lib_device->raw_buffer_count = 0;
+	lib_device->dropped_buffers_queue = NULL;
+	lib_device->received_samples_queue = NULL;
+	lib_device->output_buffer = NULL;
+	lib_device->channelizer = NULL;
+	lib_device->channel_callback = NULL;
+	lib_device->channel_buffers = NULL;
 	lib_device->streaming = false;
 	lib_device->stop_requested = false;
 
@@ -982,8 +1279,8 @@ static int airspyhf_open_init(airspyhf_device_t** device, uint64_t serial_number
 	lib_device->freq_hz = 0;
 	lib_device->freq_khz = 0;
 	lib_device->freq_shift = 0;
-	lib_device->vec.re = 1.0f;
-	lib_device->vec.im = 0.0f;
+	lib_device->nco_phase = 0.0;
+	lib_device->use_avx2 = detect_avx2();
 	lib_device->optimal_point = 0.0f;
 	lib_device->filter_gain = 1.0f;
 	lib_device->enable_dsp = 1;
@@ -1006,6 +1303,14 @@ static int airspyhf_open_init(airspyhf_device_t** device, uint64_t serial_number
 
 	lib_device->iq_balancer = iq_balancer_create(INITIAL_PHASE, INITIAL_AMPLITUDE);
 
+	lib_device->hf_att = 0;
+	lib_device->hf_lna = 0;
+	lib_device->hf_agc = 0;
+	lib_device->iq_calibration_enabled = 1;
+	lib_device->iq_calibration_band = 0;
+	lib_device->iq_calibration_gain_state = 0;
+	lib_device->iq_calibration_table = (iq_calibration_entry_t *) calloc(IQ_CALIBRATION_TABLE_SIZE, sizeof(iq_calibration_entry_t));
+
 	*device = lib_device;
 
 	return AIRSPYHF_SUCCESS;
@@ -1059,6 +1364,7 @@ int ADDCALL airspyhf_close(airspyhf_device_t* device)
 		free(device->supported_samplerates);
 		free(device->samplerate_architectures);
 		iq_balancer_destroy(device->iq_balancer);
+		free(device->iq_calibration_table);
 		airspyhf_open_exit(device);
 		free(device);
 	}
@@ -1068,8 +1374,67 @@ int ADDCALL airspyhf_close(airspyhf_device_t* device)
 
 int ADDCALL airspyhf_get_output_size(airspyhf_device_t * device)
 {
-	// Todo: Make this configurable
-	return SAMPLES_TO_TRANSFER;
+	return (int) (device->buffer_size / sizeof(airspyhf_complex_int16_t) * device->callback_batch);
+}
+
+static int reallocate_transfers(airspyhf_device_t* device, uint32_t transfer_count, uint32_t buffer_size, uint32_t callback_batch)
+{
+	uint32_t old_transfer_count = device->transfer_count;
+	uint32_t old_buffer_size = device->buffer_size;
+	uint32_t old_callback_batch = device->callback_batch;
+
+	if (device->streaming)
+	{
+		return AIRSPYHF_ERROR;
+	}
+
+	free_transfers(device);
+
+	device->transfer_count = transfer_count;
+	device->buffer_size = buffer_size;
+	device->callback_batch = callback_batch;
+
+	if (allocate_transfers(device) == AIRSPYHF_SUCCESS)
+	{
+		return AIRSPYHF_SUCCESS;
+	}
+
+	// Go back to the previous configuration, airspyhf_start() refuses to run
+	// if even that cannot be allocated
+	free_transfers(device);
+
+	device->transfer_count = old_transfer_count;
+	device->buffer_size = old_buffer_size;
+	device->callback_batch = old_callback_batch;
+
+	if (allocate_transfers(device) != AIRSPYHF_SUCCESS)
+	{
+		free_transfers(device);
+	}
+
+	return AIRSPYHF_ERROR;
+}
+
+int ADDCALL airspyhf_set_transfer_config(airspyhf_device_t* device, uint32_t transfer_count, uint32_t samples_per_transfer)
+{
+	if (transfer_count == 0 || transfer_count > MAX_TRANSFER_COUNT ||
+		samples_per_transfer == 0 || samples_per_transfer > MAX_SAMPLES_PER_TRANSFER ||
+		samples_per_transfer % TRANSFER_SAMPLE_ALIGNMENT != 0)
+	{
+		return AIRSPYHF_ERROR;
+	}
+
+	return reallocate_transfers(device, transfer_count, samples_per_transfer * sizeof(airspyhf_complex_int16_t), device->callback_batch);
+}
+
+int ADDCALL airspyhf_set_callback_batch(airspyhf_device_t* device, uint32_t transfers_per_callback)
+{
+	if (transfers_per_callback == 0 || transfers_per_callback > MAX_CALLBACK_BATCH)
+	{
+		return AIRSPYHF_ERROR;
+	}
+
+	return reallocate_transfers(device, device->transfer_count, device->buffer_size, transfers_per_callback);
 }
 
 int ADDCALL airspyhf_is_low_if(airspyhf_device_t* device)
@@ -1214,11 +1579,15 @@ int ADDCALL airspyhf_start(airspyhf_device_t* device, airspyhf_sample_block_cb_f
 {
 	int result;
 
-	memset(device->dropped_buffers_queue, 0, RAW_BUFFER_COUNT * sizeof(uint32_t));
+	if (device->transfers == NULL)
+	{
+		return AIRSPYHF_ERROR;
+	}
+
+	memset(device->dropped_buffers_queue, 0, device->raw_buffer_count * sizeof(uint32_t));
 	device->dropped_buffers = 0;
 
-	device->vec.re = 1.0f;
-	device->vec.im = 0.0f;
+	device->nco_phase = 0.0;
 
 	result = airspyhf_set_receiver_mode(device, RECEIVER_MODE_OFF);
 	if (result != AIRSPYHF_SUCCESS)
@@ -1243,12 +1612,103 @@ int ADDCALL airspyhf_is_streaming(airspyhf_device_t* device)
 	return device->streaming && !device->stop_requested;
 }
 
+static void free_channelizer(airspyhf_device_t* device)
+{
+	if (device->channel_buffers != NULL)
+	{
+		free(device->channel_buffers[0]);
+		free(device->channel_buffers);
+		device->channel_buffers = NULL;
+	}
+
+	pfb_channelizer_destroy(device->channelizer);
+	device->channelizer = NULL;
+	device->channel_callback = NULL;
+}
+
+static int channelizer_callback(airspyhf_transfer_t* transfer)
+{
+	airspyhf_device_t* device = transfer->device;
+	airspyhf_channel_transfer_t channel_transfer;
+
+	channel_transfer.device = device;
+	channel_transfer.ctx = transfer->ctx;
+	channel_transfer.channels = device->channel_buffers;
+	channel_transfer.channel_count = device->channelizer_channel_count;
+	channel_transfer.sample_count = pfb_channelizer_process(device->channelizer, transfer->samples, transfer->sample_count, device->channel_buffers);
+	channel_transfer.dropped_samples = transfer->dropped_samples;
+
+	if (channel_transfer.sample_count == 0)
+	{
+		return 0;
+	}
+
+	return device->channel_callback(&channel_transfer);
+}
+
+int ADDCALL airspyhf_start_channelized(airspyhf_device_t* device, uint32_t channel_count, uint32_t bandwidth_hz, airspyhf_channel_block_cb_fn callback, void* ctx)
+{
+	int result;
+	uint32_t i;
+	uint32_t capacity;
+	float cutoff;
+
+	if (device->streaming || channel_count < 2 || channel_count > CHANNELIZER_MAX_CHANNELS || (channel_count & (channel_count - 1)) != 0)
+	{
+		return AIRSPYHF_ERROR;
+	}
+
+	// Channels are critically sampled, a wider filter would only alias
+	if (bandwidth_hz == 0 || bandwidth_hz > device->current_samplerate / channel_count)
+	{
+		bandwidth_hz = device->current_samplerate / channel_count;
+	}
+	cutoff = 0.5f * bandwidth_hz / device->current_samplerate;
+
+	free_channelizer(device);
+
+	device->channelizer = pfb_channelizer_create((int) channel_count, cutoff);
+	device->channel_buffers = (airspyhf_complex_float_t **) malloc(channel_count * sizeof(airspyhf_complex_float_t *));
+	if (device->channelizer == NULL || device->channel_buffers == NULL)
+	{
+		free(device->channel_buffers);
+		device->channel_buffers = NULL;
+		free_channelizer(device);
+		return AIRSPYHF_ERROR;
+	}
+
+	capacity = airspyhf_get_output_size(device) / channel_count + 1;
+	device->channel_buffers[0] = (airspyhf_complex_float_t *) malloc(channel_count * capacity * sizeof(airspyhf_complex_float_t));
+	if (device->channel_buffers[0] == NULL)
+	{
+		free_channelizer(device);
+		return AIRSPYHF_ERROR;
+	}
+
+	for (i = 1; i < channel_count; i++)
+	{
+		device->channel_buffers[i] = device->channel_buffers[0] + i * capacity;
+	}
+
+	device->channelizer_channel_count = channel_count;
+	device->channel_callback = callback;
+
+	result = airspyhf_start(device, channelizer_callback, ctx);
+	if (result != AIRSPYHF_SUCCESS && !device->streaming)
+	{
+		free_channelizer(device);
+	}
+
+	return result;
+}
+
 int ADDCALL airspyhf_stop(airspyhf_device_t* device)
 {
 	int result1, result2;
 	result1 = kill_io_threads(device);
 	result2 = airspyhf_set_receiver_mode(device, RECEIVER_MODE_OFF);
 	libusb_interrupt_event_handler(device->usb_context);
+	free_channelizer(device);
 
 	if (result2 != AIRSPYHF_SUCCESS)
 	{
@@ -1257,6 +1717,89 @@ int ADDCALL airspyhf_stop(airspyhf_device_t* device)
 	return result1;
 }
 
+static iq_calibration_entry_t *find_iq_calibration(airspyhf_device_t* device, uint32_t band, uint16_t gain_state, bool insert)
+{
+	uint32_t i;
+	uint32_t slot;
+	iq_calibration_entry_t *entry;
+
+	if (device->iq_calibration_table == NULL)
+	{
+		return NULL;
+	}
+
+	slot = (band * 2654435761u) ^ gain_state;
+
+	for (i = 0; i < IQ_CALIBRATION_TABLE_SIZE; i++)
+	{
+		entry = &device->iq_calibration_table[(slot + i) & (IQ_CALIBRATION_TABLE_SIZE - 1)];
+
+		if (!entry->used)
+		{
+			if (!insert)
+			{
+				return NULL;
+			}
+			entry->used = 1;
+			entry->band = band;
+			entry->gain_state = gain_state;
+			return entry;
+		}
+
+		if (entry->band == band && entry->gain_state == gain_state)
+		{
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void switch_iq_calibration(airspyhf_device_t* device)
+{
+	float phase;
+	float amplitude;
+	uint32_t band;
+	uint16_t gain_state;
+	iq_calibration_entry_t *entry;
+
+	if (!device->iq_calibration_enabled)
+	{
+		return;
+	}
+
+	band = device->freq_hz / IQ_CALIBRATION_BAND_HZ;
+	gain_state = (uint16_t) ((device->hf_agc << 8) | (device->hf_lna << 4) | device->hf_att);
+
+	if (band == device->iq_calibration_band && gain_state == device->iq_calibration_gain_state)
+	{
+		return;
+	}
+
+	// Keep what the balancer learned since the last switch
+	if (iq_balancer_get_coefficients(device->iq_balancer, &phase, &amplitude) > 0)
+	{
+		entry = find_iq_calibration(device, device->iq_calibration_band, device->iq_calibration_gain_state, true);
+		if (entry != NULL)
+		{
+			entry->phase = phase;
+			entry->amplitude = amplitude;
+		}
+	}
+
+	entry = find_iq_calibration(device, band, gain_state, false);
+	if (entry != NULL)
+	{
+		phase = entry->phase;
+		amplitude = entry->amplitude;
+	}
+
+	iq_balancer_set_coefficients(device->iq_balancer, phase, amplitude);
+
+	device->iq_calibration_band = band;
+	device->iq_calibration_gain_state = gain_state;
+}
+
 int ADDCALL airspyhf_set_freq(airspyhf_device_t* device, const uint32_t freq_hz)
 {
 	const int tuning_alignment = 1000;
@@ -1298,6 +1841,8 @@ int ADDCALL airspyhf_set_freq(airspyhf_device_t* device, const uint32_t freq_hz)
 	device->freq_hz = freq_hz;
 	device->freq_shift = adjusted_freq_hz - freq_khz * 1000;
 
+	switch_iq_calibration(device);
+
 	return AIRSPYHF_SUCCESS;
 }
 
@@ -1402,6 +1947,122 @@ int ADDCALL airspyhf_iq_balancer_configure(airspyhf_device_t* device, int buffer
 	return AIRSPYHF_SUCCESS;
 }
 
+int ADDCALL airspyhf_set_iq_calibration_cache(airspyhf_device_t* device, uint8_t flag)
+{
+	device->iq_calibration_enabled = flag;
+	return AIRSPYHF_SUCCESS;
+}
+
+int ADDCALL airspyhf_save_iq_calibration(airspyhf_device_t* device, const char* path)
+{
+	FILE *file;
+	uint32_t i;
+	uint32_t header[2];
+	float phase;
+	float amplitude;
+	iq_calibration_entry_t *entry;
+
+	if (device->iq_calibration_table == NULL)
+	{
+		return AIRSPYHF_ERROR;
+	}
+
+	// Fold in the estimate for the current band before writing it out
+	if (iq_balancer_get_coefficients(device->iq_balancer, &phase, &amplitude) > 0)
+	{
+		entry = find_iq_calibration(device, device->iq_calibration_band, device->iq_calibration_gain_state, true);
+		if (entry != NULL)
+		{
+			entry->phase = phase;
+			entry->amplitude = amplitude;
+		}
+	}
+
+	file = fopen(path, "wb");
+	if (file == NULL)
+	{
+		return AIRSPYHF_ERROR;
+	}
+
+	header[0] = IQ_CALIBRATION_MAGIC;
+	header[1] = 0;
+	for (i = 0; i < IQ_CALIBRATION_TABLE_SIZE; i++)
+	{
+		header[1] += device->iq_calibration_table[i].used;
+	}
+
+	if (fwrite(header, sizeof(header), 1, file) != 1)
+	{
+		fclose(file);
+		return AIRSPYHF_ERROR;
+	}
+
+	for (i = 0; i < IQ_CALIBRATION_TABLE_SIZE; i++)
+	{
+		entry = &device->iq_calibration_table[i];
+		if (entry->used && fwrite(entry, sizeof(iq_calibration_entry_t), 1, file) != 1)
+		{
+			fclose(file);
+			return AIRSPYHF_ERROR;
+		}
+	}
+
+	return fclose(file) == 0 ? AIRSPYHF_SUCCESS : AIRSPYHF_ERROR;
+}
+
+int ADDCALL airspyhf_load_iq_calibration(airspyhf_device_t* device, const char* path)
+{
+	FILE *file;
+	uint32_t i;
+	uint32_t header[2];
+	iq_calibration_entry_t record;
+	iq_calibration_entry_t *entry;
+
+	if (device->iq_calibration_table == NULL)
+	{
+		return AIRSPYHF_ERROR;
+	}
+
+	file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return AIRSPYHF_ERROR;
+	}
+
+	if (fread(header, sizeof(header), 1, file) != 1 || header[0] != IQ_CALIBRATION_MAGIC)
+	{
+		fclose(file);
+		return AIRSPYHF_ERROR;
+	}
+
+	for (i = 0; i < header[1]; i++)
+	{
+		if (fread(&record, sizeof(record), 1, file) != 1)
+		{
+			fclose(file);
+			return AIRSPYHF_ERROR;
+		}
+
+		entry = find_iq_calibration(device, record.band, record.gain_state, true);
+		if (entry != NULL)
+		{
+			entry->phase = record.phase;
+			entry->amplitude = record.amplitude;
+		}
+	}
+
+	fclose(file);
+
+	// Apply the loaded values to the current band right away
+	entry = find_iq_calibration(device, device->iq_calibration_band, device->iq_calibration_gain_state, false);
+	if (device->iq_calibration_enabled && entry != NULL)
+	{
+		iq_balancer_set_coefficients(device->iq_balancer, entry->phase, entry->amplitude);
+	}
+
+	return AIRSPYHF_SUCCESS;
+}
+
 int ADDCALL airspyhf_board_partid_serialno_read(airspyhf_device_t* device, airspyhf_read_partid_serialno_t* read_partid_serialno)
 {
 	uint8_t length;
@@ -1501,6 +2162,9 @@ int ADDCALL airspyhf_set_hf_agc(airspyhf_device_t* device, uint8_t flag)
 		return AIRSPYHF_ERROR;
 	}
 
+	device->hf_agc = flag;
+	switch_iq_calibration(device);
+
 	return AIRSPYHF_SUCCESS;
 }
 
@@ -1545,6 +2209,9 @@ int ADDCALL airspyhf_set_hf_att(airspyhf_device_t* device, uint8_t value)
 		return AIRSPYHF_ERROR;
 	}
 
+	device->hf_att = value;
+	switch_iq_calibration(device);
+
 	return AIRSPYHF_SUCCESS;
 }
 
@@ -1567,6 +2234,9 @@ int ADDCALL airspyhf_set_hf_lna(airspyhf_device_t* device, uint8_t flag)
 		return AIRSPYHF_ERROR;
 	}
 
+	device->hf_lna = flag;
+	switch_iq_calibration(device);
+
 	return AIRSPYHF_SUCCESS;
 }
 
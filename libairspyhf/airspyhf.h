@@ -119,6 +119,17 @@ typedef struct {
 
 typedef int (*airspyhf_sample_block_cb_fn) (airspyhf_transfer_t* transfer_fn);
 
+typedef struct {
+	airspyhf_device_t* device;
+	void* ctx;
+	airspyhf_complex_float_t** channels; /* Channel k is centered at k * samplerate / channel_count, the upper half holds the negative offsets */
+	int channel_count;
+	int sample_count; /* Per channel, at samplerate / channel_count */
+	uint64_t dropped_samples; /* At the input sample rate */
+} airspyhf_channel_transfer_t;
+
+typedef int (*airspyhf_channel_block_cb_fn) (airspyhf_channel_transfer_t* transfer_fn);
+
 extern ADDAPI void ADDCALL airspyhf_lib_version(airspyhf_lib_version_t* lib_version);
 extern ADDAPI int ADDCALL airspyhf_list_devices(uint64_t *serials, int count);
 extern ADDAPI int ADDCALL airspyhf_open(airspyhf_device_t** device);
@@ -126,7 +137,10 @@ extern ADDAPI int ADDCALL airspyhf_open_sn(airspyhf_device_t** device, uint64_t
 extern ADDAPI int ADDCALL airspyhf_open_fd(airspyhf_device_t** device, int fd);
 extern ADDAPI int ADDCALL airspyhf_close(airspyhf_device_t* device);
 extern ADDAPI int ADDCALL airspyhf_get_output_size(airspyhf_device_t* device); /* Returns the number of IQ samples to expect in the callback */
+extern ADDAPI int ADDCALL airspyhf_set_transfer_config(airspyhf_device_t* device, uint32_t transfer_count, uint32_t samples_per_transfer); /* streaming needs to be stopped. transfer_count: 1..256, samples_per_transfer: multiple of 128 up to 262144 */
+extern ADDAPI int ADDCALL airspyhf_set_callback_batch(airspyhf_device_t* device, uint32_t transfers_per_callback); /* streaming needs to be stopped. 1..256 transfers delivered as one contiguous callback block */
 extern ADDAPI int ADDCALL airspyhf_start(airspyhf_device_t* device, airspyhf_sample_block_cb_fn callback, void* ctx);
+extern ADDAPI int ADDCALL airspyhf_start_channelized(airspyhf_device_t* device, uint32_t channel_count, uint32_t bandwidth_hz, airspyhf_channel_block_cb_fn callback, void* ctx); /* channel_count: power of two 2..1024, bandwidth_hz: 0 = channel spacing */
 extern ADDAPI int ADDCALL airspyhf_stop(airspyhf_device_t* device);
 extern ADDAPI int ADDCALL airspyhf_is_streaming(airspyhf_device_t* device);
 extern ADDAPI int ADDCALL airspyhf_is_low_if(airspyhf_device_t* device); /* Tells if the current sample rate is Zero-IF (0) or Low-IF (1) */
@@ -138,6 +152,9 @@ extern ADDAPI int ADDCALL airspyhf_get_calibration(airspyhf_device_t* device, in
 extern ADDAPI int ADDCALL airspyhf_set_calibration(airspyhf_device_t* device, int32_t ppb);
 extern ADDAPI int ADDCALL airspyhf_set_optimal_iq_correction_point(airspyhf_device_t* device, float w);
 extern ADDAPI int ADDCALL airspyhf_iq_balancer_configure(airspyhf_device_t* device, int buffers_to_skip, int fft_integration, int fft_overlap, int correlation_integration);
+extern ADDAPI int ADDCALL airspyhf_set_iq_calibration_cache(airspyhf_device_t* device, uint8_t flag); /* 0 = off, 1 = on (default): restore the IQ correction learned per frequency band and gain state on retune */
+extern ADDAPI int ADDCALL airspyhf_save_iq_calibration(airspyhf_device_t* device, const char* path);
+extern ADDAPI int ADDCALL airspyhf_load_iq_calibration(airspyhf_device_t* device, const char* path);
 extern ADDAPI int ADDCALL airspyhf_flash_calibration(airspyhf_device_t* device);	/* streaming needs to be stopped */
 extern ADDAPI int ADDCALL airspyhf_board_partid_serialno_read(airspyhf_device_t* device, airspyhf_read_partid_serialno_t* read_partid_serialno);
 extern ADDAPI int ADDCALL airspyhf_version_string_read(airspyhf_device_t* device, char* version, uint8_t length);
@@ -0,0 +1,234 @@
+/*
+Copyright (c) 2026, the Airspy HF+ host library contributors
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of Airspy HF+ nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "channelizer.h"
+#include "iqfft.h"
+
+#ifndef MATH_PI
+#define MATH_PI 3.14159265359
+#endif
+
+#if defined(__GNUC__) && defined(__SSE2__)
+  #define USE_SSE2
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define USE_NEON
+  #include <arm_neon.h>
+#endif
+
+#define CHANNELIZER_CHUNK (4096)
+
+struct pfb_channelizer_t
+{
+	int channel_count;
+	int length;
+	int history_count;
+	// Reversed prototype with every tap repeated for the re and im lanes
+	float *kernel;
+	airspyhf_complex_float_t *history;
+	airspyhf_complex_float_t *branches;
+	struct iq_fft_t *fft;
+};
+
+static void design_prototype(float *h, int length, float cutoff)
+{
+	int i;
+	double x;
+	double w;
+	double sum = 0.0;
+	const double center = (length - 1) / 2.0;
+
+	for (i = 0; i < length; i++)
+	{
+		x = i - center;
+		w = 0.35875
+			- 0.48829 * cos(2.0 * MATH_PI * i / (length - 1))
+			+ 0.14128 * cos(4.0 * MATH_PI * i / (length - 1))
+			- 0.01168 * cos(6.0 * MATH_PI * i / (length - 1));
+		h[i] = (float) (w * (x == 0.0 ? 2.0 * cutoff : sin(2.0 * MATH_PI * cutoff * x) / (MATH_PI * x)));
+		sum += h[i];
+	}
+
+	for (i = 0; i < length; i++)
+	{
+		h[i] = (float) (h[i] / sum);
+	}
+}
+
+struct pfb_channelizer_t * pfb_channelizer_create(int channel_count, float cutoff)
+{
+	int i;
+	float *h;
+	struct pfb_channelizer_t *channelizer;
+
+	if (channel_count < 2 || channel_count > CHANNELIZER_MAX_CHANNELS || (channel_count & (channel_count - 1)) != 0)
+	{
+		return NULL;
+	}
+
+	channelizer = (struct pfb_channelizer_t *) calloc(1, sizeof(struct pfb_channelizer_t));
+	if (channelizer == NULL)
+	{
+		return NULL;
+	}
+
+	channelizer->channel_count = channel_count;
+	channelizer->length = channel_count * CHANNELIZER_TAPS_PER_CHANNEL;
+
+	h = (float *) malloc(channelizer->length * sizeof(float));
+	channelizer->kernel = (float *) malloc(channelizer->length * 2 * sizeof(float));
+	channelizer->history = (airspyhf_complex_float_t *) calloc(channelizer->length + CHANNELIZER_CHUNK, sizeof(airspyhf_complex_float_t));
+	channelizer->branches = (airspyhf_complex_float_t *) malloc(channel_count * sizeof(airspyhf_complex_float_t));
+	channelizer->fft = iq_fft_create(channel_count);
+
+	if (h == NULL || channelizer->kernel == NULL || channelizer->history == NULL || channelizer->branches == NULL || channelizer->fft == NULL)
+	{
+		free(h);
+		pfb_channelizer_destroy(channelizer);
+		return NULL;
+	}
+
+	design_prototype(h, channelizer->length, cutoff);
+
+	for (i = 0; i < channelizer->length; i++)
+	{
+		channelizer->kernel[i * 2] = h[channelizer->length - 1 - i];
+		channelizer->kernel[i * 2 + 1] = h[channelizer->length - 1 - i];
+	}
+
+	free(h);
+
+	// Zero history so that every channel_count inputs produce one output from the start
+	channelizer->history_count = channelizer->length - channel_count;
+
+	return channelizer;
+}
+
+/*
+ * Multiplies the window of the last length inputs by the reversed prototype
+ * and folds it into channel_count branch sums. acc[r] collects the taps
+ * r, r + M, r + 2M ... which all belong to the same polyphase branch.
+ */
+static void fold_window(const float *kernel, const float *window, float *acc, int channel_count)
+{
+	int j;
+	int q;
+	const int stride = channel_count * 2;
+
+#if defined(USE_SSE2)
+
+	for (j = 0; j < stride; j += 4)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (q = 0; q < CHANNELIZER_TAPS_PER_CHANNEL; q++)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(kernel + q * stride + j), _mm_loadu_ps(window + q * stride + j)));
+		}
+		_mm_storeu_ps(acc + j, sum);
+	}
+
+#elif defined(USE_NEON)
+
+	for (j = 0; j < stride; j += 4)
+	{
+		float32x4_t sum = vdupq_n_f32(0.0f);
+		for (q = 0; q < CHANNELIZER_TAPS_PER_CHANNEL; q++)
+		{
+			sum = vmlaq_f32(sum, vld1q_f32(kernel + q * stride + j), vld1q_f32(window + q * stride + j));
+		}
+		vst1q_f32(acc + j, sum);
+	}
+
+#else
+
+	for (j = 0; j < stride; j++)
+	{
+		float sum = 0.0f;
+		for (q = 0; q < CHANNELIZER_TAPS_PER_CHANNEL; q++)
+		{
+			sum += kernel[q * stride + j] * window[q * stride + j];
+		}
+		acc[j] = sum;
+	}
+
+#endif
+}
+
+int pfb_channelizer_process(struct pfb_channelizer_t *channelizer, const airspyhf_complex_float_t *input, int count, airspyhf_complex_float_t **channels)
+{
+	int k;
+	int pos;
+	int chunk;
+	int produced = 0;
+	const int channel_count = channelizer->channel_count;
+	const int length = channelizer->length;
+	airspyhf_complex_float_t *branches = channelizer->branches;
+	airspyhf_complex_float_t last;
+
+	while (count > 0)
+	{
+		chunk = count < CHANNELIZER_CHUNK ? count : CHANNELIZER_CHUNK;
+		memcpy(channelizer->history + channelizer->history_count, input, chunk * sizeof(airspyhf_complex_float_t));
+		channelizer->history_count += chunk;
+		input += chunk;
+		count -= chunk;
+
+		for (pos = 0; pos + length <= channelizer->history_count; pos += channel_count)
+		{
+			fold_window(channelizer->kernel, (const float *) (channelizer->history + pos), (float *) branches, channel_count);
+
+			// Branch r feeds FFT input (r + 1) mod M so that the forward
+			// transform yields channel k at bin k
+			last = branches[channel_count - 1];
+			memmove(branches + 1, branches, (channel_count - 1) * sizeof(airspyhf_complex_float_t));
+			branches[0] = last;
+
+			iq_fft_execute(channelizer->fft, branches);
+
+			for (k = 0; k < channel_count; k++)
+			{
+				channels[k][produced] = branches[k];
+			}
+			produced++;
+		}
+
+		channelizer->history_count -= pos;
+		memmove(channelizer->history, channelizer->history + pos, channelizer->history_count * sizeof(airspyhf_complex_float_t));
+	}
+
+	return produced;
+}
+
+void pfb_channelizer_destroy(struct pfb_channelizer_t *channelizer)
+{
+	if (channelizer != NULL)
+	{
+		free(channelizer->kernel);
+		free(channelizer->history);
+		free(channelizer->branches);
+		iq_fft_destroy(channelizer->fft);
+		free(channelizer);
+	}
+}
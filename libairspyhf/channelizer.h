@@ -0,0 +1,44 @@
+/*
+Copyright (c) 2026, the Airspy HF+ host library contributors
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of Airspy HF+ nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __CHANNELIZER_H__
+#define __CHANNELIZER_H__
+
+#include "airspyhf.h"
+
+#define CHANNELIZER_TAPS_PER_CHANNEL (16)
+#define CHANNELIZER_MAX_CHANNELS (1024)
+
+/*
+ * Critically sampled polyphase analysis filter bank.
+ * Channel k is centered at k / channel_count of the input rate and is
+ * decimated by channel_count.
+ */
+
+struct pfb_channelizer_t;
+
+/* Parameter channel_count shall be a power of two, cutoff is the one-sided bandwidth relative to the input rate */
+struct pfb_channelizer_t * pfb_channelizer_create(int channel_count, float cutoff);
+/* Returns the number of samples written to each channel, at most count / channel_count + 1 */
+int pfb_channelizer_process(struct pfb_channelizer_t *channelizer, const airspyhf_complex_float_t *input, int count, airspyhf_complex_float_t **channels);
+void pfb_channelizer_destroy(struct pfb_channelizer_t *channelizer);
+
+#endif
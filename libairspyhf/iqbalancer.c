@@ -25,8 +25,11 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "iqbalancer.h"
+#include "iqfft.h"
+#include "../common/sdr_atomic.h"
 
 #ifndef MATH_PI
 #define MATH_PI 3.14159265359
@@ -35,13 +38,21 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #define EPSILON 0.01f
 #define WorkingBufferLength (FFTBins * (1 + FFTIntegration / FFTOverlap))
 
+typedef union
+{
+	struct
+	{
+		float phase;
+		float amplitude;
+	} c;
+	uint64_t word;
+} coefficients_t;
+
 struct iq_balancer_t
 {
+	/* Estimator state, owned by the estimation thread */
 	float phase;
-	float last_phase;
-
 	float amplitude;
-	float last_amplitude;
 
 	float iavg;
 	float qavg;
@@ -70,6 +81,32 @@ struct iq_balancer_t
 	complex_t *corr_plus;
 	complex_t *working_buffer;
 	float *boost;
+
+	struct iq_fft_t *fft;
+
+	/* Correction state, owned by the caller of iq_balancer_process() */
+	float last_phase;
+	float last_amplitude;
+	float applied_phase;
+	float applied_amplitude;
+	complex_t *snapshot_buffer;
+
+	/*
+	 * Latest estimate, published as a single 64 bit word so the sample path
+	 * can read it without locking. Writers hold coefficients_mp, which keeps
+	 * estimate_count in step with the word.
+	 */
+	uint64_t coefficients;
+	uint64_t published;
+	uint32_t estimate_count;
+	pthread_mutex_t coefficients_mp;
+
+	pthread_t estimation_thread;
+	pthread_mutex_t estimation_mp;
+	pthread_cond_t estimation_cv;
+	pthread_mutex_t config_mp;
+	int snapshot_pending;
+	int stop_requested;
 };
 
 static uint8_t __lib_initialized = 0;
@@ -95,6 +132,12 @@ static void __init_library()
 			+ 0.14128f * cos(4.0 * MATH_PI * i / length)
 			- 0.01168f * cos(6.0 * MATH_PI * i / length)
 			);
+		// Alternating the sign moves DC to the center bin, which replaces the
+		// half swap the transform output would otherwise need
+		if (i & 1)
+		{
+			__fft_window[i] = -__fft_window[i];
+		}
 		__boost_window[i] = (float)(1.0 / BoostFactor + 1.0 / exp(pow(i * 2.0 / BinsToOptimize, 2.0)));
 	}
 
@@ -111,89 +154,6 @@ static void window(complex_t *buffer, int length)
 	}
 }
 
-static void fft(complex_t *buffer, int length)
-{
-	int nm1 = length - 1;
-	int nd2 = length / 2;
-	int i, j, jm1, k, l, m, le, le2, ip;
-	complex_t u, t, r;
-
-	m = 0;
-	i = length;
-	while (i > 1)
-	{
-		++m;
-		i = (i >> 1);
-	}
-
-	j = nd2;
-
-	for (i = 1; i < nm1; ++i)
-	{
-		if (i < j)
-		{
-			t = buffer[j];
-			buffer[j] = buffer[i];
-			buffer[i] = t;
-		}
-
-		k = nd2;
-
-		while (k <= j)
-		{
-			j = j - k;
-			k = k / 2;
-		}
-
-		j += k;
-	}
-
-	for (l = 1; l <= m; ++l)
-	{
-		le = 1 << l;
-		le2 = le / 2;
-
-		u.re = 1.0f;
-		u.im = 0.0f;
-
-		r.re = (float)cos(MATH_PI / le2);
-		r.im = (float)-sin(MATH_PI / le2);
-
-		for (j = 1; j <= le2; ++j)
-		{
-			jm1 = j - 1;
-
-			for (i = jm1; i <= nm1; i += le)
-			{
-				ip = i + le2;
-
-				t.re = u.re * buffer[ip].re - u.im * buffer[ip].im;
-				t.im = u.im * buffer[ip].re + u.re * buffer[ip].im;
-
-				buffer[ip].re = buffer[i].re - t.re;
-				buffer[ip].im = buffer[i].im - t.im;
-
-				buffer[i].re += t.re;
-				buffer[i].im += t.im;
-			}
-
-			t.re = u.re * r.re - u.im * r.im;
-			t.im = u.im * r.re + u.re * r.im;
-
-			u.re = t.re;
-			u.im = t.im;
-		}
-	}
-
-	for (i = 0; i < nd2; i++)
-	{
-		j = nd2 + i;
-		t = buffer[i];
-		buffer[i] = buffer[j];
-		buffer[j] = t;
-	}
-}
-
 static void cancel_dc(struct iq_balancer_t *iq_balancer, complex_t* iq, int length)
 {
 	int i;
@@ -271,7 +231,7 @@ static int compute_corr(struct iq_balancer_t *iq_balancer, complex_t* iq, comple
 		{
 			count++;
 			window(fftPtr, FFTBins);
-			fft(fftPtr, FFTBins);
+			iq_fft_execute(iq_balancer->fft, fftPtr);
 			for (i = EdgeBinsToSkip, j = FFTBins - EdgeBinsToSkip; i <= FFTBins - EdgeBinsToSkip; i++, j--)
 			{
 				cc = multiply_complex_complex(fftPtr + i, fftPtr + j);
@@ -439,11 +399,16 @@ static void adjust_phase_amplitude(struct iq_balancer_t *iq_balancer, complex_t*
 {
 	int i;
 	float scale = 1.0f / (length - 1);
+	coefficients_t coefficients;
+
+	coefficients.word = ATOMIC_LOAD64(&iq_balancer->coefficients);
+	iq_balancer->applied_phase = coefficients.c.phase;
+	iq_balancer->applied_amplitude = coefficients.c.amplitude;
 
 	for (i = 0; i < length; i++)
 	{
-		float phase = (i * iq_balancer->last_phase + (length - 1 - i) * iq_balancer->phase) * scale;
-		float amplitude = (i * iq_balancer->last_amplitude + (length - 1 - i) * iq_balancer->amplitude) * scale;
+		float phase = (i * iq_balancer->last_phase + (length - 1 - i) * iq_balancer->applied_phase) * scale;
+		float amplitude = (i * iq_balancer->last_amplitude + (length - 1 - i) * iq_balancer->applied_amplitude) * scale;
 
 		float re = iq[i].re;
 		float im = iq[i].im;
@@ -455,8 +420,105 @@ static void adjust_phase_amplitude(struct iq_balancer_t *iq_balancer, complex_t*
 		iq[i].im *= 1 - amplitude;
 	}
 
-	iq_balancer->last_phase = iq_balancer->phase;
-	iq_balancer->last_amplitude = iq_balancer->amplitude;
+	iq_balancer->last_phase = iq_balancer->applied_phase;
+	iq_balancer->last_amplitude = iq_balancer->applied_amplitude;
+}
+
+static void adopt_coefficients(struct iq_balancer_t *iq_balancer)
+{
+	coefficients_t coefficients;
+
+	coefficients.word = ATOMIC_LOAD64(&iq_balancer->coefficients);
+	if (coefficients.word == iq_balancer->published)
+	{
+		return;
+	}
+
+	// Restored by iq_balancer_set_coefficients(): restart the lookback from there
+	iq_balancer->phase = coefficients.c.phase;
+	iq_balancer->amplitude = coefficients.c.amplitude;
+	iq_balancer->raw_phases[0] = coefficients.c.phase;
+	iq_balancer->raw_amplitudes[0] = coefficients.c.amplitude;
+	iq_balancer->no_of_raw = 1;
+	iq_balancer->raw_ptr = 1;
+	iq_balancer->published = coefficients.word;
+}
+
+static void publish_coefficients(struct iq_balancer_t *iq_balancer)
+{
+	coefficients_t coefficients;
+	uint64_t expected = iq_balancer->published;
+
+	coefficients.c.phase = iq_balancer->phase;
+	coefficients.c.amplitude = iq_balancer->amplitude;
+
+	if (coefficients.word == expected)
+	{
+		return;
+	}
+
+	// If a restore landed during the estimation pass the estimate is dropped
+	// in favour of the restored values
+	pthread_mutex_lock(&iq_balancer->coefficients_mp);
+	if (iq_balancer->coefficients == expected)
+	{
+		ATOMIC_STORE64(&iq_balancer->coefficients, coefficients.word);
+		iq_balancer->estimate_count++;
+		iq_balancer->published = coefficients.word;
+	}
+	pthread_mutex_unlock(&iq_balancer->coefficients_mp);
+}
+
+static void* estimation_threadproc(void *arg)
+{
+	struct iq_balancer_t *iq_balancer = (struct iq_balancer_t *) arg;
+
+	pthread_mutex_lock(&iq_balancer->estimation_mp);
+
+	while (!iq_balancer->stop_requested)
+	{
+		if (!iq_balancer->snapshot_pending)
+		{
+			pthread_cond_wait(&iq_balancer->estimation_cv, &iq_balancer->estimation_mp);
+			continue;
+		}
+
+		pthread_mutex_unlock(&iq_balancer->estimation_mp);
+
+		pthread_mutex_lock(&iq_balancer->config_mp);
+		adopt_coefficients(iq_balancer);
+		estimate_imbalance(iq_balancer, iq_balancer->snapshot_buffer, WorkingBufferLength);
+		publish_coefficients(iq_balancer);
+		pthread_mutex_unlock(&iq_balancer->config_mp);
+
+		pthread_mutex_lock(&iq_balancer->estimation_mp);
+		ATOMIC_STORE(&iq_balancer->snapshot_pending, 0);
+	}
+
+	pthread_mutex_unlock(&iq_balancer->estimation_mp);
+
+	return NULL;
+}
+
+static void submit_snapshot(struct iq_balancer_t *iq_balancer)
+{
+	complex_t *buffer;
+
+	// The estimator is still busy with the previous snapshot: skip this one
+	// rather than stall the stream
+	if (ATOMIC_LOAD(&iq_balancer->snapshot_pending))
+	{
+		return;
+	}
+
+	buffer = iq_balancer->snapshot_buffer;
+	iq_balancer->snapshot_buffer = iq_balancer->working_buffer;
+	iq_balancer->working_buffer = buffer;
+
+	pthread_mutex_lock(&iq_balancer->estimation_mp);
+	ATOMIC_STORE(&iq_balancer->snapshot_pending, 1);
+	pthread_cond_signal(&iq_balancer->estimation_cv);
+	pthread_mutex_unlock(&iq_balancer->estimation_mp);
 }
 
 void ADDCALL iq_balancer_process(struct iq_balancer_t *iq_balancer, complex_t* iq, int length)
@@ -479,13 +541,42 @@ void ADDCALL iq_balancer_process(struct iq_balancer_t *iq_balancer, complex_t* i
 		if (++iq_balancer->skipped_buffers > iq_balancer->buffers_to_skip)
 		{
 			iq_balancer->skipped_buffers = 0;
-			estimate_imbalance(iq_balancer, iq_balancer->working_buffer, WorkingBufferLength);
+			submit_snapshot(iq_balancer);
 		}
 	}
 
 	adjust_phase_amplitude(iq_balancer, iq, length);
 }
 
+int ADDCALL iq_balancer_get_coefficients(struct iq_balancer_t *iq_balancer, float *phase, float *amplitude)
+{
+	coefficients_t coefficients;
+	int estimate_count;
+
+	pthread_mutex_lock(&iq_balancer->coefficients_mp);
+	coefficients.word = iq_balancer->coefficients;
+	estimate_count = (int) iq_balancer->estimate_count;
+	pthread_mutex_unlock(&iq_balancer->coefficients_mp);
+
+	*phase = coefficients.c.phase;
+	*amplitude = coefficients.c.amplitude;
+
+	return estimate_count;
+}
+
+void ADDCALL iq_balancer_set_coefficients(struct iq_balancer_t *iq_balancer, float phase, float amplitude)
+{
+	coefficients_t coefficients;
+
+	coefficients.c.phase = phase;
+	coefficients.c.amplitude = amplitude;
+
+	pthread_mutex_lock(&iq_balancer->coefficients_mp);
+	iq_balancer->estimate_count = 0;
+	ATOMIC_STORE64(&iq_balancer->coefficients, coefficients.word);
+	pthread_mutex_unlock(&iq_balancer->coefficients_mp);
+}
+
 void ADDCALL iq_balancer_set_optimal_point(struct iq_balancer_t *iq_balancer, float w)
 {
 	if (w < -0.5f)
@@ -497,12 +588,16 @@ void ADDCALL iq_balancer_set_optimal_point(struct iq_balancer_t *iq_balancer, fl
 		w = 0.5f;
 	}
 
+	pthread_mutex_lock(&iq_balancer->config_mp);
 	iq_balancer->optimal_bin = (int)floor(FFTBins * (0.5 + w));
 	iq_balancer->reset_flag = 1;
+	pthread_mutex_unlock(&iq_balancer->config_mp);
 }
 
 void ADDCALL iq_balancer_configure(struct iq_balancer_t *iq_balancer, int buffers_to_skip, int fft_integration, int fft_overlap, int correlation_integration)
 {
+	pthread_mutex_lock(&iq_balancer->config_mp);
+
 	iq_balancer->buffers_to_skip = buffers_to_skip;
 	iq_balancer->fft_integration = fft_integration;
 	iq_balancer->fft_overlap = fft_overlap;
@@ -513,6 +608,8 @@ void ADDCALL iq_balancer_configure(struct iq_balancer_t *iq_balancer, int buffer
 	memset(iq_balancer->power_flag, 0, iq_balancer->fft_integration * sizeof(int));
 
 	iq_balancer->reset_flag = 1;
+
+	pthread_mutex_unlock(&iq_balancer->config_mp);
 }
 
 struct iq_balancer_t * ADDCALL iq_balancer_create(float initial_phase, float initial_amplitude)
@@ -522,6 +619,11 @@ struct iq_balancer_t * ADDCALL iq_balancer_create(float initial_phase, float ini
 
 	instance->phase = initial_phase;
 	instance->amplitude = initial_amplitude;
+	instance->applied_phase = initial_phase;
+	instance->applied_amplitude = initial_amplitude;
+	pthread_mutex_init(&instance->coefficients_mp, NULL);
+	iq_balancer_set_coefficients(instance, initial_phase, initial_amplitude);
+	instance->published = instance->coefficients;
 
 	instance->optimal_bin = FFTBins / 2;
 
@@ -533,19 +635,40 @@ struct iq_balancer_t * ADDCALL iq_balancer_create(float initial_phase, float ini
 	instance->corr = (complex_t *)malloc(FFTBins * sizeof(complex_t));
 	instance->corr_plus = (complex_t *)malloc(FFTBins * sizeof(complex_t));
 	instance->working_buffer = (complex_t *)malloc(WorkingBufferLength * sizeof(complex_t));
+	instance->snapshot_buffer = (complex_t *)malloc(WorkingBufferLength * sizeof(complex_t));
 	instance->boost = (float *)malloc(FFTBins * sizeof(float));
 	instance->power_flag = (int *)malloc(instance->fft_integration * sizeof(int));
+	instance->fft = iq_fft_create(FFTBins);
 
 	__init_library();
+
+	pthread_mutex_init(&instance->estimation_mp, NULL);
+	pthread_cond_init(&instance->estimation_cv, NULL);
+	pthread_mutex_init(&instance->config_mp, NULL);
+	pthread_create(&instance->estimation_thread, NULL, estimation_threadproc, instance);
+
 	return instance;
 }
 
 void ADDCALL iq_balancer_destroy(struct iq_balancer_t *iq_balancer)
 {
+	pthread_mutex_lock(&iq_balancer->estimation_mp);
+	iq_balancer->stop_requested = 1;
+	pthread_cond_signal(&iq_balancer->estimation_cv);
+	pthread_mutex_unlock(&iq_balancer->estimation_mp);
+	pthread_join(iq_balancer->estimation_thread, NULL);
+
+	pthread_mutex_destroy(&iq_balancer->estimation_mp);
+	pthread_cond_destroy(&iq_balancer->estimation_cv);
+	pthread_mutex_destroy(&iq_balancer->config_mp);
+	pthread_mutex_destroy(&iq_balancer->coefficients_mp);
+
 	free(iq_balancer->corr);
 	free(iq_balancer->corr_plus);
 	free(iq_balancer->working_buffer);
+	free(iq_balancer->snapshot_buffer);
 	free(iq_balancer->boost);
 	free(iq_balancer->power_flag);
+	iq_fft_destroy(iq_balancer->fft);
 	free(iq_balancer);
 }
@@ -43,7 +43,8 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #define MaxPowerRatio 0.8f
 #define BoostWindowNorm (MaxPowerRatio / 95)
 
-#if defined(__arm__) && !defined(__force_hiq__)
+/* The reduced settings are only kept for ARM targets without NEON */
+#if defined(__arm__) && !defined(__ARM_NEON) && !defined(__force_hiq__)
 	#define BuffersToSkip 4
 	#define FFTIntegration 2
 	#define FFTOverlap 1
@@ -62,6 +63,10 @@ typedef airspyhf_complex_float_t complex_t;
 ADDAPI struct iq_balancer_t * ADDCALL iq_balancer_create(float initial_phase, float initial_amplitude);
 ADDAPI void ADDCALL iq_balancer_set_optimal_point(struct iq_balancer_t *iq_balancer, float w);
 ADDAPI void ADDCALL iq_balancer_configure(struct iq_balancer_t *iq_balancer, int buffers_to_skip, int fft_integration, int fft_overlap, int correlation_integration);
+/* Returns the number of estimates published since the coefficients were last set */
+ADDAPI int ADDCALL iq_balancer_get_coefficients(struct iq_balancer_t *iq_balancer, float *phase, float *amplitude);
+/* Applies the coefficients immediately, the estimation then refines them */
+ADDAPI void ADDCALL iq_balancer_set_coefficients(struct iq_balancer_t *iq_balancer, float phase, float amplitude);
 ADDAPI void ADDCALL iq_balancer_process(struct iq_balancer_t *iq_balancer, complex_t* iq, int length);
 ADDAPI void ADDCALL iq_balancer_destroy(struct iq_balancer_t *iq_balancer);
 
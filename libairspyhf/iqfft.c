@@ -0,0 +1,274 @@
+/*
+Copyright (c) 2026, the Airspy HF+ host library contributors
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of Airspy HF+ nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "iqfft.h"
+
+#ifndef MATH_PI
+#define MATH_PI 3.14159265359
+#endif
+
+#if defined(HAVE_FFTW3F)
+  #include <fftw3.h>
+#elif defined(__GNUC__) && defined(__SSE2__)
+  #define USE_SSE2
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define USE_NEON
+  #include <arm_neon.h>
+#endif
+
+#if defined(HAVE_FFTW3F)
+
+struct iq_fft_t
+{
+	int length;
+	fftwf_plan plan;
+};
+
+struct iq_fft_t * iq_fft_create(int length)
+{
+	struct iq_fft_t *fft;
+	fftwf_complex *scratch;
+
+	fft = (struct iq_fft_t *) malloc(sizeof(struct iq_fft_t));
+	if (fft == NULL)
+	{
+		return NULL;
+	}
+
+	// FFTW_UNALIGNED allows the plan to be executed on any caller buffer
+	scratch = fftwf_alloc_complex(length);
+	fft->length = length;
+	fft->plan = fftwf_plan_dft_1d(length, scratch, scratch, FFTW_FORWARD, FFTW_ESTIMATE | FFTW_UNALIGNED);
+	fftwf_free(scratch);
+
+	if (fft->plan == NULL)
+	{
+		free(fft);
+		return NULL;
+	}
+
+	return fft;
+}
+
+void iq_fft_execute(struct iq_fft_t *fft, airspyhf_complex_float_t *buffer)
+{
+	fftwf_execute_dft(fft->plan, (fftwf_complex *) buffer, (fftwf_complex *) buffer);
+}
+
+void iq_fft_destroy(struct iq_fft_t *fft)
+{
+	if (fft != NULL)
+	{
+		fftwf_destroy_plan(fft->plan);
+		free(fft);
+	}
+}
+
+#else
+
+struct iq_fft_t
+{
+	int length;
+	int *bit_reverse;
+	// Twiddles of the stage with half-size h are stored at [h, 2h)
+	airspyhf_complex_float_t *twiddles;
+};
+
+struct iq_fft_t * iq_fft_create(int length)
+{
+	struct iq_fft_t *fft;
+	int i;
+	int j;
+	int bits;
+	int half;
+
+	fft = (struct iq_fft_t *) malloc(sizeof(struct iq_fft_t));
+	if (fft == NULL)
+	{
+		return NULL;
+	}
+
+	fft->length = length;
+	fft->bit_reverse = (int *) malloc(length * sizeof(int));
+	fft->twiddles = (airspyhf_complex_float_t *) malloc(length * sizeof(airspyhf_complex_float_t));
+
+	if (fft->bit_reverse == NULL || fft->twiddles == NULL)
+	{
+		iq_fft_destroy(fft);
+		return NULL;
+	}
+
+	for (bits = 0; (1 << bits) < length; bits++);
+
+	for (i = 0; i < length; i++)
+	{
+		fft->bit_reverse[i] = 0;
+		for (j = 0; j < bits; j++)
+		{
+			fft->bit_reverse[i] |= ((i >> j) & 1) << (bits - 1 - j);
+		}
+	}
+
+	fft->twiddles[0].re = 1.0f;
+	fft->twiddles[0].im = 0.0f;
+
+	for (half = 1; half < length; half <<= 1)
+	{
+		for (j = 0; j < half; j++)
+		{
+			fft->twiddles[half + j].re = (float) cos(MATH_PI * j / half);
+			fft->twiddles[half + j].im = (float) -sin(MATH_PI * j / half);
+		}
+	}
+
+	return fft;
+}
+
+static void butterflies(airspyhf_complex_float_t *buffer, int length, int half, const airspyhf_complex_float_t *w)
+{
+	int i;
+	int j;
+	float re;
+	float im;
+	airspyhf_complex_float_t *a;
+	airspyhf_complex_float_t *b;
+
+	for (i = 0; i < length; i += half * 2)
+	{
+		a = buffer + i;
+		b = a + half;
+		j = 0;
+
+#if defined(USE_SSE2)
+
+		const __m128 sign = _mm_castsi128_ps(_mm_set_epi32(0, (int) 0x80000000, 0, (int) 0x80000000));
+
+		for (; j <= half - 2; j += 2)
+		{
+			__m128 x = _mm_loadu_ps((float *) (b + j));
+			__m128 y = _mm_loadu_ps((const float *) (w + j));
+			__m128 y_re = _mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 2, 0, 0));
+			__m128 y_im = _mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 3, 1, 1));
+			__m128 x_sw = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+			__m128 t = _mm_add_ps(_mm_mul_ps(x, y_re), _mm_xor_ps(_mm_mul_ps(x_sw, y_im), sign));
+			__m128 u = _mm_loadu_ps((float *) (a + j));
+			_mm_storeu_ps((float *) (a + j), _mm_add_ps(u, t));
+			_mm_storeu_ps((float *) (b + j), _mm_sub_ps(u, t));
+		}
+
+#elif defined(USE_NEON)
+
+		for (; j <= half - 4; j += 4)
+		{
+			float32x4x2_t x = vld2q_f32((float *) (b + j));
+			float32x4x2_t y = vld2q_f32((const float *) (w + j));
+			float32x4x2_t u = vld2q_f32((float *) (a + j));
+			float32x4x2_t t;
+			t.val[0] = vmlsq_f32(vmulq_f32(x.val[0], y.val[0]), x.val[1], y.val[1]);
+			t.val[1] = vmlaq_f32(vmulq_f32(x.val[1], y.val[0]), x.val[0], y.val[1]);
+			x.val[0] = vaddq_f32(u.val[0], t.val[0]);
+			x.val[1] = vaddq_f32(u.val[1], t.val[1]);
+			u.val[0] = vsubq_f32(u.val[0], t.val[0]);
+			u.val[1] = vsubq_f32(u.val[1], t.val[1]);
+			vst2q_f32((float *) (a + j), x);
+			vst2q_f32((float *) (b + j), u);
+		}
+
+#endif
+
+		for (; j < half; j++)
+		{
+			re = b[j].re * w[j].re - b[j].im * w[j].im;
+			im = b[j].im * w[j].re + b[j].re * w[j].im;
+			b[j].re = a[j].re - re;
+			b[j].im = a[j].im - im;
+			a[j].re += re;
+			a[j].im += im;
+		}
+	}
+}
+
+void iq_fft_execute(struct iq_fft_t *fft, airspyhf_complex_float_t *buffer)
+{
+	int i;
+	int j;
+	int half;
+	const int length = fft->length;
+	airspyhf_complex_float_t t;
+	airspyhf_complex_float_t *p;
+	float r0, i0, r1, i1, r2, i2, r3, i3;
+
+	for (i = 0; i < length; i++)
+	{
+		j = fft->bit_reverse[i];
+		if (i < j)
+		{
+			t = buffer[i];
+			buffer[i] = buffer[j];
+			buffer[j] = t;
+		}
+	}
+
+	half = 1;
+
+	if (length >= 4)
+	{
+		// The first two stages only need the trivial twiddles 1 and -j
+		for (i = 0; i < length; i += 4)
+		{
+			p = buffer + i;
+
+			r0 = p[0].re + p[1].re; i0 = p[0].im + p[1].im;
+			r1 = p[0].re - p[1].re; i1 = p[0].im - p[1].im;
+			r2 = p[2].re + p[3].re; i2 = p[2].im + p[3].im;
+			r3 = p[2].re - p[3].re; i3 = p[2].im - p[3].im;
+
+			p[0].re = r0 + r2; p[0].im = i0 + i2;
+			p[2].re = r0 - r2; p[2].im = i0 - i2;
+			p[1].re = r1 + i3; p[1].im = i1 - r3;
+			p[3].re = r1 - i3; p[3].im = i1 + r3;
+		}
+
+		half = 4;
+	}
+
+	for (; half < length; half <<= 1)
+	{
+		butterflies(buffer, length, half, fft->twiddles + half);
+	}
+}
+
+void iq_fft_destroy(struct iq_fft_t *fft)
+{
+	if (fft != NULL)
+	{
+		free(fft->bit_reverse);
+		free(fft->twiddles);
+		free(fft);
+	}
+}
+
+#endif
@@ -0,0 +1,42 @@
+/*
+Copyright (c) 2026, the Airspy HF+ host library contributors
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+		Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+		Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the
+		documentation and/or other materials provided with the distribution.
+		Neither the name of Airspy HF+ nor the names of its contributors may be used to endorse or promote products derived from this software
+		without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __IQ_FFT_H__
+#define __IQ_FFT_H__
+
+#include "airspyhf.h"
+
+/*
+ * Forward complex FFT used by the IQ balancer.
+ * The built-in backend is a radix-2 transform with precomputed twiddles and
+ * SSE2/NEON butterflies. Define HAVE_FFTW3F and link against fftw3f to use
+ * FFTW instead.
+ */
+
+struct iq_fft_t;
+
+/* Parameter length shall be a power of two */
+struct iq_fft_t * iq_fft_create(int length);
+/* In-place forward transform, output in natural order */
+void iq_fft_execute(struct iq_fft_t *fft, airspyhf_complex_float_t *buffer);
+void iq_fft_destroy(struct iq_fft_t *fft);
+
+#endif
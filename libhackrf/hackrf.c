@@ -22,6 +22,8 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 */
 
 #include "hackrf.h"
+#include "sweep_engine.h"
+#include "iqconverter.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -37,6 +39,9 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #define strdup _strdup
 #endif
 #include <pthread.h>
+#include <sched.h>
+
+#include "../common/sdr_atomic.h"
 
 #ifndef bool
 typedef int bool;
@@ -111,9 +116,23 @@ typedef enum {
 	HACKRF_HW_SYNC_MODE_ON = 1,
 } hackrf_hw_sync_mode;
 
-#define TRANSFER_COUNT 4
-#define TRANSFER_BUFFER_SIZE 262144
+#define DEFAULT_TRANSFER_COUNT 4
+#define DEFAULT_TRANSFER_BUFFER_SIZE 262144
+#define MAX_TRANSFER_COUNT 64
+#define MAX_TRANSFER_BUFFER_SIZE (4 * 1024 * 1024)
+
+#define MAX_RX_RING_BUFFER_COUNT 256
+#define CONSUMER_SPIN_COUNT 16
+
+/* How long to wait for cancelled transfers to come back from libusb, in ms */
+#define TRANSFER_CANCEL_TIMEOUT 1000
+
+/* libusb_dev_mem_alloc() appeared in libusb 1.0.21 */
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+#define HAVE_LIBUSB_DEV_MEM
+#endif
 #define USB_MAX_SERIAL_LENGTH 32
+#define DEFAULT_SAMPLE_RATE 10000000.0
 
 struct hackrf_device {
 	libusb_device_handle* usb_device;
@@ -125,8 +144,46 @@ struct hackrf_device {
 	void* rx_ctx;
 	void* tx_ctx;
 	volatile bool do_exit;
-	unsigned char buffer[TRANSFER_COUNT * TRANSFER_BUFFER_SIZE];
+	unsigned char* buffer;
+	bool buffer_dev_mem; /* true if buffer comes from libusb_dev_mem_alloc() */
+	uint32_t transfer_count;
+	uint32_t transfer_buffer_size;
 	bool transfers_setup; /* true if the USB transfers have been setup */
+	uint32_t active_transfers; /* transfers owned by libusb, guarded by transfer_mp */
+	pthread_mutex_t transfer_mp;
+	double sample_rate;
+	/* Last hackrf_init_sweep() parameters, used by the sweep engine */
+	uint16_t sweep_frequency_list[MAX_SWEEP_RANGES * 2];
+	int sweep_num_ranges;
+	uint32_t sweep_step_width;
+	uint32_t sweep_offset;
+	enum sweep_style sweep_style;
+	struct hackrf_sweep_engine* sweep_engine;
+	/*
+	 * RX consumer thread mode, enabled when rx_ring_buffer_count is not 0.
+	 * enqueue_rx_transfer() publishes a ring slot by advancing rx_ring_head,
+	 * consumer_threadproc() releases it by advancing rx_ring_tail. The
+	 * mutex is only taken around the condition variable sleep.
+	 */
+	uint32_t rx_ring_buffer_count;
+	unsigned char* rx_ring_storage;
+	unsigned char** rx_ring_buffers;
+	int* rx_ring_lengths;
+	uint32_t* rx_ring_dropped;
+	volatile uint32_t rx_ring_head;
+	volatile uint32_t rx_ring_tail;
+	uint32_t dropped_buffers; /* only touched by the transfer callback */
+	bool consumer_active;
+	bool consumer_thread_started;
+	volatile bool consumer_stop;
+	volatile uint32_t consumer_waiting;
+	pthread_t consumer_thread;
+	pthread_mutex_t consumer_mp;
+	pthread_cond_t consumer_cv;
+	/* RX sample format conversion, active for hackrf_start_rx() only */
+	iqconverter_t* cnv;
+	bool convert_active;
+	unsigned char* output_buffer;
 };
 
 typedef struct {
@@ -205,20 +262,99 @@ static int transfers_check_setup(hackrf_device* device)
 static int cancel_transfers(hackrf_device* device)
 {
 	uint32_t transfer_index;
+	int result = HACKRF_ERROR_OTHER;
 
+	/* Taken by the callback too, so a completed transfer is not resubmitted behind our back */
+	pthread_mutex_lock(&device->transfer_mp);
 	if(transfers_check_setup(device) == true)
 	{
-		for(transfer_index=0; transfer_index<TRANSFER_COUNT; transfer_index++)
+		device->transfers_setup = false;
+		for(transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
 		{
 			if( device->transfers[transfer_index] != NULL )
 			{
 				libusb_cancel_transfer(device->transfers[transfer_index]);
 			}
 		}
-		device->transfers_setup = false;
-		return HACKRF_SUCCESS;
+		result = HACKRF_SUCCESS;
+	}
+	pthread_mutex_unlock(&device->transfer_mp);
+
+	return result;
+}
+
+/*
+ * Called from the transfer callback for a transfer that is not handed back
+ * to libusb.
+ */
+static void retire_transfer(hackrf_device* device)
+{
+	pthread_mutex_lock(&device->transfer_mp);
+	device->active_transfers--;
+	pthread_mutex_unlock(&device->transfer_mp);
+}
+
+/*
+ * Called from the transfer callback to hand a transfer back to libusb. Once
+ * cancel_transfers() has run the transfer is retired instead.
+ */
+static int resubmit_transfer(hackrf_device* device, struct libusb_transfer* usb_transfer)
+{
+	int error;
+	int result = HACKRF_SUCCESS;
+
+	pthread_mutex_lock(&device->transfer_mp);
+	if( device->transfers_setup )
+	{
+		error = libusb_submit_transfer(usb_transfer);
+		if( error != 0 )
+		{
+			last_libusb_error = error;
+			device->active_transfers--;
+			result = HACKRF_ERROR_LIBUSB;
+		}
 	} else {
-		return HACKRF_ERROR_OTHER;
+		device->active_transfers--;
+	}
+	pthread_mutex_unlock(&device->transfer_mp);
+
+	return result;
+}
+
+/*
+ * Wait until libusb has given back every transfer, so that they can be
+ * freed or submitted again. libusb only completes the cancellations from the
+ * transfer thread, this fails with HACKRF_ERROR_BUSY when that thread is not
+ * running, when called from it, or on timeout.
+ */
+static int wait_for_transfers(hackrf_device* device)
+{
+	uint32_t active;
+	int elapsed;
+
+	for(elapsed=0; ; elapsed++)
+	{
+		pthread_mutex_lock(&device->transfer_mp);
+		active = device->active_transfers;
+		pthread_mutex_unlock(&device->transfer_mp);
+
+		if( active == 0 )
+		{
+			return HACKRF_SUCCESS;
+		}
+
+		if( (elapsed >= TRANSFER_CANCEL_TIMEOUT) ||
+			(device->transfer_thread_started == false) || device->do_exit ||
+			pthread_equal(pthread_self(), device->transfer_thread) )
+		{
+			return HACKRF_ERROR_BUSY;
+		}
+
+#ifdef _WIN32
+		Sleep(1);
+#else
+		usleep(1000);
+#endif
 	}
 }
 
@@ -229,7 +365,7 @@ static int free_transfers(hackrf_device* device)
 	if( device->transfers != NULL )
 	{
 		// libusb_close() should free all transfers referenced from this array.
-		for(transfer_index=0; transfer_index<TRANSFER_COUNT; transfer_index++)
+		for(transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
 		{
 			if( device->transfers[transfer_index] != NULL )
 			{
@@ -240,6 +376,35 @@ static int free_transfers(hackrf_device* device)
 		free(device->transfers);
 		device->transfers = NULL;
 	}
+
+	if( device->buffer != NULL )
+	{
+#ifdef HAVE_LIBUSB_DEV_MEM
+		if( device->buffer_dev_mem )
+		{
+			libusb_dev_mem_free(device->usb_device, device->buffer,
+				(size_t)device->transfer_count * device->transfer_buffer_size);
+		} else
+#endif
+		{
+			free(device->buffer);
+		}
+		device->buffer = NULL;
+		device->buffer_dev_mem = false;
+	}
+
+	free(device->output_buffer);
+	device->output_buffer = NULL;
+
+	/* Ring and transfer buffers are swapped while streaming, both blocks are released together */
+	free(device->rx_ring_storage);
+	free(device->rx_ring_buffers);
+	free(device->rx_ring_lengths);
+	free(device->rx_ring_dropped);
+	device->rx_ring_storage = NULL;
+	device->rx_ring_buffers = NULL;
+	device->rx_ring_lengths = NULL;
+	device->rx_ring_dropped = NULL;
 	return HACKRF_SUCCESS;
 }
 
@@ -248,19 +413,45 @@ static int allocate_transfers(hackrf_device* const device)
 	if( device->transfers == NULL )
 	{
 		uint32_t transfer_index;
-		device->transfers = (struct libusb_transfer**) calloc(TRANSFER_COUNT, sizeof(struct libusb_transfer));
+		const size_t buffer_size = (size_t)device->transfer_count * device->transfer_buffer_size;
+
+		device->transfers = (struct libusb_transfer**) calloc(device->transfer_count, sizeof(struct libusb_transfer*));
 		if( device->transfers == NULL )
 		{
 			return HACKRF_ERROR_NO_MEM;
 		}
 
-		memset(device->buffer, 0, TRANSFER_COUNT * TRANSFER_BUFFER_SIZE);
+		/* On failure everything allocated so far is released again, see free_transfers() */
+
+		/*
+		 * Buffers mapped by the kernel avoid the copy between the USB
+		 * core and user space. Fall back to the heap when the platform
+		 * does not support it.
+		 */
+		device->buffer = NULL;
+		device->buffer_dev_mem = false;
+#ifdef HAVE_LIBUSB_DEV_MEM
+		device->buffer = libusb_dev_mem_alloc(device->usb_device, buffer_size);
+		device->buffer_dev_mem = device->buffer != NULL;
+#endif
+		if( device->buffer == NULL )
+		{
+			device->buffer = (unsigned char*) malloc(buffer_size);
+			if( device->buffer == NULL )
+			{
+				free_transfers(device);
+				return HACKRF_ERROR_NO_MEM;
+			}
+		}
+
+		memset(device->buffer, 0, buffer_size);
 
-		for(transfer_index=0; transfer_index<TRANSFER_COUNT; transfer_index++)
+		for(transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
 		{
 			device->transfers[transfer_index] = libusb_alloc_transfer(0);
 			if( device->transfers[transfer_index] == NULL )
 			{
+				free_transfers(device);
 				return HACKRF_ERROR_LIBUSB;
 			}
 
@@ -268,8 +459,8 @@ static int allocate_transfers(hackrf_device* const device)
 				device->transfers[transfer_index],
 				device->usb_device,
 				0,
-				&device->buffer[transfer_index * TRANSFER_BUFFER_SIZE],
-				TRANSFER_BUFFER_SIZE,
+				&device->buffer[(size_t)transfer_index * device->transfer_buffer_size],
+				device->transfer_buffer_size,
 				NULL,
 				device,
 				0
@@ -277,9 +468,29 @@ static int allocate_transfers(hackrf_device* const device)
 
 			if( device->transfers[transfer_index]->buffer == NULL )
 			{
+				free_transfers(device);
 				return HACKRF_ERROR_NO_MEM;
 			}
 		}
+
+		if( device->rx_ring_buffer_count > 0 )
+		{
+			device->rx_ring_storage = (unsigned char*) malloc((size_t)device->rx_ring_buffer_count * device->transfer_buffer_size);
+			device->rx_ring_buffers = (unsigned char**) calloc(device->rx_ring_buffer_count, sizeof(unsigned char*));
+			device->rx_ring_lengths = (int*) calloc(device->rx_ring_buffer_count, sizeof(int));
+			device->rx_ring_dropped = (uint32_t*) calloc(device->rx_ring_buffer_count, sizeof(uint32_t));
+			if( (device->rx_ring_storage == NULL) || (device->rx_ring_buffers == NULL) ||
+				(device->rx_ring_lengths == NULL) || (device->rx_ring_dropped == NULL) )
+			{
+				free_transfers(device);
+				return HACKRF_ERROR_NO_MEM;
+			}
+
+			for(transfer_index=0; transfer_index<device->rx_ring_buffer_count; transfer_index++)
+			{
+				device->rx_ring_buffers[transfer_index] = &device->rx_ring_storage[(size_t)transfer_index * device->transfer_buffer_size];
+			}
+		}
 		return HACKRF_SUCCESS;
 	} else {
 		return HACKRF_ERROR_BUSY;
@@ -295,7 +506,10 @@ static int prepare_transfers(
 	uint32_t transfer_index;
 	if( device->transfers != NULL )
 	{
-		for(transfer_index=0; transfer_index<TRANSFER_COUNT; transfer_index++)
+		/* Transfers completing before the loop is done wait for the lock in resubmit_transfer() */
+		pthread_mutex_lock(&device->transfer_mp);
+		device->transfers_setup = true;
+		for(transfer_index=0; transfer_index<device->transfer_count; transfer_index++)
 		{
 			device->transfers[transfer_index]->endpoint = endpoint_address;
 			device->transfers[transfer_index]->callback = callback;
@@ -304,10 +518,17 @@ static int prepare_transfers(
 			if( error != 0 )
 			{
 				last_libusb_error = error;
+				device->transfers_setup = false;
+				while( transfer_index-- > 0 )
+				{
+					libusb_cancel_transfer(device->transfers[transfer_index]);
+				}
+				pthread_mutex_unlock(&device->transfer_mp);
 				return HACKRF_ERROR_LIBUSB;
 			}
+			device->active_transfers++;
 		}
-		device->transfers_setup = true;
+		pthread_mutex_unlock(&device->transfer_mp);
 		return HACKRF_SUCCESS;
 	} else {
 		// This shouldn't happen.
@@ -614,10 +835,32 @@ static int hackrf_open_setup(libusb_device_handle* usb_device, hackrf_device** d
 	lib_device->transfer_thread_started = false;
 	lib_device->streaming = false;
 	lib_device->do_exit = false;
-
+	lib_device->buffer = NULL;
+	lib_device->buffer_dev_mem = false;
+	lib_device->transfer_count = DEFAULT_TRANSFER_COUNT;
+	lib_device->transfer_buffer_size = DEFAULT_TRANSFER_BUFFER_SIZE;
+	lib_device->rx_ring_buffer_count = 0;
+	lib_device->consumer_active = false;
+	lib_device->consumer_thread_started = false;
+	lib_device->convert_active = false;
+	lib_device->output_buffer = NULL;
+	pthread_mutex_init(&lib_device->consumer_mp, NULL);
+	pthread_cond_init(&lib_device->consumer_cv, NULL);
+	lib_device->active_transfers = 0;
+	pthread_mutex_init(&lib_device->transfer_mp, NULL);
+	lib_device->sample_rate = DEFAULT_SAMPLE_RATE;
+	lib_device->sweep_num_ranges = 0;
+	lib_device->sweep_engine = NULL;
+
+	lib_device->cnv = iqconverter_create();
 	result = allocate_transfers(lib_device);
-	if( result != 0 )
+	if( (result != 0) || (lib_device->cnv == NULL) )
 	{
+		iqconverter_free(lib_device->cnv);
+		free_transfers(lib_device);
+		pthread_cond_destroy(&lib_device->consumer_cv);
+		pthread_mutex_destroy(&lib_device->consumer_mp);
+		pthread_mutex_destroy(&lib_device->transfer_mp);
 		free(lib_device);
 		libusb_release_interface(usb_device, 0);
 		libusb_close(usb_device);
@@ -626,6 +869,11 @@ static int hackrf_open_setup(libusb_device_handle* usb_device, hackrf_device** d
 
 	result = create_transfer_thread(lib_device);
 	if (result != 0) {
+		iqconverter_free(lib_device->cnv);
+		free_transfers(lib_device);
+		pthread_cond_destroy(&lib_device->consumer_cv);
+		pthread_mutex_destroy(&lib_device->consumer_mp);
+		pthread_mutex_destroy(&lib_device->transfer_mp);
 		free(lib_device);
 		libusb_release_interface(usb_device, 0);
 		libusb_close(usb_device);
@@ -1323,6 +1571,7 @@ int ADDCALL hackrf_set_sample_rate_manual(hackrf_device* device,
 		last_libusb_error = result;
 		return HACKRF_ERROR_LIBUSB;
 	} else {
+		device->sample_rate = (double)freq_hz / divider;
 		return hackrf_set_baseband_filter_bandwidth(device,
 				hackrf_compute_baseband_filter_bw((uint32_t)(0.75*freq_hz/divider)));
 	}
@@ -1561,11 +1810,217 @@ static void* transfer_threadproc(void* arg)
 	return NULL;
 }
 
+/*
+ * Convert an RX transfer to the configured sample type if needed and hand
+ * it to the user callback. Runs on whichever thread delivers RX data.
+ */
+static int deliver_transfer(hackrf_device* device, hackrf_transfer* transfer)
+{
+	int sample_size;
+
+	if( device->convert_active )
+	{
+		sample_size = iqconverter_sample_size(device->cnv->sample_type);
+		transfer->valid_length = iqconverter_process(device->cnv, (const int8_t*)transfer->buffer,
+			device->output_buffer, transfer->valid_length / 2);
+		transfer->buffer_length = transfer->buffer_length / 2 * sample_size;
+		transfer->buffer = device->output_buffer;
+	}
+
+	return device->callback(transfer);
+}
+
+/*
+ * Consumer thread mode: queue the filled buffer in exchange for a free ring
+ * slot and resubmit right away, the RX callback runs on the consumer thread.
+ */
+static void enqueue_rx_transfer(hackrf_device* device, struct libusb_transfer* usb_transfer)
+{
+	uint32_t head;
+	uint32_t index;
+	unsigned char* temp;
+
+	if( device->consumer_stop )
+	{
+		retire_transfer(device);
+		return;
+	}
+
+	head = device->rx_ring_head;
+
+	if( head - ATOMIC_LOAD(&device->rx_ring_tail) < device->rx_ring_buffer_count )
+	{
+		index = head & (device->rx_ring_buffer_count - 1);
+
+		temp = device->rx_ring_buffers[index];
+		device->rx_ring_buffers[index] = usb_transfer->buffer;
+		usb_transfer->buffer = temp;
+
+		device->rx_ring_lengths[index] = usb_transfer->actual_length;
+		device->rx_ring_dropped[index] = device->dropped_buffers;
+		device->dropped_buffers = 0;
+
+		ATOMIC_STORE(&device->rx_ring_head, head + 1);
+
+		if( ATOMIC_LOAD(&device->consumer_waiting) )
+		{
+			pthread_mutex_lock(&device->consumer_mp);
+			pthread_cond_signal(&device->consumer_cv);
+			pthread_mutex_unlock(&device->consumer_mp);
+		}
+	} else {
+		device->dropped_buffers++;
+	}
+
+	if( resubmit_transfer(device, usb_transfer) != HACKRF_SUCCESS )
+	{
+		request_exit(device);
+	}
+}
+
+static bool wait_for_rx_transfer(hackrf_device* device, uint32_t tail)
+{
+	int spin;
+
+	for(spin=0; spin<CONSUMER_SPIN_COUNT; spin++)
+	{
+		if( ATOMIC_LOAD(&device->rx_ring_head) != tail )
+		{
+			return true;
+		}
+
+		if( device->consumer_stop )
+		{
+			return false;
+		}
+
+		sched_yield();
+	}
+
+	pthread_mutex_lock(&device->consumer_mp);
+
+	ATOMIC_STORE(&device->consumer_waiting, 1);
+
+	while( (ATOMIC_LOAD(&device->rx_ring_head) == tail) && !device->consumer_stop )
+	{
+		pthread_cond_wait(&device->consumer_cv, &device->consumer_mp);
+	}
+
+	ATOMIC_STORE(&device->consumer_waiting, 0);
+
+	pthread_mutex_unlock(&device->consumer_mp);
+
+	return !device->consumer_stop;
+}
+
+static void* consumer_threadproc(void* arg)
+{
+	hackrf_device* device = (hackrf_device*)arg;
+	uint32_t tail;
+	uint32_t index;
+
+#ifdef _WIN32
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+#endif
+
+	while( !device->consumer_stop )
+	{
+		tail = device->rx_ring_tail;
+
+		if( !wait_for_rx_transfer(device, tail) )
+		{
+			break;
+		}
+
+		index = tail & (device->rx_ring_buffer_count - 1);
+
+		hackrf_transfer transfer = {
+			.device = device,
+			.buffer = device->rx_ring_buffers[index],
+			.buffer_length = (int)device->transfer_buffer_size,
+			.valid_length = device->rx_ring_lengths[index],
+			.rx_ctx = device->rx_ctx,
+			.tx_ctx = device->tx_ctx,
+			.dropped_samples = (uint64_t)device->rx_ring_dropped[index] * (device->transfer_buffer_size / 2)
+		};
+
+		if( deliver_transfer(device, &transfer) != 0 )
+		{
+			device->consumer_stop = true;
+			request_exit(device);
+		}
+
+		/* Its buffer becomes the spare enqueue_rx_transfer() hands to the next transfer */
+		ATOMIC_STORE(&device->rx_ring_tail, tail + 1);
+	}
+
+	return NULL;
+}
+
+static void stop_consumer_thread(hackrf_device* device)
+{
+	if( !device->consumer_thread_started )
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&device->consumer_mp);
+	device->consumer_stop = true;
+	pthread_cond_signal(&device->consumer_cv);
+	pthread_mutex_unlock(&device->consumer_mp);
+
+	/* Stopping from inside the RX callback, hackrf_close() joins the thread */
+	if( pthread_equal(pthread_self(), device->consumer_thread) )
+	{
+		return;
+	}
+
+	pthread_join(device->consumer_thread, NULL);
+	device->consumer_thread_started = false;
+	device->consumer_active = false;
+}
+
+static int start_consumer_thread(hackrf_device* device)
+{
+	device->consumer_active = false;
+
+	if( device->rx_ring_buffer_count == 0 )
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	/* Reap a consumer thread that was stopped from its own callback */
+	stop_consumer_thread(device);
+	if( device->consumer_thread_started )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	device->rx_ring_head = 0;
+	device->rx_ring_tail = 0;
+	device->dropped_buffers = 0;
+	device->consumer_waiting = 0;
+	device->consumer_stop = false;
+
+	if( pthread_create(&device->consumer_thread, 0, consumer_threadproc, device) != 0 )
+	{
+		return HACKRF_ERROR_THREAD;
+	}
+
+	device->consumer_thread_started = true;
+	device->consumer_active = true;
+	return HACKRF_SUCCESS;
+}
+
 static void LIBUSB_CALL hackrf_libusb_transfer_callback(struct libusb_transfer* usb_transfer)
 {
 	hackrf_device* device = (hackrf_device*)usb_transfer->user_data;
 
-	if(usb_transfer->status == LIBUSB_TRANSFER_COMPLETED)
+	if( (usb_transfer->status == LIBUSB_TRANSFER_COMPLETED) && device->consumer_active )
+	{
+		enqueue_rx_transfer(device, usb_transfer);
+	}
+	else if(usb_transfer->status == LIBUSB_TRANSFER_COMPLETED)
 	{
 		hackrf_transfer transfer = {
 			.device = device,
@@ -1573,27 +2028,31 @@ static void LIBUSB_CALL hackrf_libusb_transfer_callback(struct libusb_transfer*
 			.buffer_length = usb_transfer->length,
 			.valid_length = usb_transfer->actual_length,
 			.rx_ctx = device->rx_ctx,
-			.tx_ctx = device->tx_ctx
+			.tx_ctx = device->tx_ctx,
+			.dropped_samples = 0
 		};
 
-		if( device->callback(&transfer) == 0 )
+		if( deliver_transfer(device, &transfer) == 0 )
 		{
-			if( libusb_submit_transfer(usb_transfer) < 0)
+			if( resubmit_transfer(device, usb_transfer) != HACKRF_SUCCESS )
 			{
 				request_exit(device);
 			}else {
 				return;
 			}
 		}else {
+			retire_transfer(device);
 			request_exit(device);
 		}
 	} else if(usb_transfer->status == LIBUSB_TRANSFER_CANCELLED) {
-		/* Nothing; this will happen during shutdown */
+		/* This will happen during shutdown */
+		retire_transfer(device);
 	} else {
 		/* Other cases LIBUSB_TRANSFER_NO_DEVICE
 		LIBUSB_TRANSFER_ERROR, LIBUSB_TRANSFER_TIMED_OUT
 		LIBUSB_TRANSFER_STALL,	LIBUSB_TRANSFER_OVERFLOW ....
 		*/
+		retire_transfer(device);
 		request_exit(device); /* Fatal error stop transfer */
 		device->streaming = false;
 	}
@@ -1609,13 +2068,11 @@ static int kill_transfer_thread(hackrf_device* device)
 		/*
 		 * Schedule cancelling transfers before halting the
 		 * libusb thread.  This should result in the transfers
-		 * being properly marked as cancelled.
-		 *
-		 * Ideally this would wait for the cancellations to
-		 * complete with the callback but for now that
-		 * isn't super easy to do.
+		 * being properly marked as cancelled, wait for the
+		 * callback to see them before stopping the thread.
 		 */
 		cancel_transfers(device);
+		wait_for_transfers(device);
 
 		/*
 		 * Now call request_exit() to halt the main loop.
@@ -1652,6 +2109,13 @@ static int prepare_setup_transfers(hackrf_device* device,
 		return HACKRF_ERROR_BUSY;
 	}
 
+	/* The transfers of the previous run may still be on their way back */
+	result = wait_for_transfers(device);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+
 	device->callback = callback;
 	result = prepare_transfers(
 		device, endpoint_address,
@@ -1713,18 +2177,204 @@ int ADDCALL hackrf_is_streaming(hackrf_device* device)
 	}
 }
 
+/*
+ * Change the number and size of the USB transfers kept in flight while
+ * streaming. Must be called while neither RX nor TX is running.
+ *
+ * transfer_buffer_size must be a multiple of BYTES_PER_BLOCK.
+ */
+int ADDCALL hackrf_set_transfer_config(hackrf_device* device,
+                                       const uint32_t transfer_count,
+                                       const uint32_t transfer_buffer_size)
+{
+	const uint32_t old_transfer_count = device->transfer_count;
+	const uint32_t old_transfer_buffer_size = device->transfer_buffer_size;
+	int result;
+
+	if( device->streaming || device->transfers_setup || device->consumer_thread_started )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	if( (transfer_count < 1) || (transfer_count > MAX_TRANSFER_COUNT) ||
+		(transfer_buffer_size < BYTES_PER_BLOCK) || (transfer_buffer_size > MAX_TRANSFER_BUFFER_SIZE) ||
+		(transfer_buffer_size % BYTES_PER_BLOCK) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	result = wait_for_transfers(device);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+
+	free_transfers(device);
+	device->transfer_count = transfer_count;
+	device->transfer_buffer_size = transfer_buffer_size;
+
+	result = allocate_transfers(device);
+	if( result != HACKRF_SUCCESS )
+	{
+		/* Keep the previous configuration, hackrf_start_rx() fails if even that cannot be allocated */
+		device->transfer_count = old_transfer_count;
+		device->transfer_buffer_size = old_transfer_buffer_size;
+		allocate_transfers(device);
+	}
+	return result;
+}
+
+/*
+ * Select the sample format handed to the RX callback. Everything but
+ * HACKRF_SAMPLE_INT8_IQ is converted from the raw int8 stream by the
+ * library, which also makes DC removal and IQ correction available.
+ * Sweep mode always delivers raw samples.
+ *
+ * Must be called while neither RX nor TX is running.
+ */
+int ADDCALL hackrf_set_sample_type(hackrf_device* device, const enum hackrf_sample_type sample_type)
+{
+	if( device->streaming || device->transfers_setup )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	if( sample_type > HACKRF_SAMPLE_FLOAT32_IQ )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	device->cnv->sample_type = sample_type;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_dc_removal(hackrf_device* device, const uint8_t value)
+{
+	device->cnv->dc_removal = value ? 1 : 0;
+	return HACKRF_SUCCESS;
+}
+
+int ADDCALL hackrf_set_iq_correction(hackrf_device* device, const uint8_t value)
+{
+	device->cnv->iq_correction = value ? 1 : 0;
+	return HACKRF_SUCCESS;
+}
+
+static int prepare_conversion(hackrf_device* device)
+{
+	device->convert_active = false;
+
+	if( device->cnv->sample_type == HACKRF_SAMPLE_INT8_IQ )
+	{
+		return HACKRF_SUCCESS;
+	}
+
+	if( device->output_buffer == NULL )
+	{
+		device->output_buffer = (unsigned char*) malloc((size_t)device->transfer_buffer_size / 2 *
+			iqconverter_sample_size(HACKRF_SAMPLE_FLOAT32_IQ));
+		if( device->output_buffer == NULL )
+		{
+			return HACKRF_ERROR_NO_MEM;
+		}
+	}
+
+	iqconverter_reset(device->cnv);
+	device->convert_active = true;
+	return HACKRF_SUCCESS;
+}
+
+/*
+ * Run the RX callback on a dedicated consumer thread. The USB callback only
+ * swaps the filled buffer with a free one out of a ring of buffer_count
+ * transfer sized buffers and resubmits it. When the ring is full the
+ * transfer is dropped and reported in the next hackrf_transfer's
+ * dropped_samples. buffer_count must be a power of two, 0 restores the
+ * default of calling the RX callback from the USB thread.
+ *
+ * Must be called while neither RX nor TX is running.
+ */
+int ADDCALL hackrf_set_rx_consumer_thread(hackrf_device* device, const uint32_t buffer_count)
+{
+	const uint32_t old_buffer_count = device->rx_ring_buffer_count;
+	int result;
+
+	if( device->streaming || device->transfers_setup || device->consumer_thread_started )
+	{
+		return HACKRF_ERROR_BUSY;
+	}
+
+	if( (buffer_count > MAX_RX_RING_BUFFER_COUNT) || (buffer_count & (buffer_count - 1)) )
+	{
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	result = wait_for_transfers(device);
+	if( result != HACKRF_SUCCESS )
+	{
+		return result;
+	}
+
+	free_transfers(device);
+	device->rx_ring_buffer_count = buffer_count;
+
+	result = allocate_transfers(device);
+	if( result != HACKRF_SUCCESS )
+	{
+		device->rx_ring_buffer_count = old_buffer_count;
+		allocate_transfers(device);
+	}
+	return result;
+}
+
+/*
+ * Report the transfer configuration and the time the transfers in flight
+ * can absorb at the current sample rate before the device overruns.
+ */
+int ADDCALL hackrf_get_transfer_config(hackrf_device* device,
+                                       uint32_t* transfer_count,
+                                       uint32_t* transfer_buffer_size,
+                                       double* buffering_time)
+{
+	if( transfer_count != NULL )
+	{
+		*transfer_count = device->transfer_count;
+	}
+	if( transfer_buffer_size != NULL )
+	{
+		*transfer_buffer_size = device->transfer_buffer_size;
+	}
+	if( buffering_time != NULL )
+	{
+		/* Two bytes per complex sample */
+		*buffering_time = (double)(device->transfer_count + device->rx_ring_buffer_count) *
+			device->transfer_buffer_size / 2.0 / device->sample_rate;
+	}
+	return HACKRF_SUCCESS;
+}
+
 int ADDCALL hackrf_start_rx(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* rx_ctx)
 {
 	int result;
 	const uint8_t endpoint_address = LIBUSB_ENDPOINT_IN | 1;
 	device->rx_ctx = rx_ctx;
-	result = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_RECEIVE);
+	result = prepare_conversion(device);
+	if( result == HACKRF_SUCCESS )
+	{
+		result = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_RECEIVE);
+	}
+	if( result == HACKRF_SUCCESS )
+	{
+		result = start_consumer_thread(device);
+	}
 	if( result == HACKRF_SUCCESS )
 	{
 		result = prepare_setup_transfers(device, endpoint_address, callback);
 	}
 	if (result == HACKRF_SUCCESS) {
 		device->streaming = true;
+	} else {
+		stop_consumer_thread(device);
 	}
 	return result;
 }
@@ -1756,6 +2406,7 @@ int ADDCALL hackrf_stop_rx(hackrf_device* device)
 
 	device->streaming = false;
 	result = cancel_transfers(device);
+	stop_consumer_thread(device);
 	if (result != HACKRF_SUCCESS)
 	{
 		return result;
@@ -1768,6 +2419,8 @@ int ADDCALL hackrf_start_tx(hackrf_device* device, hackrf_sample_block_cb_fn cal
 {
 	int result;
 	const uint8_t endpoint_address = LIBUSB_ENDPOINT_OUT | 2;
+	device->consumer_active = false;
+	device->convert_active = false;
 	result = hackrf_set_transceiver_mode(device, HACKRF_TRANSCEIVER_MODE_TRANSMIT);
 	if( result == HACKRF_SUCCESS )
 	{
@@ -1831,6 +2484,16 @@ int ADDCALL hackrf_close(hackrf_device* device)
 		 * also cancel any pending transmit/receive transfers.
 		 */
 		result3 = kill_transfer_thread(device);
+		stop_consumer_thread(device);
+		if( device->consumer_thread_started )
+		{
+			/* hackrf_stop_rx() was called from the RX callback */
+			pthread_join(device->consumer_thread, NULL);
+		}
+
+		/* Device memory buffers must be released before the handle is closed */
+		free_transfers(device);
+
 		if( device->usb_device != NULL )
 		{
 			libusb_release_interface(device->usb_device, 0);
@@ -1838,7 +2501,12 @@ int ADDCALL hackrf_close(hackrf_device* device)
 			device->usb_device = NULL;
 		}
 
-		free_transfers(device);
+		hackrf_sweep_engine_destroy(device->sweep_engine);
+		iqconverter_free(device->cnv);
+
+		pthread_cond_destroy(&device->consumer_cv);
+		pthread_mutex_destroy(&device->consumer_mp);
+		pthread_mutex_destroy(&device->transfer_mp);
 
 		free(device);
 	}
@@ -2108,6 +2776,11 @@ int ADDCALL hackrf_init_sweep(hackrf_device* device,
 		last_libusb_error = result;
 		return HACKRF_ERROR_LIBUSB;
 	} else {
+		memcpy(device->sweep_frequency_list, frequency_list, num_ranges * 2 * sizeof(frequency_list[0]));
+		device->sweep_num_ranges = num_ranges;
+		device->sweep_step_width = step_width;
+		device->sweep_offset = offset;
+		device->sweep_style = style;
 		return HACKRF_SUCCESS;
 	}
 }
@@ -2499,18 +3172,69 @@ int ADDCALL hackrf_start_rx_sweep(hackrf_device* device, hackrf_sample_block_cb_
 	USB_API_REQUIRED(device, 0x0104)
 	int result;
 	const uint8_t endpoint_address = LIBUSB_ENDPOINT_IN | 1;
+	device->convert_active = false;
 	result = hackrf_set_transceiver_mode(device, TRANSCEIVER_MODE_RX_SWEEP);
 	if (HACKRF_SUCCESS == result)
 	{
 		device->rx_ctx = rx_ctx;
+		result = start_consumer_thread(device);
+	}
+	if (HACKRF_SUCCESS == result)
+	{
 		result = prepare_setup_transfers(device, endpoint_address, callback);
 	}
 	if (result == HACKRF_SUCCESS) {
 		device->streaming = true;
+	} else {
+		stop_consumer_thread(device);
 	}
 	return result;
 }
 
+static int sweep_spectrum_callback(hackrf_transfer* transfer)
+{
+	return hackrf_sweep_engine_process(transfer->device->sweep_engine, transfer);
+}
+
+int ADDCALL hackrf_start_rx_sweep_spectrum(hackrf_device* device, const uint32_t fft_size,
+		const enum hackrf_sweep_window window, hackrf_sweep_spectrum_cb_fn callback, void* rx_ctx)
+{
+	int result;
+
+	if (device->streaming || device->transfers_setup) {
+		return HACKRF_ERROR_BUSY;
+	}
+
+	if (device->sweep_num_ranges == 0 || callback == NULL || (fft_size & (fft_size - 1)) != 0 ||
+		fft_size < SWEEP_FFT_SIZE_MIN || fft_size > SWEEP_FFT_SIZE_MAX) {
+		return HACKRF_ERROR_INVALID_PARAM;
+	}
+
+	/*
+	 * hackrf_stop_rx() does not wait for a running callback, the previous
+	 * engine is only released once every transfer is back from libusb and
+	 * the consumer thread, if any, has exited.
+	 */
+	result = wait_for_transfers(device);
+	if (result != HACKRF_SUCCESS) {
+		return result;
+	}
+	stop_consumer_thread(device);
+	if (device->consumer_thread_started) {
+		return HACKRF_ERROR_BUSY;
+	}
+
+	hackrf_sweep_engine_destroy(device->sweep_engine);
+	device->sweep_engine = hackrf_sweep_engine_create(device->sweep_frequency_list, device->sweep_num_ranges,
+			device->sweep_step_width, device->sweep_offset, device->sweep_style, device->sample_rate,
+			fft_size, window, callback);
+	if (device->sweep_engine == NULL) {
+		return HACKRF_ERROR_NO_MEM;
+	}
+
+	return hackrf_start_rx_sweep(device, sweep_spectrum_callback, rx_ctx);
+}
+
 #ifdef __cplusplus
 } // __cplusplus defined.
 #endif
@@ -119,6 +119,12 @@ enum operacake_switching_mode {
 	OPERACAKE_MODE_TIME,
 };
 
+enum hackrf_sample_type {
+	HACKRF_SAMPLE_INT8_IQ = 0,    /**< raw samples as sent by the device */
+	HACKRF_SAMPLE_INT16_IQ = 1,
+	HACKRF_SAMPLE_FLOAT32_IQ = 2,
+};
+
 enum sweep_style {
 	LINEAR = 0,
 	INTERLEAVED = 1,
@@ -137,6 +143,7 @@ typedef struct {
 	int valid_length;      /**< number of buffer bytes that were transferred */
 	void* rx_ctx;          /**< RX libusb context */
 	void* tx_ctx;          /**< TX libusb context */
+	uint64_t dropped_samples; /**< RX samples lost before this transfer because the consumer thread fell behind */
 } hackrf_transfer;
 
 typedef struct {
@@ -168,6 +175,38 @@ typedef struct hackrf_device_list hackrf_device_list_t;
 
 typedef int (*hackrf_sample_block_cb_fn)(hackrf_transfer* transfer);
 
+enum hackrf_sweep_window {
+	HACKRF_SWEEP_WINDOW_RECTANGULAR = 0,
+	HACKRF_SWEEP_WINDOW_HANN = 1,
+	HACKRF_SWEEP_WINDOW_HAMMING = 2,
+	HACKRF_SWEEP_WINDOW_BLACKMAN_HARRIS = 3,
+};
+
+/**
+ * One of the hackrf_init_sweep() ranges inside a sweep spectrum.
+ */
+typedef struct {
+	uint64_t frequency_start; /**< center frequency of the first bin of the range, in Hz */
+	int bin_offset;           /**< index of the first bin of the range in the power array */
+	int bin_count;            /**< number of bins of the range */
+} hackrf_sweep_range;
+
+/**
+ * Power spectrum of one complete sweep passed to the sweep spectrum callback.
+ */
+typedef struct {
+	hackrf_device* device;                        /**< HackRF USB device for this sweep */
+	float* power;                                 /**< power per bin in dBFS, -INFINITY for bins no block covered */
+	int bin_count;                                /**< number of bins of all ranges */
+	double bin_width;                             /**< bin width in Hz */
+	hackrf_sweep_range ranges[MAX_SWEEP_RANGES];  /**< location of each range in the power array */
+	int range_count;                              /**< number of ranges */
+	uint64_t sweep_count;                         /**< number of sweeps delivered before this one */
+	void* rx_ctx;                                 /**< RX context */
+} hackrf_sweep_spectrum;
+
+typedef int (*hackrf_sweep_spectrum_cb_fn)(hackrf_sweep_spectrum* spectrum);
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -189,6 +228,19 @@ extern ADDAPI int ADDCALL hackrf_open_by_fd(hackrf_device** device, int fd);
 extern ADDAPI int ADDCALL hackrf_close(hackrf_device* device);
  
 extern ADDAPI int ADDCALL hackrf_start_rx(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* rx_ctx);
+
+/* Number and size in bytes of the USB transfers in flight, only while stopped. Size is a multiple of BYTES_PER_BLOCK */
+extern ADDAPI int ADDCALL hackrf_set_transfer_config(hackrf_device* device, const uint32_t transfer_count, const uint32_t transfer_buffer_size);
+/* Sample format of RX transfers, only while stopped. Formats other than HACKRF_SAMPLE_INT8_IQ are converted before the callback */
+extern ADDAPI int ADDCALL hackrf_set_sample_type(hackrf_device* device, const enum hackrf_sample_type sample_type);
+/* DC offset removal for converted sample types, bool on/off */
+extern ADDAPI int ADDCALL hackrf_set_dc_removal(hackrf_device* device, const uint8_t value);
+/* IQ gain and phase imbalance correction for converted sample types, bool on/off */
+extern ADDAPI int ADDCALL hackrf_set_iq_correction(hackrf_device* device, const uint8_t value);
+/* Deliver RX transfers on a consumer thread fed by a ring of buffer_count (power of two) buffers, 0 disables. Only while stopped */
+extern ADDAPI int ADDCALL hackrf_set_rx_consumer_thread(hackrf_device* device, const uint32_t buffer_count);
+/* Current transfer configuration and the time in seconds it buffers at the current sample rate, any pointer may be NULL */
+extern ADDAPI int ADDCALL hackrf_get_transfer_config(hackrf_device* device, uint32_t* transfer_count, uint32_t* transfer_buffer_size, double* buffering_time);
 extern ADDAPI int ADDCALL hackrf_stop_rx(hackrf_device* device);
  
 extern ADDAPI int ADDCALL hackrf_start_tx(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* tx_ctx);
@@ -299,6 +351,10 @@ extern ADDAPI int ADDCALL hackrf_cpld_checksum(hackrf_device* device,
 extern ADDAPI int ADDCALL hackrf_set_ui_enable(hackrf_device* device, const uint8_t value);
 extern ADDAPI int ADDCALL hackrf_start_rx_sweep(hackrf_device* device, hackrf_sample_block_cb_fn callback, void* rx_ctx);
 
+/* Sweep the hackrf_init_sweep() ranges and deliver one stitched power spectrum per sweep, fft_size is a power of two from 16 to 4096 */
+extern ADDAPI int ADDCALL hackrf_start_rx_sweep_spectrum(hackrf_device* device, const uint32_t fft_size,
+		const enum hackrf_sweep_window window, hackrf_sweep_spectrum_cb_fn callback, void* rx_ctx);
+
 #ifdef __cplusplus
 } // __cplusplus defined.
 #endif
@@ -0,0 +1,359 @@
+/*
+Copyright (c) 2012, Jared Boone <jared@sharebrained.com>
+Copyright (c) 2013, Benjamin Vernoux <titanmkd@gmail.com>
+Copyright (c) 2013, Michael Ossmann <mike@ossmann.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the 
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "iqconverter.h"
+
+#include <stdlib.h>
+#include <math.h>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+  #define USE_SSE2
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define USE_NEON
+  #include <arm_neon.h>
+#endif
+
+/* Smoothing of the per block DC and moment estimates */
+#define ESTIMATE_ALPHA 0.05f
+#define MIN_POWER 1e-9f
+
+/* Per block accumulators, indexed I, Q */
+typedef struct {
+	float sum[2];
+	float power[2];
+	float cross;
+} block_stats_t;
+
+static void process_generic(const iqconverter_t* cnv, const int8_t* src, float* dst, int16_t* dst16, int start, int count, block_stats_t* stats)
+{
+	int n;
+	float i, q, i0, q0;
+
+	for (n = start; n < count; n++)
+	{
+		i0 = src[n * 2] * (1.0f / 128.0f);
+		q0 = src[n * 2 + 1] * (1.0f / 128.0f);
+
+		stats->sum[0] += i0;
+		stats->sum[1] += q0;
+
+		i = i0 - cnv->dc_i;
+		q = q0 - cnv->dc_q;
+
+		stats->power[0] += i * i;
+		stats->power[1] += q * q;
+		stats->cross += i * q;
+
+		q = cnv->gain * (q - cnv->phase * i);
+
+		if (dst16 != NULL)
+		{
+			i = i * 32768.0f;
+			q = q * 32768.0f;
+			dst16[n * 2] = (int16_t)(i > 32767.0f ? 32767 : (i < -32768.0f ? -32768 : lrintf(i)));
+			dst16[n * 2 + 1] = (int16_t)(q > 32767.0f ? 32767 : (q < -32768.0f ? -32768 : lrintf(q)));
+		}
+		else
+		{
+			dst[n * 2] = i;
+			dst[n * 2 + 1] = q;
+		}
+	}
+}
+
+#if defined(USE_SSE2)
+
+/* 8 complex samples per iteration, lanes hold I0 Q0 I1 Q1 */
+static int process_sse2(const iqconverter_t* cnv, const int8_t* src, float* dst, int16_t* dst16, int count, block_stats_t* stats)
+{
+	int n, k;
+	const __m128 scale = _mm_set1_ps(1.0f / 128.0f);
+	const __m128 dc = _mm_setr_ps(cnv->dc_i, cnv->dc_q, cnv->dc_i, cnv->dc_q);
+	const __m128 gain = _mm_setr_ps(1.0f, cnv->gain, 1.0f, cnv->gain);
+	const __m128 leak = _mm_setr_ps(0.0f, cnv->gain * cnv->phase, 0.0f, cnv->gain * cnv->phase);
+	const __m128 full_scale = _mm_set1_ps(32768.0f);
+	__m128 sum = _mm_setzero_ps();
+	__m128 power = _mm_setzero_ps();
+	__m128 cross = _mm_setzero_ps();
+	__m128 x[4];
+	__m128i b, lo, hi;
+	float lanes[4];
+
+	for (n = 0; n + 8 <= count; n += 8)
+	{
+		b = _mm_loadu_si128((const __m128i*)(src + n * 2));
+		lo = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8);
+		hi = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
+		x[0] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16));
+		x[1] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16));
+		x[2] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16));
+		x[3] = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16));
+
+		for (k = 0; k < 4; k++)
+		{
+			x[k] = _mm_mul_ps(x[k], scale);
+			sum = _mm_add_ps(sum, x[k]);
+			x[k] = _mm_sub_ps(x[k], dc);
+			power = _mm_add_ps(power, _mm_mul_ps(x[k], x[k]));
+			cross = _mm_add_ps(cross, _mm_mul_ps(x[k], _mm_shuffle_ps(x[k], x[k], _MM_SHUFFLE(2, 3, 0, 1))));
+			x[k] = _mm_sub_ps(_mm_mul_ps(x[k], gain), _mm_mul_ps(_mm_shuffle_ps(x[k], x[k], _MM_SHUFFLE(2, 3, 0, 1)), leak));
+		}
+
+		if (dst16 != NULL)
+		{
+			/* cvtps rounds to nearest and packs saturates */
+			_mm_storeu_si128((__m128i*)(dst16 + n * 2), _mm_packs_epi32(
+				_mm_cvtps_epi32(_mm_mul_ps(x[0], full_scale)), _mm_cvtps_epi32(_mm_mul_ps(x[1], full_scale))));
+			_mm_storeu_si128((__m128i*)(dst16 + n * 2 + 8), _mm_packs_epi32(
+				_mm_cvtps_epi32(_mm_mul_ps(x[2], full_scale)), _mm_cvtps_epi32(_mm_mul_ps(x[3], full_scale))));
+		}
+		else
+		{
+			_mm_storeu_ps(dst + n * 2, x[0]);
+			_mm_storeu_ps(dst + n * 2 + 4, x[1]);
+			_mm_storeu_ps(dst + n * 2 + 8, x[2]);
+			_mm_storeu_ps(dst + n * 2 + 12, x[3]);
+		}
+	}
+
+	_mm_storeu_ps(lanes, sum);
+	stats->sum[0] += lanes[0] + lanes[2];
+	stats->sum[1] += lanes[1] + lanes[3];
+	_mm_storeu_ps(lanes, power);
+	stats->power[0] += lanes[0] + lanes[2];
+	stats->power[1] += lanes[1] + lanes[3];
+	_mm_storeu_ps(lanes, cross);
+	stats->cross += lanes[0] + lanes[2];
+
+	return n;
+}
+
+#elif defined(USE_NEON)
+
+/* Round to nearest like lrintf() and cvtps, vcvtq_s32_f32() truncates */
+static inline int32x4_t round_neon(float32x4_t x)
+{
+#if defined(__aarch64__)
+	return vcvtnq_s32_f32(x);
+#else
+	/* ARMv7 has no rounding conversion, add 0.5 with the sign of x and truncate */
+	const uint32x4_t half = vorrq_u32(vreinterpretq_u32_f32(vdupq_n_f32(0.5f)),
+		vandq_u32(vreinterpretq_u32_f32(x), vdupq_n_u32(0x80000000u)));
+	return vcvtq_s32_f32(vaddq_f32(x, vreinterpretq_f32_u32(half)));
+#endif
+}
+
+/* 8 complex samples per iteration, lanes hold I0 Q0 I1 Q1 */
+static int process_neon(const iqconverter_t* cnv, const int8_t* src, float* dst, int16_t* dst16, int count, block_stats_t* stats)
+{
+	int n, k;
+	const float dc_lanes[4] = { cnv->dc_i, cnv->dc_q, cnv->dc_i, cnv->dc_q };
+	const float gain_lanes[4] = { 1.0f, cnv->gain, 1.0f, cnv->gain };
+	const float leak_lanes[4] = { 0.0f, cnv->gain * cnv->phase, 0.0f, cnv->gain * cnv->phase };
+	const float32x4_t dc = vld1q_f32(dc_lanes);
+	const float32x4_t gain = vld1q_f32(gain_lanes);
+	const float32x4_t leak = vld1q_f32(leak_lanes);
+	float32x4_t sum = vdupq_n_f32(0.0f);
+	float32x4_t power = vdupq_n_f32(0.0f);
+	float32x4_t cross = vdupq_n_f32(0.0f);
+	float32x4_t x[4], swapped;
+	int8x16_t b;
+	int16x8_t lo, hi;
+	float lanes[4];
+
+	for (n = 0; n + 8 <= count; n += 8)
+	{
+		b = vld1q_s8(src + n * 2);
+		lo = vmovl_s8(vget_low_s8(b));
+		hi = vmovl_s8(vget_high_s8(b));
+		x[0] = vcvtq_f32_s32(vmovl_s16(vget_low_s16(lo)));
+		x[1] = vcvtq_f32_s32(vmovl_s16(vget_high_s16(lo)));
+		x[2] = vcvtq_f32_s32(vmovl_s16(vget_low_s16(hi)));
+		x[3] = vcvtq_f32_s32(vmovl_s16(vget_high_s16(hi)));
+
+		for (k = 0; k < 4; k++)
+		{
+			x[k] = vmulq_n_f32(x[k], 1.0f / 128.0f);
+			sum = vaddq_f32(sum, x[k]);
+			x[k] = vsubq_f32(x[k], dc);
+			swapped = vrev64q_f32(x[k]);
+			power = vmlaq_f32(power, x[k], x[k]);
+			cross = vmlaq_f32(cross, x[k], swapped);
+			x[k] = vmlsq_f32(vmulq_f32(x[k], gain), swapped, leak);
+		}
+
+		if (dst16 != NULL)
+		{
+			vst1q_s16(dst16 + n * 2, vcombine_s16(
+				vqmovn_s32(round_neon(vmulq_n_f32(x[0], 32768.0f))), vqmovn_s32(round_neon(vmulq_n_f32(x[1], 32768.0f)))));
+			vst1q_s16(dst16 + n * 2 + 8, vcombine_s16(
+				vqmovn_s32(round_neon(vmulq_n_f32(x[2], 32768.0f))), vqmovn_s32(round_neon(vmulq_n_f32(x[3], 32768.0f)))));
+		}
+		else
+		{
+			vst1q_f32(dst + n * 2, x[0]);
+			vst1q_f32(dst + n * 2 + 4, x[1]);
+			vst1q_f32(dst + n * 2 + 8, x[2]);
+			vst1q_f32(dst + n * 2 + 12, x[3]);
+		}
+	}
+
+	vst1q_f32(lanes, sum);
+	stats->sum[0] += lanes[0] + lanes[2];
+	stats->sum[1] += lanes[1] + lanes[3];
+	vst1q_f32(lanes, power);
+	stats->power[0] += lanes[0] + lanes[2];
+	stats->power[1] += lanes[1] + lanes[3];
+	vst1q_f32(lanes, cross);
+	stats->cross += lanes[0] + lanes[2];
+
+	return n;
+}
+
+#endif
+
+iqconverter_t* iqconverter_create(void)
+{
+	iqconverter_t* cnv = (iqconverter_t*)malloc(sizeof(iqconverter_t));
+
+	if (cnv == NULL)
+	{
+		return NULL;
+	}
+
+	cnv->sample_type = HACKRF_SAMPLE_INT8_IQ;
+	cnv->dc_removal = 0;
+	cnv->iq_correction = 0;
+	iqconverter_reset(cnv);
+
+	return cnv;
+}
+
+void iqconverter_free(iqconverter_t* cnv)
+{
+	free(cnv);
+}
+
+void iqconverter_reset(iqconverter_t* cnv)
+{
+	cnv->dc_i = 0.0f;
+	cnv->dc_q = 0.0f;
+	cnv->power_i = 0.0f;
+	cnv->power_q = 0.0f;
+	cnv->cross_iq = 0.0f;
+	cnv->phase = 0.0f;
+	cnv->gain = 1.0f;
+}
+
+int iqconverter_sample_size(enum hackrf_sample_type sample_type)
+{
+	switch (sample_type)
+	{
+	case HACKRF_SAMPLE_INT16_IQ:
+		return 2 * sizeof(int16_t);
+	case HACKRF_SAMPLE_FLOAT32_IQ:
+		return 2 * sizeof(float);
+	default:
+		return 2 * sizeof(int8_t);
+	}
+}
+
+static void update_estimates(iqconverter_t* cnv, const block_stats_t* stats, int count)
+{
+	float power_i, power_q, cross, residual;
+
+	if (cnv->dc_removal)
+	{
+		cnv->dc_i += ESTIMATE_ALPHA * (stats->sum[0] / count - cnv->dc_i);
+		cnv->dc_q += ESTIMATE_ALPHA * (stats->sum[1] / count - cnv->dc_q);
+	}
+	else
+	{
+		cnv->dc_i = 0.0f;
+		cnv->dc_q = 0.0f;
+	}
+
+	if (!cnv->iq_correction)
+	{
+		cnv->phase = 0.0f;
+		cnv->gain = 1.0f;
+		return;
+	}
+
+	cnv->power_i += ESTIMATE_ALPHA * (stats->power[0] / count - cnv->power_i);
+	cnv->power_q += ESTIMATE_ALPHA * (stats->power[1] / count - cnv->power_q);
+	cnv->cross_iq += ESTIMATE_ALPHA * (stats->cross / count - cnv->cross_iq);
+
+	power_i = cnv->power_i;
+	power_q = cnv->power_q;
+	cross = cnv->cross_iq;
+
+	if (power_i < MIN_POWER)
+	{
+		return;
+	}
+
+	/* Remove the part of Q correlated with I, then match the powers */
+	residual = power_q - cross * cross / power_i;
+	if (residual < MIN_POWER)
+	{
+		return;
+	}
+
+	cnv->phase = cross / power_i;
+	cnv->gain = sqrtf(power_i / residual);
+}
+
+int iqconverter_process(iqconverter_t* cnv, const int8_t* src, void* dst, int sample_count)
+{
+	block_stats_t stats = { { 0.0f, 0.0f }, { 0.0f, 0.0f }, 0.0f };
+	float* dst_float = NULL;
+	int16_t* dst_int16 = NULL;
+	int n = 0;
+
+	if (sample_count <= 0)
+	{
+		return 0;
+	}
+
+	if (cnv->sample_type == HACKRF_SAMPLE_INT16_IQ)
+	{
+		dst_int16 = (int16_t*)dst;
+	}
+	else
+	{
+		dst_float = (float*)dst;
+	}
+
+#if defined(USE_SSE2)
+	n = process_sse2(cnv, src, dst_float, dst_int16, sample_count, &stats);
+#elif defined(USE_NEON)
+	n = process_neon(cnv, src, dst_float, dst_int16, sample_count, &stats);
+#endif
+	process_generic(cnv, src, dst_float, dst_int16, n, sample_count, &stats);
+
+	update_estimates(cnv, &stats, sample_count);
+
+	return sample_count * iqconverter_sample_size(cnv->sample_type);
+}
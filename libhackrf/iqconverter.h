@@ -0,0 +1,59 @@
+/*
+Copyright (c) 2012, Jared Boone <jared@sharebrained.com>
+Copyright (c) 2013, Benjamin Vernoux <titanmkd@gmail.com>
+Copyright (c) 2013, Michael Ossmann <mike@ossmann.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the 
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __HACKRF_IQCONVERTER_H__
+#define __HACKRF_IQCONVERTER_H__
+
+#include <stdint.h>
+#include "hackrf.h"
+
+/*
+ * Converts the raw int8 IQ stream to int16 or float IQ. DC offset removal
+ * and IQ imbalance correction run in the same pass, their estimates are
+ * updated once per block and applied to the next one.
+ */
+
+typedef struct {
+	enum hackrf_sample_type sample_type;
+	volatile int dc_removal;
+	volatile int iq_correction;
+	float dc_i;
+	float dc_q;
+	/* Smoothed second order moments of the DC free samples */
+	float power_i;
+	float power_q;
+	float cross_iq;
+	/* Q' = gain * (Q - phase * I) */
+	float phase;
+	float gain;
+} iqconverter_t;
+
+iqconverter_t* iqconverter_create(void);
+void iqconverter_free(iqconverter_t* cnv);
+void iqconverter_reset(iqconverter_t* cnv);
+/* Bytes per complex sample of sample_type */
+int iqconverter_sample_size(enum hackrf_sample_type sample_type);
+/* Converts sample_count complex samples from src to dst and returns the size written in bytes */
+int iqconverter_process(iqconverter_t* cnv, const int8_t* src, void* dst, int sample_count);
+
+#endif /*__HACKRF_IQCONVERTER_H__*/
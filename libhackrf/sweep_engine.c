@@ -0,0 +1,496 @@
+/*
+Copyright (c) 2012, Jared Boone <jared@sharebrained.com>
+Copyright (c) 2013, Benjamin Vernoux <titanmkd@gmail.com>
+Copyright (c) 2013, Michael Ossmann <mike@ossmann.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the 
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sweep_engine.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#if defined(HAVE_FFTW3F)
+  #include <fftw3.h>
+#endif
+
+#if defined(__GNUC__) && defined(__SSE2__)
+  #define USE_SSE2
+  #include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #define USE_NEON
+  #include <arm_neon.h>
+#endif
+
+typedef struct {
+	float re;
+	float im;
+} sweep_complex_t;
+
+typedef struct {
+	uint64_t start;
+	uint64_t span;
+} sweep_range_t;
+
+struct hackrf_sweep_engine {
+	hackrf_sweep_spectrum_cb_fn callback;
+	uint32_t fft_size;
+	uint32_t frame_count;
+	enum sweep_style style;
+	uint32_t step_width;
+	uint32_t offset;
+	uint64_t first_frequency;
+	uint64_t last_frequency;
+	int single_step;
+	int sweep_started;
+	sweep_range_t ranges[MAX_SWEEP_RANGES];
+
+	/* Window scaled by 1/128, repeated for I and Q */
+	float* window;
+	sweep_complex_t* fft_buffer;
+	float* block_power;
+
+	double* power_sum;
+	uint32_t* power_count;
+	hackrf_sweep_spectrum spectrum;
+
+#if defined(HAVE_FFTW3F)
+	fftwf_plan plan;
+#else
+	int* bit_reverse;
+	/* Twiddles of the stage with half-size h are stored at [h, 2h) */
+	sweep_complex_t* twiddles;
+#endif
+};
+
+static void fft_setup(struct hackrf_sweep_engine* engine)
+{
+#if defined(HAVE_FFTW3F)
+	engine->plan = fftwf_plan_dft_1d(engine->fft_size, (fftwf_complex*)engine->fft_buffer,
+			(fftwf_complex*)engine->fft_buffer, FFTW_FORWARD, FFTW_MEASURE);
+#else
+	uint32_t i, j, bits, half;
+	const uint32_t n = engine->fft_size;
+
+	for (bits = 0; (1u << bits) < n; bits++);
+
+	for (i = 0; i < n; i++) {
+		engine->bit_reverse[i] = 0;
+		for (j = 0; j < bits; j++) {
+			engine->bit_reverse[i] |= ((i >> j) & 1) << (bits - 1 - j);
+		}
+	}
+
+	engine->twiddles[0].re = 1.0f;
+	engine->twiddles[0].im = 0.0f;
+	for (half = 1; half < n; half <<= 1) {
+		for (j = 0; j < half; j++) {
+			engine->twiddles[half + j].re = (float)cos(M_PI * j / half);
+			engine->twiddles[half + j].im = (float)-sin(M_PI * j / half);
+		}
+	}
+#endif
+}
+
+#if !defined(HAVE_FFTW3F)
+
+static void fft_stage(sweep_complex_t* buffer, const uint32_t n, const uint32_t half, const sweep_complex_t* w)
+{
+	uint32_t i, j;
+	float re, im;
+	sweep_complex_t* a;
+	sweep_complex_t* b;
+
+	for (i = 0; i < n; i += half * 2) {
+		a = buffer + i;
+		b = a + half;
+		j = 0;
+
+#if defined(USE_SSE2)
+		const __m128 sign = _mm_castsi128_ps(_mm_set_epi32(0, (int)0x80000000, 0, (int)0x80000000));
+
+		for (; j + 2 <= half; j += 2) {
+			__m128 x = _mm_loadu_ps((float*)(b + j));
+			__m128 y = _mm_loadu_ps((const float*)(w + j));
+			__m128 y_re = _mm_shuffle_ps(y, y, _MM_SHUFFLE(2, 2, 0, 0));
+			__m128 y_im = _mm_shuffle_ps(y, y, _MM_SHUFFLE(3, 3, 1, 1));
+			__m128 x_sw = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+			__m128 t = _mm_add_ps(_mm_mul_ps(x, y_re), _mm_xor_ps(_mm_mul_ps(x_sw, y_im), sign));
+			__m128 u = _mm_loadu_ps((float*)(a + j));
+			_mm_storeu_ps((float*)(a + j), _mm_add_ps(u, t));
+			_mm_storeu_ps((float*)(b + j), _mm_sub_ps(u, t));
+		}
+#elif defined(USE_NEON)
+		for (; j + 4 <= half; j += 4) {
+			float32x4x2_t x = vld2q_f32((float*)(b + j));
+			float32x4x2_t y = vld2q_f32((const float*)(w + j));
+			float32x4x2_t u = vld2q_f32((float*)(a + j));
+			float32x4x2_t t;
+			t.val[0] = vmlsq_f32(vmulq_f32(x.val[0], y.val[0]), x.val[1], y.val[1]);
+			t.val[1] = vmlaq_f32(vmulq_f32(x.val[1], y.val[0]), x.val[0], y.val[1]);
+			x.val[0] = vaddq_f32(u.val[0], t.val[0]);
+			x.val[1] = vaddq_f32(u.val[1], t.val[1]);
+			u.val[0] = vsubq_f32(u.val[0], t.val[0]);
+			u.val[1] = vsubq_f32(u.val[1], t.val[1]);
+			vst2q_f32((float*)(a + j), x);
+			vst2q_f32((float*)(b + j), u);
+		}
+#endif
+
+		for (; j < half; j++) {
+			re = b[j].re * w[j].re - b[j].im * w[j].im;
+			im = b[j].im * w[j].re + b[j].re * w[j].im;
+			b[j].re = a[j].re - re;
+			b[j].im = a[j].im - im;
+			a[j].re += re;
+			a[j].im += im;
+		}
+	}
+}
+
+#endif
+
+static void fft_execute(struct hackrf_sweep_engine* engine)
+{
+#if defined(HAVE_FFTW3F)
+	fftwf_execute(engine->plan);
+#else
+	uint32_t i, j, half;
+	const uint32_t n = engine->fft_size;
+	sweep_complex_t* buffer = engine->fft_buffer;
+	sweep_complex_t t;
+	sweep_complex_t* p;
+	float r0, i0, r1, i1, r2, i2, r3, i3;
+
+	for (i = 0; i < n; i++) {
+		j = engine->bit_reverse[i];
+		if (i < j) {
+			t = buffer[i];
+			buffer[i] = buffer[j];
+			buffer[j] = t;
+		}
+	}
+
+	/* The first two stages only need the trivial twiddles 1 and -j */
+	for (i = 0; i < n; i += 4) {
+		p = buffer + i;
+
+		r0 = p[0].re + p[1].re; i0 = p[0].im + p[1].im;
+		r1 = p[0].re - p[1].re; i1 = p[0].im - p[1].im;
+		r2 = p[2].re + p[3].re; i2 = p[2].im + p[3].im;
+		r3 = p[2].re - p[3].re; i3 = p[2].im - p[3].im;
+
+		p[0].re = r0 + r2; p[0].im = i0 + i2;
+		p[2].re = r0 - r2; p[2].im = i0 - i2;
+		p[1].re = r1 + i3; p[1].im = i1 - r3;
+		p[3].re = r1 - i3; p[3].im = i1 + r3;
+	}
+
+	for (half = 4; half < n; half <<= 1) {
+		fft_stage(buffer, n, half, engine->twiddles + half);
+	}
+#endif
+}
+
+/* int8 IQ to float, multiplied by the window */
+static void load_frame(const int8_t* src, const float* window, float* dst, const uint32_t count)
+{
+	uint32_t i = 0;
+
+#if defined(USE_SSE2)
+	for (; i + 16 <= count; i += 16) {
+		__m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8);
+		__m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
+		_mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)), _mm_loadu_ps(window + i)));
+		_mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)), _mm_loadu_ps(window + i + 4)));
+		_mm_storeu_ps(dst + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)), _mm_loadu_ps(window + i + 8)));
+		_mm_storeu_ps(dst + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16)), _mm_loadu_ps(window + i + 12)));
+	}
+#elif defined(USE_NEON)
+	for (; i + 16 <= count; i += 16) {
+		int8x16_t b = vld1q_s8(src + i);
+		int16x8_t lo = vmovl_s8(vget_low_s8(b));
+		int16x8_t hi = vmovl_s8(vget_high_s8(b));
+		vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(lo))), vld1q_f32(window + i)));
+		vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(lo))), vld1q_f32(window + i + 4)));
+		vst1q_f32(dst + i + 8, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(hi))), vld1q_f32(window + i + 8)));
+		vst1q_f32(dst + i + 12, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(hi))), vld1q_f32(window + i + 12)));
+	}
+#endif
+
+	for (; i < count; i++) {
+		dst[i] = src[i] * window[i];
+	}
+}
+
+static double window_value(const enum hackrf_sweep_window window, const uint32_t i, const uint32_t n)
+{
+	const double x = 2.0 * M_PI * i / (n - 1);
+
+	switch (window) {
+	case HACKRF_SWEEP_WINDOW_HANN:
+		return 0.5 - 0.5 * cos(x);
+	case HACKRF_SWEEP_WINDOW_HAMMING:
+		return 0.54 - 0.46 * cos(x);
+	case HACKRF_SWEEP_WINDOW_BLACKMAN_HARRIS:
+		return 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2.0 * x) - 0.01168 * cos(3.0 * x);
+	default:
+		return 1.0;
+	}
+}
+
+struct hackrf_sweep_engine* hackrf_sweep_engine_create(
+		const uint16_t* frequency_list, const int num_ranges,
+		const uint32_t step_width, const uint32_t offset,
+		const enum sweep_style style, const double sample_rate,
+		const uint32_t fft_size, const enum hackrf_sweep_window window,
+		hackrf_sweep_spectrum_cb_fn callback)
+{
+	struct hackrf_sweep_engine* engine;
+	uint64_t start, stop, steps;
+	double gain = 0.0;
+	uint32_t i;
+	int r, bins = 0;
+
+	if (fft_size < SWEEP_FFT_SIZE_MIN || fft_size > SWEEP_FFT_SIZE_MAX || (fft_size & (fft_size - 1)) != 0 ||
+		num_ranges < 1 || num_ranges > MAX_SWEEP_RANGES || step_width == 0 || sample_rate <= 0.0) {
+		return NULL;
+	}
+
+	engine = (struct hackrf_sweep_engine*)calloc(1, sizeof(struct hackrf_sweep_engine));
+	if (engine == NULL) {
+		return NULL;
+	}
+
+	engine->callback = callback;
+	engine->fft_size = fft_size;
+	engine->frame_count = (SAMPLES_PER_BLOCK - SWEEP_BLOCK_HEADER_SAMPLES) / fft_size;
+	engine->style = style;
+	engine->step_width = step_width;
+	engine->offset = offset;
+	engine->first_frequency = (uint64_t)frequency_list[0] * 1000000ull;
+	engine->spectrum.bin_width = sample_rate / fft_size;
+
+	/* The firmware steps from each range start until it passes the stop frequency */
+	for (r = 0; r < num_ranges; r++) {
+		start = (uint64_t)frequency_list[r * 2] * 1000000ull;
+		stop = (uint64_t)frequency_list[r * 2 + 1] * 1000000ull;
+		steps = stop > start ? (stop - start + step_width - 1) / step_width : 1;
+
+		engine->ranges[r].start = start;
+		engine->ranges[r].span = steps * step_width;
+
+		/* Bin g of the range is centered at start + g * bin_width, see stitch_segment() */
+		engine->spectrum.ranges[r].bin_offset = bins;
+		engine->spectrum.ranges[r].bin_count = (int)(engine->ranges[r].span / engine->spectrum.bin_width);
+		engine->spectrum.ranges[r].frequency_start = start;
+		bins += engine->spectrum.ranges[r].bin_count;
+	}
+	/* Every block then carries the first frequency, each one completes a sweep */
+	engine->single_step = num_ranges == 1 && engine->ranges[0].span == step_width && style == LINEAR;
+	engine->spectrum.range_count = num_ranges;
+	engine->spectrum.bin_count = bins;
+
+	engine->window = (float*)malloc(fft_size * 2 * sizeof(float));
+	engine->fft_buffer = (sweep_complex_t*)malloc(fft_size * sizeof(sweep_complex_t));
+	engine->block_power = (float*)malloc(fft_size * sizeof(float));
+	engine->power_sum = (double*)calloc(bins, sizeof(double));
+	engine->power_count = (uint32_t*)calloc(bins, sizeof(uint32_t));
+	engine->spectrum.power = (float*)malloc(bins * sizeof(float));
+#if !defined(HAVE_FFTW3F)
+	engine->bit_reverse = (int*)malloc(fft_size * sizeof(int));
+	engine->twiddles = (sweep_complex_t*)malloc(fft_size * sizeof(sweep_complex_t));
+	if (engine->bit_reverse == NULL || engine->twiddles == NULL) {
+		hackrf_sweep_engine_destroy(engine);
+		return NULL;
+	}
+#endif
+
+	if (engine->window == NULL || engine->fft_buffer == NULL || engine->block_power == NULL ||
+		engine->power_sum == NULL || engine->power_count == NULL || engine->spectrum.power == NULL) {
+		hackrf_sweep_engine_destroy(engine);
+		return NULL;
+	}
+
+	/* Normalize to the coherent gain so that a full scale tone reads 0 dBFS */
+	for (i = 0; i < fft_size; i++) {
+		gain += window_value(window, i, fft_size);
+	}
+	for (i = 0; i < fft_size; i++) {
+		engine->window[i * 2] = (float)(window_value(window, i, fft_size) / (gain * 128.0));
+		engine->window[i * 2 + 1] = engine->window[i * 2];
+	}
+
+	fft_setup(engine);
+
+	return engine;
+}
+
+static void deliver_sweep(struct hackrf_sweep_engine* engine, int* result)
+{
+	int i;
+	hackrf_sweep_spectrum* spectrum = &engine->spectrum;
+
+	for (i = 0; i < spectrum->bin_count; i++) {
+		spectrum->power[i] = engine->power_count[i] > 0 ?
+			(float)(10.0 * log10(engine->power_sum[i] / engine->power_count[i] + 1e-20)) : -INFINITY;
+	}
+
+	*result = engine->callback(spectrum);
+	spectrum->sweep_count++;
+
+	memset(engine->power_sum, 0, spectrum->bin_count * sizeof(double));
+	memset(engine->power_count, 0, spectrum->bin_count * sizeof(uint32_t));
+}
+
+/*
+ * Adds the bins of one block whose centers fall into [frequency + a, frequency + b)
+ * to the sweep. The block is centered at frequency + offset, so FFT bin s is
+ * centered at frequency + offset + s * bin_width and range bin g at
+ * range start + g * bin_width.
+ */
+static void stitch_segment(struct hackrf_sweep_engine* engine, const int r, const uint64_t frequency, const double a, const double b)
+{
+	const double bin_width = engine->spectrum.bin_width;
+	const int n = (int)engine->fft_size;
+	const sweep_range_t* range = &engine->ranges[r];
+	const int bin_offset = engine->spectrum.ranges[r].bin_offset;
+	const int bin_count = engine->spectrum.ranges[r].bin_count;
+	const double relative = (double)frequency - (double)range->start;
+	int g, g_start, g_stop, s;
+
+	g_start = (int)ceil((relative + a) / bin_width);
+	g_stop = (int)ceil((relative + b) / bin_width);
+	if (g_start < 0)
+		g_start = 0;
+	if (g_stop > bin_count)
+		g_stop = bin_count;
+
+	/*
+	 * FFT bin nearest to the first stitched bin, both grids share the same
+	 * spacing. Rounds halfway cases up whatever the sign.
+	 */
+	s = (int)floor((g_start * bin_width - relative - engine->offset) / bin_width + 0.5);
+
+	for (g = g_start; g < g_stop; g++, s++) {
+		if (s < -n / 2 || s >= n / 2)
+			continue;
+		engine->power_sum[bin_offset + g] += engine->block_power[s & (n - 1)];
+		engine->power_count[bin_offset + g]++;
+	}
+}
+
+int hackrf_sweep_engine_process(struct hackrf_sweep_engine* engine, hackrf_transfer* transfer)
+{
+	const uint32_t n = engine->fft_size;
+	const double step = engine->step_width;
+	const uint8_t* block;
+	uint64_t frequency;
+	uint32_t i, frame;
+	int r, offset, result = 0;
+	float scale;
+
+	engine->spectrum.device = transfer->device;
+	engine->spectrum.rx_ctx = transfer->rx_ctx;
+
+	for (offset = 0; offset + BYTES_PER_BLOCK <= transfer->valid_length && result == 0; offset += BYTES_PER_BLOCK) {
+		block = transfer->buffer + offset;
+
+		if (block[0] != 0x7F || block[1] != 0x7F) {
+			continue;
+		}
+
+		frequency = 0;
+		for (i = 0; i < 8; i++) {
+			frequency |= (uint64_t)block[2 + i] << (8 * i);
+		}
+
+		if (frequency == engine->first_frequency && (engine->last_frequency != frequency || engine->single_step)) {
+			if (engine->sweep_started) {
+				deliver_sweep(engine, &result);
+			}
+			engine->sweep_started = 1;
+		}
+		engine->last_frequency = frequency;
+
+		if (!engine->sweep_started) {
+			continue;
+		}
+
+		for (r = 0; r < engine->spectrum.range_count; r++) {
+			if (frequency >= engine->ranges[r].start && frequency < engine->ranges[r].start + engine->ranges[r].span)
+				break;
+		}
+		if (r == engine->spectrum.range_count) {
+			continue;
+		}
+
+		/* Average the power of every whole frame behind the header */
+		memset(engine->block_power, 0, n * sizeof(float));
+		for (frame = 0; frame < engine->frame_count; frame++) {
+			load_frame((const int8_t*)block + BYTES_PER_BLOCK - (frame + 1) * n * 2, engine->window, (float*)engine->fft_buffer, n * 2);
+			fft_execute(engine);
+			for (i = 0; i < n; i++) {
+				engine->block_power[i] += engine->fft_buffer[i].re * engine->fft_buffer[i].re + engine->fft_buffer[i].im * engine->fft_buffer[i].im;
+			}
+		}
+		scale = 1.0f / engine->frame_count;
+		for (i = 0; i < n; i++) {
+			engine->block_power[i] *= scale;
+		}
+
+		if (engine->style == INTERLEAVED) {
+			stitch_segment(engine, r, frequency, 0.0, step / 4);
+			stitch_segment(engine, r, frequency, step / 2, step * 3 / 4);
+		} else {
+			stitch_segment(engine, r, frequency, 0.0, step);
+		}
+	}
+
+	return result;
+}
+
+void hackrf_sweep_engine_destroy(struct hackrf_sweep_engine* engine)
+{
+	if (engine == NULL) {
+		return;
+	}
+
+#if defined(HAVE_FFTW3F)
+	if (engine->plan != NULL) {
+		fftwf_destroy_plan(engine->plan);
+	}
+#else
+	free(engine->bit_reverse);
+	free(engine->twiddles);
+#endif
+	free(engine->window);
+	free(engine->fft_buffer);
+	free(engine->block_power);
+	free(engine->power_sum);
+	free(engine->power_count);
+	free(engine->spectrum.power);
+	free(engine);
+}
@@ -0,0 +1,54 @@
+/*
+Copyright (c) 2012, Jared Boone <jared@sharebrained.com>
+Copyright (c) 2013, Benjamin Vernoux <titanmkd@gmail.com>
+Copyright (c) 2013, Michael Ossmann <mike@ossmann.com>
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+    Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the 
+	documentation and/or other materials provided with the distribution.
+    Neither the name of Great Scott Gadgets nor the names of its contributors may be used to endorse or promote products derived from this software
+	without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, 
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef __HACKRF_SWEEP_ENGINE_H__
+#define __HACKRF_SWEEP_ENGINE_H__
+
+#include "hackrf.h"
+
+#define SWEEP_BLOCK_HEADER_SAMPLES 5
+#define SWEEP_FFT_SIZE_MIN 16
+#define SWEEP_FFT_SIZE_MAX 4096
+
+/*
+ * Turns the raw blocks of hackrf_start_rx_sweep() into one power spectrum
+ * per sweep: parses the block headers, windows and transforms every block
+ * and stitches the usable part of each block into the hackrf_init_sweep()
+ * ranges.
+ */
+
+struct hackrf_sweep_engine;
+
+struct hackrf_sweep_engine* hackrf_sweep_engine_create(
+		const uint16_t* frequency_list, const int num_ranges,
+		const uint32_t step_width, const uint32_t offset,
+		const enum sweep_style style, const double sample_rate,
+		const uint32_t fft_size, const enum hackrf_sweep_window window,
+		hackrf_sweep_spectrum_cb_fn callback);
+
+/* Returns the spectrum callback result, 0 while no sweep completed */
+int hackrf_sweep_engine_process(struct hackrf_sweep_engine* engine, hackrf_transfer* transfer);
+
+void hackrf_sweep_engine_destroy(struct hackrf_sweep_engine* engine);
+
+#endif /*__HACKRF_SWEEP_ENGINE_H__*/
@@ -26,6 +26,7 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <libusb.h>
 
 #if _MSC_VER > 1700  // To avoid error with Visual Studio 2017/2019 or more define which define timespec as it is already defined in pthread.h
@@ -39,6 +40,14 @@ ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSI
 #include "iqconverter_int16.h"
 #include "filters.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(HYDRASDR_BIG_ENDIAN)
+#include <immintrin.h>
+#define USE_SSSE3_UNPACK
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(HYDRASDR_BIG_ENDIAN)
+#include <arm_neon.h>
+#define USE_NEON_UNPACK
+#endif
+
 #if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 202311L
 #ifndef bool
 typedef int bool;
@@ -117,6 +126,7 @@ typedef struct hydrasdr_device
 	uint32_t buffer_size;
 	uint32_t dropped_buffers;
 	uint32_t dropped_buffers_queue[RAW_BUFFER_COUNT];
+	uint64_t received_time_queue[RAW_BUFFER_COUNT];
 	uint16_t *received_samples_queue[RAW_BUFFER_COUNT];
 	volatile int received_samples_queue_head;
 	volatile int received_samples_queue_tail;
@@ -126,6 +136,9 @@ typedef struct hydrasdr_device
 	bool packing_enabled;
 	iqconverter_float_t *cnv_f;
 	iqconverter_int16_t *cnv_i;
+	uint32_t decimation_stages;
+	/* Producer side fields are updated under consumer_mp, the rest only by the consumer thread */
+	hydrasdr_stream_stats_t stats;
 	void* ctx;
 	enum hydrasdr_sample_type sample_type;
 	bool reset_command; /* HYDRASDR_RESET command executed ? */
@@ -370,11 +383,208 @@ static inline void unpack_samples(uint32_t *input, uint16_t *output, int length)
 	}
 }
 
+/*
+ * Fused unpack + convert for packed mode: every 3 words (12 bytes) carry 8
+ * big-endian 12-bit samples. The SIMD variants gather the two bytes of each
+ * sample with a byte shuffle, then fix up the odd/even nibble alignment.
+ * They read 16 bytes per 12 consumed, so they stop one group early and let
+ * the scalar loop finish the block.
+ */
+
+#ifdef USE_SSSE3_UNPACK
+
+__attribute__((target("ssse3")))
+static int unpack_convert_samples_int16_ssse3(uint32_t *input, int16_t *dest, int length)
+{
+	int j;
+	const uint8_t *src = (const uint8_t *) input;
+	const __m128i shuffle = _mm_setr_epi8(2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9);
+	const __m128i even_mask = _mm_setr_epi16(0x0fff, 0, 0x0fff, 0, 0x0fff, 0, 0x0fff, 0);
+	const __m128i odd_mask = _mm_setr_epi16(0, 0x0fff, 0, 0x0fff, 0, 0x0fff, 0, 0x0fff);
+	const __m128i offset = _mm_set1_epi16(2048);
+
+	for (j = 0; j + 16 <= length; j += 8, src += 12)
+	{
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src), shuffle);
+		v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 4), even_mask), _mm_and_si128(v, odd_mask));
+		v = _mm_slli_epi16(_mm_sub_epi16(v, offset), SAMPLE_SHIFT);
+		_mm_storeu_si128((__m128i *) (dest + j), v);
+	}
+
+	return j;
+}
+
+__attribute__((target("ssse3")))
+static int unpack_convert_samples_float_ssse3(uint32_t *input, float *dest, int length)
+{
+	int j;
+	const uint8_t *src = (const uint8_t *) input;
+	const __m128i shuffle = _mm_setr_epi8(2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9);
+	const __m128i even_mask = _mm_setr_epi16(0x0fff, 0, 0x0fff, 0, 0x0fff, 0, 0x0fff, 0);
+	const __m128i odd_mask = _mm_setr_epi16(0, 0x0fff, 0, 0x0fff, 0, 0x0fff, 0, 0x0fff);
+	const __m128i offset = _mm_set1_epi16(2048);
+	const __m128 scale = _mm_set1_ps(SAMPLE_SCALE);
+
+	for (j = 0; j + 16 <= length; j += 8, src += 12)
+	{
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) src), shuffle);
+		v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 4), even_mask), _mm_and_si128(v, odd_mask));
+		v = _mm_sub_epi16(v, offset);
+		_mm_storeu_ps(dest + j, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), scale));
+		_mm_storeu_ps(dest + j + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), scale));
+	}
+
+	return j;
+}
+
+#endif
+
+#ifdef USE_NEON_UNPACK
+
+static const uint8_t unpack_shuffle[16] = { 2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9 };
+static const uint16_t unpack_even_lanes[8] = { 0xffff, 0, 0xffff, 0, 0xffff, 0, 0xffff, 0 };
+
+static inline int16x8_t unpack_samples_neon(const uint8_t *src)
+{
+	uint16x8_t v;
+
+#if defined(__aarch64__)
+	v = vreinterpretq_u16_u8(vqtbl1q_u8(vld1q_u8(src), vld1q_u8(unpack_shuffle)));
+#else
+	uint8x16_t raw = vld1q_u8(src);
+	uint8x8x2_t table = { { vget_low_u8(raw), vget_high_u8(raw) } };
+	v = vreinterpretq_u16_u8(vcombine_u8(vtbl2_u8(table, vld1_u8(unpack_shuffle)), vtbl2_u8(table, vld1_u8(unpack_shuffle + 8))));
+#endif
+
+	v = vbslq_u16(vld1q_u16(unpack_even_lanes), vshrq_n_u16(v, 4), vandq_u16(v, vdupq_n_u16(0x0fff)));
+
+	return vsubq_s16(vreinterpretq_s16_u16(v), vdupq_n_s16(2048));
+}
+
+static int unpack_convert_samples_int16_neon(uint32_t *input, int16_t *dest, int length)
+{
+	int j;
+	const uint8_t *src = (const uint8_t *) input;
+
+	for (j = 0; j + 16 <= length; j += 8, src += 12)
+	{
+		vst1q_s16(dest + j, vshlq_n_s16(unpack_samples_neon(src), SAMPLE_SHIFT));
+	}
+
+	return j;
+}
+
+static int unpack_convert_samples_float_neon(uint32_t *input, float *dest, int length)
+{
+	int j;
+	const uint8_t *src = (const uint8_t *) input;
+
+	for (j = 0; j + 16 <= length; j += 8, src += 12)
+	{
+		int16x8_t v = unpack_samples_neon(src);
+		vst1q_f32(dest + j, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), SAMPLE_SCALE));
+		vst1q_f32(dest + j + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), SAMPLE_SCALE));
+	}
+
+	return j;
+}
+
+#endif
+
+static void unpack_convert_samples_int16(uint32_t *input, int16_t *dest, int length)
+{
+	int i, j;
+	uint16_t samples[8];
+
+	j = 0;
+
+#if defined(USE_SSSE3_UNPACK)
+	if (__builtin_cpu_supports("ssse3"))
+	{
+		j = unpack_convert_samples_int16_ssse3(input, dest, length);
+	}
+#elif defined(USE_NEON_UNPACK)
+	j = unpack_convert_samples_int16_neon(input, dest, length);
+#endif
+
+	for (i = (j / 8) * 3; j < length; i += 3, j += 8)
+	{
+		unpack_samples(input + i, samples, 8);
+		convert_samples_int16(samples, dest + j, 8);
+	}
+}
+
+static void unpack_convert_samples_float(uint32_t *input, float *dest, int length)
+{
+	int i, j;
+	uint16_t samples[8];
+
+	j = 0;
+
+#if defined(USE_SSSE3_UNPACK)
+	if (__builtin_cpu_supports("ssse3"))
+	{
+		j = unpack_convert_samples_float_ssse3(input, dest, length);
+	}
+#elif defined(USE_NEON_UNPACK)
+	j = unpack_convert_samples_float_neon(input, dest, length);
+#endif
+
+	for (i = (j / 8) * 3; j < length; i += 3, j += 8)
+	{
+		unpack_samples(input + i, samples, 8);
+		convert_samples_float(samples, dest + j, 8);
+	}
+}
+
+static uint64_t monotonic_time_us(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER frequency, counter;
+
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return (uint64_t) (counter.QuadPart / frequency.QuadPart) * 1000000 + (uint64_t) (counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+static void record_timing(hydrasdr_timing_stats_t* timing, uint64_t us)
+{
+	uint32_t bin = 0;
+	uint64_t v = us;
+
+	while (v > 1 && bin < HYDRASDR_STATS_HISTOGRAM_BINS - 1)
+	{
+		v >>= 1;
+		bin++;
+	}
+
+	timing->count++;
+	timing->total_us += us;
+	if (us > timing->max_us)
+	{
+		timing->max_us = (uint32_t) us;
+	}
+	timing->histogram[bin]++;
+}
+
 static void* consumer_threadproc(void *arg)
 {
 	int sample_count;
 	uint16_t* input_samples;
 	uint32_t dropped_buffers;
+	uint64_t received_us;
+	uint64_t start_us;
+	uint64_t convert_us;
+	uint64_t filter_us;
+	uint64_t callback_us;
 	hydrasdr_device_t* device = (hydrasdr_device_t*)arg;
 	hydrasdr_transfer_t transfer;
 
@@ -399,19 +609,26 @@ static void* consumer_threadproc(void *arg)
 
 		input_samples = device->received_samples_queue[device->received_samples_queue_tail];
 		dropped_buffers = device->dropped_buffers_queue[device->received_samples_queue_tail];
+		received_us = device->received_time_queue[device->received_samples_queue_tail];
 		device->received_samples_queue_tail = (device->received_samples_queue_tail + 1) & (RAW_BUFFER_COUNT - 1);
 
 		pthread_mutex_unlock(&device->consumer_mp);
 
+		start_us = monotonic_time_us();
+		convert_us = 0;
+		filter_us = 0;
+		record_timing(&device->stats.latency, start_us - received_us);
+
 		if (device->packing_enabled)
 		{
 			sample_count = ((device->buffer_size / 2) * 4) / 3;
 
-			if (device->sample_type != HYDRASDR_SAMPLE_RAW)
+			if (device->sample_type == HYDRASDR_SAMPLE_UINT16_REAL)
 			{
 				unpack_samples((uint32_t*)input_samples, device->unpacked_samples, sample_count);
 
 				input_samples = device->unpacked_samples;
+				convert_us = monotonic_time_us();
 			}
 		}
 		else
@@ -422,26 +639,61 @@ static void* consumer_threadproc(void *arg)
 		switch (device->sample_type)
 		{
 		case HYDRASDR_SAMPLE_FLOAT32_IQ:
-			convert_samples_float(input_samples, (float *)device->output_buffer, sample_count);
+			if (device->packing_enabled)
+			{
+				unpack_convert_samples_float((uint32_t*)input_samples, (float *)device->output_buffer, sample_count);
+			}
+			else
+			{
+				convert_samples_float(input_samples, (float *)device->output_buffer, sample_count);
+			}
+			convert_us = monotonic_time_us();
 			iqconverter_float_process(device->cnv_f, (float *) device->output_buffer, sample_count);
+			sample_count = iqconverter_float_decimate(device->cnv_f, (float *) device->output_buffer, sample_count);
+			filter_us = monotonic_time_us();
 			sample_count /= 2;
 			transfer.samples = device->output_buffer;
 			break;
 
 		case HYDRASDR_SAMPLE_FLOAT32_REAL:
-			convert_samples_float(input_samples, (float *)device->output_buffer, sample_count);
+			if (device->packing_enabled)
+			{
+				unpack_convert_samples_float((uint32_t*)input_samples, (float *)device->output_buffer, sample_count);
+			}
+			else
+			{
+				convert_samples_float(input_samples, (float *)device->output_buffer, sample_count);
+			}
+			convert_us = monotonic_time_us();
 			transfer.samples = device->output_buffer;
 			break;
 
 		case HYDRASDR_SAMPLE_INT16_IQ:
-			convert_samples_int16(input_samples, (int16_t *)device->output_buffer, sample_count);
+			if (device->packing_enabled)
+			{
+				unpack_convert_samples_int16((uint32_t*)input_samples, (int16_t *)device->output_buffer, sample_count);
+			}
+			else
+			{
+				convert_samples_int16(input_samples, (int16_t *)device->output_buffer, sample_count);
+			}
+			convert_us = monotonic_time_us();
 			iqconverter_int16_process(device->cnv_i, (int16_t *) device->output_buffer, sample_count);
+			filter_us = monotonic_time_us();
 			sample_count /= 2;
 			transfer.samples = device->output_buffer;
 			break;
 
 		case HYDRASDR_SAMPLE_INT16_REAL:
-			convert_samples_int16(input_samples, (int16_t *)device->output_buffer, sample_count);
+			if (device->packing_enabled)
+			{
+				unpack_convert_samples_int16((uint32_t*)input_samples, (int16_t *)device->output_buffer, sample_count);
+			}
+			else
+			{
+				convert_samples_int16(input_samples, (int16_t *)device->output_buffer, sample_count);
+			}
+			convert_us = monotonic_time_us();
 			transfer.samples = device->output_buffer;
 			break;
 
@@ -461,11 +713,27 @@ static void* consumer_threadproc(void *arg)
 		transfer.sample_type = device->sample_type;
 		transfer.dropped_samples = (uint64_t) dropped_buffers * (uint64_t) sample_count;
 
+		if (convert_us != 0)
+		{
+			record_timing(&device->stats.convert, convert_us - start_us);
+		}
+
+		if (filter_us != 0)
+		{
+			record_timing(&device->stats.filter, filter_us - convert_us);
+		}
+
+		device->stats.dropped_samples += transfer.dropped_samples;
+
+		callback_us = monotonic_time_us();
+
 		if (device->callback(&transfer) != 0)
 		{
 			device->streaming = false;
 		}
 
+		record_timing(&device->stats.callback, monotonic_time_us() - callback_us);
+
 		pthread_mutex_lock(&device->consumer_mp);
 		device->received_buffer_count--;
 	}
@@ -491,6 +759,8 @@ static void hydrasdr_libusb_transfer_callback(struct libusb_transfer* usb_transf
 	{
 		pthread_mutex_lock(&device->consumer_mp);
 
+		device->stats.received_buffers++;
+
 		if (device->received_buffer_count < RAW_BUFFER_COUNT)
 		{
 			temp = device->received_samples_queue[device->received_samples_queue_head];
@@ -499,15 +769,22 @@ static void hydrasdr_libusb_transfer_callback(struct libusb_transfer* usb_transf
 
 			device->dropped_buffers_queue[device->received_samples_queue_head] = device->dropped_buffers;
 			device->dropped_buffers = 0;
+			device->received_time_queue[device->received_samples_queue_head] = monotonic_time_us();
 			
 			device->received_samples_queue_head = (device->received_samples_queue_head + 1) & (RAW_BUFFER_COUNT - 1);
 			device->received_buffer_count++;
 
+			if ((uint32_t) device->received_buffer_count > device->stats.queue_depth_max)
+			{
+				device->stats.queue_depth_max = device->received_buffer_count;
+			}
+
 			pthread_cond_signal(&device->consumer_cv);
 		}
 		else
 		{
 			device->dropped_buffers++;
+			device->stats.dropped_buffers++;
 		}
 
 		pthread_mutex_unlock(&device->consumer_mp);
@@ -1267,6 +1544,7 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 
 		memset(device->dropped_buffers_queue, 0, RAW_BUFFER_COUNT * sizeof(uint32_t));
 		device->dropped_buffers = 0;
+		memset(&device->stats, 0, sizeof(device->stats));
 
 		result = hydrasdr_set_receiver_mode(device, HYDRASDR_RECEIVER_MODE_OFF);
 		if (result != HYDRASDR_SUCCESS)
@@ -1733,6 +2011,7 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 
 		iqconverter_float_free(device->cnv_f);
 		device->cnv_f = iqconverter_float_create(kernel, len);
+		iqconverter_float_set_decimation(device->cnv_f, HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN, device->decimation_stages);
 
 		return HYDRASDR_SUCCESS;
 	}
@@ -1984,6 +2263,28 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		}
 	}
 
+	int ADDCALL hydrasdr_set_decimation(hydrasdr_device_t* device, uint32_t decimation)
+	{
+		uint32_t stages;
+
+		if (device->streaming)
+		{
+			return HYDRASDR_ERROR_BUSY;
+		}
+
+		for (stages = 0; stages <= IQCONVERTER_DECIMATION_STAGES_MAX; stages++)
+		{
+			if (decimation == (1u << stages))
+			{
+				device->decimation_stages = stages;
+				iqconverter_float_set_decimation(device->cnv_f, HB_KERNEL_FLOAT, HB_KERNEL_FLOAT_LEN, stages);
+				return HYDRASDR_SUCCESS;
+			}
+		}
+
+		return HYDRASDR_ERROR_INVALID_PARAM;
+	}
+
 	int ADDCALL hydrasdr_set_packing(hydrasdr_device_t* device, uint8_t value)
 	{
 		int result;
@@ -2087,6 +2388,21 @@ int hydrasdr_list_devices(uint64_t *serials, int count)
 		return HYDRASDR_SUCCESS;
 	}
 
+	int ADDCALL hydrasdr_get_stream_stats(hydrasdr_device_t* device, hydrasdr_stream_stats_t* stats)
+	{
+		if (stats == NULL)
+		{
+			return HYDRASDR_ERROR_INVALID_PARAM;
+		}
+
+		/* Lock free snapshot: counters being updated concurrently may be one block apart */
+		memcpy(stats, &device->stats, sizeof(hydrasdr_stream_stats_t));
+
+		stats->queue_depth = device->streaming ? (uint32_t) device->received_buffer_count : 0;
+
+		return HYDRASDR_SUCCESS;
+	}
+
 	int ADDCALL hydrasdr_is_streaming(hydrasdr_device_t* device)
 	{
 		return (device->streaming == true && device->stop_requested == false);
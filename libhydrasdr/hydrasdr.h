@@ -117,6 +117,28 @@ typedef struct {
 	uint32_t revision;
 } hydrasdr_lib_version_t;
 
+/* Histogram bin i counts durations in [2^i, 2^(i+1)) microseconds, bin 0 also counts 0 us and the last bin is open ended */
+#define HYDRASDR_STATS_HISTOGRAM_BINS 16
+
+typedef struct {
+	uint64_t count;
+	uint64_t total_us;
+	uint32_t max_us;
+	uint32_t histogram[HYDRASDR_STATS_HISTOGRAM_BINS];
+} hydrasdr_timing_stats_t;
+
+typedef struct {
+	uint64_t received_buffers; /* USB transfers completed */
+	uint64_t dropped_buffers;  /* Transfers discarded because the queue was full */
+	uint64_t dropped_samples;  /* Sum of dropped_samples reported to the callback */
+	uint32_t queue_depth;      /* Blocks waiting for the consumer */
+	uint32_t queue_depth_max;
+	hydrasdr_timing_stats_t latency;  /* USB completion to callback */
+	hydrasdr_timing_stats_t convert;  /* Unpacking and conversion to float/int16 */
+	hydrasdr_timing_stats_t filter;   /* IQ conversion: DC removal, fs/4 translation, FIR and decimation */
+	hydrasdr_timing_stats_t callback; /* Time spent in the user callback */
+} hydrasdr_stream_stats_t;
+
 typedef int (*hydrasdr_sample_block_cb_fn)(hydrasdr_transfer* transfer);
 
 extern ADDAPI void ADDCALL hydrasdr_lib_version(hydrasdr_lib_version_t* lib_version);
@@ -137,12 +159,19 @@ extern ADDAPI int ADDCALL hydrasdr_set_samplerate(struct hydrasdr_device* device
 extern ADDAPI int ADDCALL hydrasdr_set_conversion_filter_float32(struct hydrasdr_device* device, const float *kernel, const uint32_t len);
 extern ADDAPI int ADDCALL hydrasdr_set_conversion_filter_int16(struct hydrasdr_device* device, const int16_t *kernel, const uint32_t len);
 
+/* Parameter decimation shall be 1, 2, 4, 8 or 16: HYDRASDR_SAMPLE_FLOAT32_IQ output is decimated by a cascade of half-band filters, 1 (default) disables it.
+   Callbacks then deliver decimation times fewer samples per block */
+extern ADDAPI int ADDCALL hydrasdr_set_decimation(struct hydrasdr_device* device, uint32_t decimation);
+
 extern ADDAPI int ADDCALL hydrasdr_start_rx(struct hydrasdr_device* device, hydrasdr_sample_block_cb_fn callback, void* rx_ctx);
 extern ADDAPI int ADDCALL hydrasdr_stop_rx(struct hydrasdr_device* device);
 
 /* return HYDRASDR_TRUE if success */
 extern ADDAPI int ADDCALL hydrasdr_is_streaming(struct hydrasdr_device* device);
 
+/* Counters are reset by hydrasdr_start_rx() and kept after hydrasdr_stop_rx(). Cheap enough to poll while streaming */
+extern ADDAPI int ADDCALL hydrasdr_get_stream_stats(struct hydrasdr_device* device, hydrasdr_stream_stats_t* stats);
+
 extern ADDAPI int ADDCALL hydrasdr_si5351c_write(struct hydrasdr_device* device, uint8_t register_number, uint8_t value);
 extern ADDAPI int ADDCALL hydrasdr_si5351c_read(struct hydrasdr_device* device, uint8_t register_number, uint8_t* value);
 
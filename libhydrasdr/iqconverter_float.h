@@ -29,21 +29,41 @@ THE SOFTWARE.
 
 #define IQCONVERTER_NZEROS 2
 #define IQCONVERTER_NPOLES 2
+#define IQCONVERTER_DECIMATION_STAGES_MAX 4
+
+enum iqconverter_simd
+{
+	IQCONVERTER_SIMD_NONE = 0,
+	IQCONVERTER_SIMD_SSE2 = 1,
+	IQCONVERTER_SIMD_AVX2 = 2,
+	IQCONVERTER_SIMD_NEON = 3
+};
 
 typedef struct {
 	float avg;
 	float hbc;
 	int len;
+	int simd; /* enum iqconverter_simd, selected once in iqconverter_float_create() */
 	int fir_index;
 	int delay_index;
 	float *fir_kernel;
 	float *fir_queue;
 	float *delay_line;
+	int dec_stages;
+	int dec_len;
+	float dec_hbc;
+	float *dec_kernel;
+	float *dec_history[IQCONVERTER_DECIMATION_STAGES_MAX];
+	int dec_history_count[IQCONVERTER_DECIMATION_STAGES_MAX];
 } iqconverter_float_t;
 
 iqconverter_float_t *iqconverter_float_create(const float *hb_kernel, int len);
 void iqconverter_float_free(iqconverter_float_t *cnv);
 void iqconverter_float_reset(iqconverter_float_t *cnv);
 void iqconverter_float_process(iqconverter_float_t *cnv, float *samples, int len);
+/* Runs a cascade of up to IQCONVERTER_DECIMATION_STAGES_MAX half-band decimators in iqconverter_float_decimate(), 0 stages disables it */
+void iqconverter_float_set_decimation(iqconverter_float_t *cnv, const float *hb_kernel, int len, int stages);
+/* Decimates len interleaved IQ floats in place and returns the new length */
+int iqconverter_float_decimate(iqconverter_float_t *cnv, float *samples, int len);
 
 #endif // IQCONVERTER_FLOAT_H
@@ -37,6 +37,8 @@ typedef struct {
 	int32_t *fir_kernel;
 	int32_t *fir_queue;
 	int16_t *delay_line;
+	int simd_taps;
+	int16_t *simd_kernel;
 } iqconverter_int16_t;
 
 iqconverter_int16_t *iqconverter_int16_create(const int16_t *hb_kernel, int len);
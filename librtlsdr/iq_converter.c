@@ -0,0 +1,555 @@
+/*
+ * rtl-sdr, turns your Realtek RTL2832 based DVB dongle into a SDR receiver
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "iq_converter.h"
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#define USE_SSE2
+#include <immintrin.h>
+#if defined(__x86_64__) || defined(__i386__)
+#define USE_AVX2
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define USE_NEON
+#include <arm_neon.h>
+#endif
+
+/* one-pole smoothing of the per block DC estimate */
+#define DC_ALPHA	0.05f
+
+/*
+ * 47 tap half-band kernel, only the even taps and the center (0.5) are
+ * non-zero. hb_taps holds the even taps, the SIMD paths fold its symmetry.
+ */
+#define HB_LEN		47
+#define HB_TAPS		((HB_LEN + 1) / 2)
+#define HB_CENTER	(HB_LEN / 4)
+#define HB_HISTORY	(HB_LEN / 2)
+
+static const float hb_taps[HB_TAPS] = {
+	-0.000998606272947510f,  0.001695637278417295f,
+	-0.003054430179754289f,  0.005055504379767936f,
+	-0.007901319195893647f,  0.011873357051047719f,
+	-0.017411159379930066f,  0.025304817427568772f,
+	-0.037225225204559217f,  0.057533286997004301f,
+	-0.102327462004259350f,  0.317034472508947400f,
+	 0.317034472508947400f, -0.102327462004259350f,
+	 0.057533286997004301f, -0.037225225204559217f,
+	 0.025304817427568772f, -0.017411159379930066f,
+	 0.011873357051047719f, -0.007901319195893647f,
+	 0.005055504379767936f, -0.003054430179754289f,
+	 0.001695637278417295f, -0.000998606272947510f
+};
+
+/*
+ * One decimation stage works on the even and odd polyphase components of
+ * its input, each preceded by HB_HISTORY complex samples of the previous
+ * block, so that every output is a run of contiguous loads.
+ */
+struct hb_stage {
+	float *even;
+	float *odd;
+};
+
+struct iq_converter {
+	enum rtlsdr_sample_format format;
+	int dc_block;
+	int stages;
+	int use_avx2;
+	float dc_i;
+	float dc_q;
+	uint32_t capacity;	/* complex samples */
+	float *work;
+	int16_t *out16;
+	struct hb_stage stage[IQ_CONVERTER_MAX_STAGES];
+};
+
+static int detect_avx2(void)
+{
+#ifdef USE_AVX2
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+	return 0;
+#endif
+}
+
+/* uint8 to float, y = x / 128 - (127.5 / 128 + dc), returns the sums of y */
+static void convert_generic(const uint8_t *src, float *dst, uint32_t start,
+			    uint32_t count, float off_i, float off_q,
+			    float *sum_i, float *sum_q)
+{
+	uint32_t n;
+
+	for (n = start; n < count; n++) {
+		dst[2 * n] = src[2 * n] * (1.0f / 128.0f) - off_i;
+		dst[2 * n + 1] = src[2 * n + 1] * (1.0f / 128.0f) - off_q;
+		*sum_i += dst[2 * n];
+		*sum_q += dst[2 * n + 1];
+	}
+}
+
+#ifdef USE_SSE2
+static uint32_t convert_sse2(const uint8_t *src, float *dst, uint32_t count,
+			     float off_i, float off_q,
+			     float *sum_i, float *sum_q)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 scale = _mm_set1_ps(1.0f / 128.0f);
+	const __m128 off = _mm_setr_ps(off_i, off_q, off_i, off_q);
+	__m128 sum = _mm_setzero_ps();
+	__m128 x;
+	__m128i b, lo, hi;
+	float lanes[4];
+	uint32_t n;
+
+	for (n = 0; n + 8 <= count; n += 8) {
+		b = _mm_loadu_si128((const __m128i *)(src + 2 * n));
+		lo = _mm_unpacklo_epi8(b, zero);
+		hi = _mm_unpackhi_epi8(b, zero);
+
+		x = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale), off);
+		sum = _mm_add_ps(sum, x);
+		_mm_storeu_ps(dst + 2 * n, x);
+		x = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale), off);
+		sum = _mm_add_ps(sum, x);
+		_mm_storeu_ps(dst + 2 * n + 4, x);
+		x = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale), off);
+		sum = _mm_add_ps(sum, x);
+		_mm_storeu_ps(dst + 2 * n + 8, x);
+		x = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale), off);
+		sum = _mm_add_ps(sum, x);
+		_mm_storeu_ps(dst + 2 * n + 12, x);
+	}
+
+	_mm_storeu_ps(lanes, sum);
+	*sum_i += lanes[0] + lanes[2];
+	*sum_q += lanes[1] + lanes[3];
+
+	return n;
+}
+#endif
+
+#ifdef USE_AVX2
+AVX2_TARGET
+static uint32_t convert_avx2(const uint8_t *src, float *dst, uint32_t count,
+			     float off_i, float off_q,
+			     float *sum_i, float *sum_q)
+{
+	const __m256 scale = _mm256_set1_ps(1.0f / 128.0f);
+	const __m256 off = _mm256_setr_ps(off_i, off_q, off_i, off_q,
+					  off_i, off_q, off_i, off_q);
+	__m256 sum0 = _mm256_setzero_ps();
+	__m256 sum1 = _mm256_setzero_ps();
+	__m256 x0, x1;
+	float lanes[8];
+	uint32_t n;
+
+	for (n = 0; n + 8 <= count; n += 8) {
+		x0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + 2 * n))));
+		x1 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + 2 * n + 8))));
+		x0 = _mm256_fmsub_ps(x0, scale, off);
+		x1 = _mm256_fmsub_ps(x1, scale, off);
+		sum0 = _mm256_add_ps(sum0, x0);
+		sum1 = _mm256_add_ps(sum1, x1);
+		_mm256_storeu_ps(dst + 2 * n, x0);
+		_mm256_storeu_ps(dst + 2 * n + 8, x1);
+	}
+
+	_mm256_storeu_ps(lanes, _mm256_add_ps(sum0, sum1));
+	*sum_i += lanes[0] + lanes[2] + lanes[4] + lanes[6];
+	*sum_q += lanes[1] + lanes[3] + lanes[5] + lanes[7];
+
+	return n;
+}
+#endif
+
+#ifdef USE_NEON
+static uint32_t convert_neon(const uint8_t *src, float *dst, uint32_t count,
+			     float off_i, float off_q,
+			     float *sum_i, float *sum_q)
+{
+	const float off_lanes[4] = { off_i, off_q, off_i, off_q };
+	const float32x4_t off = vld1q_f32(off_lanes);
+	float32x4_t sum = vdupq_n_f32(0.0f);
+	float32x4_t x[4];
+	uint8x16_t b;
+	uint16x8_t lo, hi;
+	float lanes[4];
+	uint32_t n;
+	int k;
+
+	for (n = 0; n + 8 <= count; n += 8) {
+		b = vld1q_u8(src + 2 * n);
+		lo = vmovl_u8(vget_low_u8(b));
+		hi = vmovl_u8(vget_high_u8(b));
+		x[0] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(lo)));
+		x[1] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(lo)));
+		x[2] = vcvtq_f32_u32(vmovl_u16(vget_low_u16(hi)));
+		x[3] = vcvtq_f32_u32(vmovl_u16(vget_high_u16(hi)));
+
+		for (k = 0; k < 4; k++) {
+			x[k] = vsubq_f32(vmulq_n_f32(x[k], 1.0f / 128.0f), off);
+			sum = vaddq_f32(sum, x[k]);
+			vst1q_f32(dst + 2 * n + 4 * k, x[k]);
+		}
+	}
+
+	vst1q_f32(lanes, sum);
+	*sum_i += lanes[0] + lanes[2];
+	*sum_q += lanes[1] + lanes[3];
+
+	return n;
+}
+#endif
+
+/* split count complex samples into even and odd ones */
+static void deinterleave(const float *src, float *even, float *odd,
+			 uint32_t count)
+{
+	uint32_t m = 0;
+
+#ifdef USE_SSE2
+	__m128 a, b;
+
+	for (; m + 2 <= count / 2; m += 2) {
+		a = _mm_loadu_ps(src + 4 * m);
+		b = _mm_loadu_ps(src + 4 * m + 4);
+		_mm_storeu_ps(even + 2 * m, _mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 1, 0)));
+		_mm_storeu_ps(odd + 2 * m, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 2, 3, 2)));
+	}
+#endif
+
+	for (; m < count / 2; m++) {
+		even[2 * m] = src[4 * m];
+		even[2 * m + 1] = src[4 * m + 1];
+		odd[2 * m] = src[4 * m + 2];
+		odd[2 * m + 1] = src[4 * m + 3];
+	}
+}
+
+/* y[n] = sum h[2i] even[n + i] + 0.5 odd[n + HB_CENTER] */
+static void filter_generic(const float *even, const float *odd, float *dst,
+			   uint32_t start, uint32_t count)
+{
+	uint32_t n;
+	int i;
+	float acc_i, acc_q;
+
+	for (n = start; n < count; n++) {
+		acc_i = 0.5f * odd[2 * (n + HB_CENTER)];
+		acc_q = 0.5f * odd[2 * (n + HB_CENTER) + 1];
+		for (i = 0; i < HB_TAPS; i++) {
+			acc_i += hb_taps[i] * even[2 * (n + i)];
+			acc_q += hb_taps[i] * even[2 * (n + i) + 1];
+		}
+		dst[2 * n] = acc_i;
+		dst[2 * n + 1] = acc_q;
+	}
+}
+
+#ifdef USE_SSE2
+static uint32_t filter_sse2(const float *even, const float *odd, float *dst,
+			    uint32_t count)
+{
+	const __m128 half = _mm_set1_ps(0.5f);
+	__m128 acc;
+	uint32_t n;
+	int i;
+
+	for (n = 0; n + 2 <= count; n += 2) {
+		acc = _mm_mul_ps(half, _mm_loadu_ps(odd + 2 * (n + HB_CENTER)));
+		for (i = 0; i < HB_TAPS / 2; i++)
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(hb_taps[i]),
+					 _mm_add_ps(_mm_loadu_ps(even + 2 * (n + i)),
+						    _mm_loadu_ps(even + 2 * (n + HB_TAPS - 1 - i)))));
+		_mm_storeu_ps(dst + 2 * n, acc);
+	}
+
+	return n;
+}
+#endif
+
+#ifdef USE_AVX2
+AVX2_TARGET
+static uint32_t filter_avx2(const float *even, const float *odd, float *dst,
+			    uint32_t count)
+{
+	const __m256 half = _mm256_set1_ps(0.5f);
+	__m256 acc0, acc1;
+	uint32_t n;
+	int i;
+
+	for (n = 0; n + 4 <= count; n += 4) {
+		/* two accumulators to hide the FMA latency */
+		acc0 = _mm256_mul_ps(half, _mm256_loadu_ps(odd + 2 * (n + HB_CENTER)));
+		acc1 = _mm256_setzero_ps();
+		for (i = 0; i + 1 < HB_TAPS / 2; i += 2) {
+			acc0 = _mm256_fmadd_ps(_mm256_set1_ps(hb_taps[i]),
+					       _mm256_add_ps(_mm256_loadu_ps(even + 2 * (n + i)),
+							     _mm256_loadu_ps(even + 2 * (n + HB_TAPS - 1 - i))), acc0);
+			acc1 = _mm256_fmadd_ps(_mm256_set1_ps(hb_taps[i + 1]),
+					       _mm256_add_ps(_mm256_loadu_ps(even + 2 * (n + i + 1)),
+							     _mm256_loadu_ps(even + 2 * (n + HB_TAPS - 2 - i))), acc1);
+		}
+		_mm256_storeu_ps(dst + 2 * n, _mm256_add_ps(acc0, acc1));
+	}
+
+	return n;
+}
+#endif
+
+#ifdef USE_NEON
+static uint32_t filter_neon(const float *even, const float *odd, float *dst,
+			    uint32_t count)
+{
+	float32x4_t acc;
+	uint32_t n;
+	int i;
+
+	for (n = 0; n + 2 <= count; n += 2) {
+		acc = vmulq_n_f32(vld1q_f32(odd + 2 * (n + HB_CENTER)), 0.5f);
+		for (i = 0; i < HB_TAPS / 2; i++)
+			acc = vmlaq_n_f32(acc, vaddq_f32(vld1q_f32(even + 2 * (n + i)),
+						  vld1q_f32(even + 2 * (n + HB_TAPS - 1 - i))), hb_taps[i]);
+		vst1q_f32(dst + 2 * n, acc);
+	}
+
+	return n;
+}
+#endif
+
+/* decimate count complex samples of buf in place by 2, returns count / 2 */
+static uint32_t decimate(iq_converter_t *cnv, struct hb_stage *stage,
+			 float *buf, uint32_t count)
+{
+	uint32_t out = count / 2;
+	uint32_t n = 0;
+
+	deinterleave(buf, stage->even + 2 * HB_HISTORY,
+		     stage->odd + 2 * HB_HISTORY, count);
+
+#if defined(USE_AVX2)
+	if (cnv->use_avx2)
+		n = filter_avx2(stage->even, stage->odd, buf, out);
+	else
+		n = filter_sse2(stage->even, stage->odd, buf, out);
+#elif defined(USE_SSE2)
+	n = filter_sse2(stage->even, stage->odd, buf, out);
+#elif defined(USE_NEON)
+	n = filter_neon(stage->even, stage->odd, buf, out);
+#endif
+	filter_generic(stage->even, stage->odd, buf, n, out);
+
+	memmove(stage->even, stage->even + 2 * out, 2 * HB_HISTORY * sizeof(float));
+	memmove(stage->odd, stage->odd + 2 * out, 2 * HB_HISTORY * sizeof(float));
+
+	return out;
+}
+
+#if defined(USE_NEON)
+/* lrintf() rounding for 4 lanes, plain vcvtq_s32_f32() would truncate */
+static inline int32x4_t neon_lrint(float32x4_t x)
+{
+#if defined(__aarch64__)
+	return vcvtnq_s32_f32(x);
+#else
+	uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(x), vdupq_n_u32(0x80000000u));
+	float32x4_t half = vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(vdupq_n_f32(0.5f)), sign));
+
+	return vcvtq_s32_f32(vaddq_f32(x, half));
+#endif
+}
+#endif
+
+static void to_int16(const float *src, int16_t *dst, uint32_t count)
+{
+	uint32_t n = 0;
+	float x;
+
+#if defined(USE_SSE2)
+	const __m128 full_scale = _mm_set1_ps(32768.0f);
+
+	/* cvtps rounds to nearest and packs saturates */
+	for (; n + 4 <= count; n += 4)
+		_mm_storeu_si128((__m128i *)(dst + 2 * n), _mm_packs_epi32(
+			_mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + 2 * n), full_scale)),
+			_mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + 2 * n + 4), full_scale))));
+#elif defined(USE_NEON)
+	for (; n + 4 <= count; n += 4)
+		vst1q_s16(dst + 2 * n, vcombine_s16(
+			vqmovn_s32(neon_lrint(vmulq_n_f32(vld1q_f32(src + 2 * n), 32768.0f))),
+			vqmovn_s32(neon_lrint(vmulq_n_f32(vld1q_f32(src + 2 * n + 4), 32768.0f)))));
+#endif
+
+	for (n *= 2; n < 2 * count; n++) {
+		x = src[n] * 32768.0f;
+		dst[n] = x >= 32767.0f ? 32767 : (x <= -32768.0f ? -32768 : (int16_t)lrintf(x));
+	}
+}
+
+static int reserve(iq_converter_t *cnv, uint32_t count)
+{
+	int i;
+	float *work;
+	int16_t *out16;
+
+	if (count <= cnv->capacity)
+		return 0;
+
+	/* the old buffers and capacity stay valid until both allocations succeed */
+	work = malloc(count * 2 * sizeof(float));
+	out16 = malloc(count * 2 * sizeof(int16_t));
+	if (!work || !out16) {
+		free(work);
+		free(out16);
+		return -1;
+	}
+
+	free(cnv->work);
+	free(cnv->out16);
+	cnv->work = work;
+	cnv->out16 = out16;
+
+	/* history is kept, the stage buffers only grow at the end */
+	for (i = 0; i < cnv->stages; i++) {
+		size_t len = (HB_HISTORY + (count >> (i + 1))) * 2 * sizeof(float);
+		float *even = realloc(cnv->stage[i].even, len);
+		float *odd = even ? realloc(cnv->stage[i].odd, len) : NULL;
+
+		if (even)
+			cnv->stage[i].even = even;
+		if (odd)
+			cnv->stage[i].odd = odd;
+		if (!even || !odd)
+			return -1;
+	}
+
+	cnv->capacity = count;
+	return 0;
+}
+
+iq_converter_t *iq_converter_create(enum rtlsdr_sample_format format,
+				    int dc_block, int decimation)
+{
+	iq_converter_t *cnv;
+	int i;
+
+	if (format != RTLSDR_SAMPLE_FLOAT32_IQ && format != RTLSDR_SAMPLE_INT16_IQ)
+		return NULL;
+
+	cnv = calloc(1, sizeof(iq_converter_t));
+	if (!cnv)
+		return NULL;
+
+	cnv->format = format;
+	cnv->dc_block = dc_block;
+	cnv->use_avx2 = detect_avx2();
+
+	for (i = 1; i < decimation && cnv->stages < IQ_CONVERTER_MAX_STAGES; i <<= 1)
+		cnv->stages++;
+
+	for (i = 0; i < cnv->stages; i++) {
+		cnv->stage[i].even = calloc(2 * HB_HISTORY, sizeof(float));
+		cnv->stage[i].odd = calloc(2 * HB_HISTORY, sizeof(float));
+		if (!cnv->stage[i].even || !cnv->stage[i].odd) {
+			iq_converter_free(cnv);
+			return NULL;
+		}
+	}
+
+	return cnv;
+}
+
+void iq_converter_free(iq_converter_t *cnv)
+{
+	int i;
+
+	if (!cnv)
+		return;
+
+	for (i = 0; i < IQ_CONVERTER_MAX_STAGES; i++) {
+		free(cnv->stage[i].even);
+		free(cnv->stage[i].odd);
+	}
+	free(cnv->work);
+	free(cnv->out16);
+	free(cnv);
+}
+
+void iq_converter_reset(iq_converter_t *cnv)
+{
+	int i;
+
+	cnv->dc_i = 0.0f;
+	cnv->dc_q = 0.0f;
+
+	for (i = 0; i < cnv->stages; i++) {
+		memset(cnv->stage[i].even, 0, 2 * HB_HISTORY * sizeof(float));
+		memset(cnv->stage[i].odd, 0, 2 * HB_HISTORY * sizeof(float));
+	}
+}
+
+int iq_converter_process(iq_converter_t *cnv, const uint8_t *src,
+			 uint32_t sample_count, void **out)
+{
+	const float off_i = 127.5f / 128.0f + cnv->dc_i;
+	const float off_q = 127.5f / 128.0f + cnv->dc_q;
+	float sum_i = 0.0f, sum_q = 0.0f;
+	uint32_t count, n = 0;
+	int i;
+
+	/* every stage needs an even number of samples */
+	sample_count &= ~((1u << cnv->stages) - 1);
+	if (reserve(cnv, sample_count) < 0)
+		return -1;
+
+#if defined(USE_AVX2)
+	if (cnv->use_avx2)
+		n = convert_avx2(src, cnv->work, sample_count, off_i, off_q, &sum_i, &sum_q);
+	else
+		n = convert_sse2(src, cnv->work, sample_count, off_i, off_q, &sum_i, &sum_q);
+#elif defined(USE_SSE2)
+	n = convert_sse2(src, cnv->work, sample_count, off_i, off_q, &sum_i, &sum_q);
+#elif defined(USE_NEON)
+	n = convert_neon(src, cnv->work, sample_count, off_i, off_q, &sum_i, &sum_q);
+#endif
+	convert_generic(src, cnv->work, n, sample_count, off_i, off_q, &sum_i, &sum_q);
+
+	if (cnv->dc_block && sample_count > 0) {
+		cnv->dc_i += DC_ALPHA * sum_i / sample_count;
+		cnv->dc_q += DC_ALPHA * sum_q / sample_count;
+	}
+
+	count = sample_count;
+	for (i = 0; i < cnv->stages; i++)
+		count = decimate(cnv, &cnv->stage[i], cnv->work, count);
+
+	if (cnv->format == RTLSDR_SAMPLE_INT16_IQ) {
+		to_int16(cnv->work, cnv->out16, count);
+		*out = cnv->out16;
+	} else {
+		*out = cnv->work;
+	}
+
+	return (int)count;
+}
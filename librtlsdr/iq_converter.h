@@ -0,0 +1,45 @@
+/*
+ * rtl-sdr, turns your Realtek RTL2832 based DVB dongle into a SDR receiver
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __IQ_CONVERTER_H
+#define __IQ_CONVERTER_H
+
+#include <stdint.h>
+#include "rtl-sdr.h"
+
+/*
+ * Turns the offset binary uint8 IQ stream into float or int16 IQ, with an
+ * optional DC block and a cascade of half-band decimators by 2.
+ */
+
+#define IQ_CONVERTER_MAX_STAGES 3
+
+typedef struct iq_converter iq_converter_t;
+
+iq_converter_t *iq_converter_create(enum rtlsdr_sample_format format,
+				    int dc_block, int decimation);
+void iq_converter_free(iq_converter_t *cnv);
+void iq_converter_reset(iq_converter_t *cnv);
+
+/*
+ * Convert sample_count complex samples, returns the number of complex
+ * samples stored in *out (valid until the next call) or -1 on error.
+ */
+int iq_converter_process(iq_converter_t *cnv, const uint8_t *src,
+			 uint32_t sample_count, void **out);
+
+#endif /* __IQ_CONVERTER_H */
@@ -24,11 +24,19 @@
 #include <stdlib.h>
 #ifndef _WIN32
 #include <unistd.h>
+#include <time.h>
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 #endif
 
 #include <libusb.h>
 
+#ifdef _WIN32
+/* Avoid redefinition of timespec from time.h (included by libusb.h) */
+#define HAVE_STRUCT_TIMESPEC 1
+#endif
+#include <pthread.h>
+#include <sched.h>
+
 /*
  * All libusb callback functions should be marked with the LIBUSB_CALL macro
  * to ensure that they are compiled with the same calling convention as libusb.
@@ -48,6 +56,8 @@
 #include "tuner_fc0013.h"
 #include "tuner_fc2580.h"
 #include "tuner_r82xx.h"
+#include "iq_converter.h"
+#include "../common/sdr_atomic.h"
 
 typedef struct rtlsdr_tuner_iface {
 	/* tuner interface */
@@ -67,6 +77,7 @@ enum rtlsdr_async_status {
 };
 
 #define FIR_LEN 16
+#define MAX_MARKERS 64
 
 /*
  * FIR coefficients.
@@ -98,6 +109,48 @@ struct rtlsdr_dev {
 	enum rtlsdr_async_status async_status;
 	int async_cancel;
 	int use_zerocopy;
+	/* converted output */
+	enum rtlsdr_sample_format out_format;
+	int out_dc_block;
+	int out_decimation;
+	iq_converter_t *cnv;
+	rtlsdr_read_async_converted_cb_t converted_cb;
+	void *converted_ctx;
+	/*
+	 * consumer thread mode, enabled when consumer_queue_len > 0.
+	 * _enqueue_transfer() swaps the libusb buffer into slot queue_head and
+	 * _consumer_threadproc() frees slot queue_tail; consumer_mp only
+	 * guards the sleep on consumer_cv.
+	 */
+	uint32_t consumer_queue_len;
+	int consumer_active;
+	unsigned char **queue_buf;	/* buffer currently owned by each slot */
+	unsigned char **queue_pool;	/* pool allocations, for freeing */
+	uint32_t *queue_len;
+	uint64_t *queue_first;		/* stream index of each queued buffer */
+	volatile uint32_t queue_head;
+	volatile uint32_t queue_tail;
+	volatile int consumer_stop;
+	volatile uint32_t consumer_waiting;
+	pthread_t consumer_thread;
+	pthread_mutex_t consumer_mp;
+	pthread_cond_t consumer_cv;
+	/* counters updated by the libusb and consumer threads, guarded by stats_mp */
+	pthread_mutex_t stats_mp;
+	rtlsdr_async_stats_t async_stats;
+	/* sample counting and retune markers, guarded by marker_mp */
+	pthread_mutex_t marker_mp;
+	uint64_t sample_count;		/* samples received since the read started */
+	uint64_t sample_time_us;	/* when sample_count was last updated */
+	int markers_enabled;
+	rtlsdr_marker_t markers[MAX_MARKERS];
+	uint32_t marker_head;
+	uint32_t marker_tail;
+	/* metadata output, only touched by the thread running the callback */
+	uint64_t cb_first_sample;
+	rtlsdr_marker_t meta_markers[MAX_MARKERS];
+	rtlsdr_read_async_meta_cb_t meta_cb;
+	void *meta_ctx;
 	/* rtl demod context */
 	uint32_t rate; /* Hz */
 	uint32_t rtl_xtal; /* Hz */
@@ -115,6 +168,11 @@ struct rtlsdr_dev {
 	struct e4k_state e4k_s;
 	struct r82xx_config r82xx_c;
 	struct r82xx_priv r82xx_p;
+	/* frequency hopping */
+	uint32_t *hop_freqs;
+	struct r82xx_hop *hop_list;	/* R82xx register images, if supported */
+	uint32_t hop_count;
+	uint32_t hop_offs_freq;
 	/* status */
 	int dev_lost;
 	int driver_active;
@@ -353,6 +411,8 @@ static rtlsdr_dongle_t known_devices[] = {
 
 #define DEFAULT_BUF_NUMBER	15
 #define DEFAULT_BUF_LENGTH	(16 * 32 * 512)
+#define MAX_CONSUMER_QUEUE	1024
+#define CONSUMER_SPIN_COUNT	16
 
 #define DEF_RTL_XTAL_FREQ	28800000
 #define MIN_RTL_XTAL_FREQ	(DEF_RTL_XTAL_FREQ - 1000)
@@ -881,13 +941,84 @@ int rtlsdr_read_eeprom(rtlsdr_dev_t *dev, uint8_t *data, uint8_t offset, uint16_
 	return r;
 }
 
+static uint64_t _rtlsdr_time_us(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, now;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+
+	return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000 +
+	       (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/*
+ * Estimate the index of the sample the device is producing right now: the
+ * samples received so far plus what was sampled since the last transfer
+ * completed, at most what the pending transfers can hold. Called with
+ * marker_mp held.
+ */
+static uint64_t _rtlsdr_sample_index(rtlsdr_dev_t *dev)
+{
+	uint64_t ahead, max_ahead;
+
+	ahead = (_rtlsdr_time_us() - dev->sample_time_us) * dev->rate / 1000000;
+	max_ahead = (uint64_t)dev->xfer_buf_num * dev->xfer_buf_len / 2;
+
+	return dev->sample_count + min(ahead, max_ahead);
+}
+
+static int _rtlsdr_marker_begin(rtlsdr_dev_t *dev, uint64_t *issued)
+{
+	int enabled;
+
+	pthread_mutex_lock(&dev->marker_mp);
+	enabled = dev->markers_enabled;
+	if (enabled)
+		*issued = _rtlsdr_sample_index(dev);
+	pthread_mutex_unlock(&dev->marker_mp);
+
+	return enabled;
+}
+
+static void _rtlsdr_marker_end(rtlsdr_dev_t *dev, enum rtlsdr_marker_type type,
+			       int64_t value, uint64_t issued, int result)
+{
+	rtlsdr_marker_t *m;
+
+	pthread_mutex_lock(&dev->marker_mp);
+	if (dev->markers_enabled &&
+	    dev->marker_head - dev->marker_tail < MAX_MARKERS) {
+		m = &dev->markers[dev->marker_head % MAX_MARKERS];
+		m->type = type;
+		m->value = value;
+		m->result = result;
+		m->issued = issued;
+		m->completed = _rtlsdr_sample_index(dev);
+		dev->marker_head++;
+	}
+	pthread_mutex_unlock(&dev->marker_mp);
+}
+
 int rtlsdr_set_center_freq(rtlsdr_dev_t *dev, uint32_t freq)
 {
 	int r = -1;
+	int marked;
+	uint64_t issued = 0;
 
 	if (!dev || !dev->tuner)
 		return -1;
 
+	marked = _rtlsdr_marker_begin(dev, &issued);
+
 	if (dev->direct_sampling) {
 		r = rtlsdr_set_if_freq(dev, freq);
 	} else if (dev->tuner && dev->tuner->set_freq) {
@@ -901,6 +1032,9 @@ int rtlsdr_set_center_freq(rtlsdr_dev_t *dev, uint32_t freq)
 	else
 		dev->freq = 0;
 
+	if (marked)
+		_rtlsdr_marker_end(dev, RTLSDR_MARKER_FREQ, freq, issued, r);
+
 	return r;
 }
 
@@ -912,6 +1046,98 @@ uint32_t rtlsdr_get_center_freq(rtlsdr_dev_t *dev)
 	return dev->freq;
 }
 
+static void rtlsdr_free_hop_list(rtlsdr_dev_t *dev)
+{
+	free(dev->hop_freqs);
+	free(dev->hop_list);
+	dev->hop_freqs = NULL;
+	dev->hop_list = NULL;
+	dev->hop_count = 0;
+}
+
+int rtlsdr_prepare_hop_list(rtlsdr_dev_t *dev, const uint32_t *freqs,
+			    uint32_t count)
+{
+	uint32_t i;
+	int r = 0;
+
+	if (!dev || !dev->tuner)
+		return -1;
+
+	rtlsdr_free_hop_list(dev);
+
+	if (!count)
+		return 0;
+
+	if (!freqs)
+		return -1;
+
+	dev->hop_freqs = malloc(count * sizeof(uint32_t));
+	if (!dev->hop_freqs)
+		return -ENOMEM;
+
+	memcpy(dev->hop_freqs, freqs, count * sizeof(uint32_t));
+	dev->hop_count = count;
+	dev->hop_offs_freq = dev->offs_freq;
+
+	/* other tuners hop through rtlsdr_set_center_freq() */
+	if ((dev->tuner_type != RTLSDR_TUNER_R820T) &&
+	    (dev->tuner_type != RTLSDR_TUNER_R828D))
+		return 0;
+
+	dev->hop_list = malloc(count * sizeof(struct r82xx_hop));
+	if (!dev->hop_list) {
+		rtlsdr_free_hop_list(dev);
+		return -ENOMEM;
+	}
+
+	rtlsdr_set_i2c_repeater(dev, 1);
+	for (i = 0; i < count; i++) {
+		r = r82xx_prepare_hop(&dev->r82xx_p, freqs[i] - dev->offs_freq,
+				      &dev->hop_list[i]);
+		if (r < 0)
+			break;
+	}
+	rtlsdr_set_i2c_repeater(dev, 0);
+
+	if (r < 0)
+		rtlsdr_free_hop_list(dev);
+
+	return r;
+}
+
+int rtlsdr_set_hop_index(rtlsdr_dev_t *dev, uint32_t index)
+{
+	int r = -1;
+	int marked;
+	uint64_t issued = 0;
+
+	if (!dev || !dev->tuner || index >= dev->hop_count)
+		return -1;
+
+	/* the images assume the tuner mode they were prepared in */
+	if (!dev->hop_list || dev->direct_sampling ||
+	    (dev->offs_freq != dev->hop_offs_freq))
+		return rtlsdr_set_center_freq(dev, dev->hop_freqs[index]);
+
+	marked = _rtlsdr_marker_begin(dev, &issued);
+
+	rtlsdr_set_i2c_repeater(dev, 1);
+	r = r82xx_set_hop(&dev->r82xx_p, &dev->hop_list[index]);
+	rtlsdr_set_i2c_repeater(dev, 0);
+
+	if (!r)
+		dev->freq = dev->hop_freqs[index];
+	else
+		dev->freq = 0;
+
+	if (marked)
+		_rtlsdr_marker_end(dev, RTLSDR_MARKER_FREQ,
+				   dev->hop_freqs[index], issued, r);
+
+	return r;
+}
+
 int rtlsdr_set_freq_correction(rtlsdr_dev_t *dev, int ppm)
 {
 	int r = 0;
@@ -1028,10 +1254,14 @@ int rtlsdr_set_tuner_bandwidth(rtlsdr_dev_t *dev, uint32_t bw)
 int rtlsdr_set_tuner_gain(rtlsdr_dev_t *dev, int gain)
 {
 	int r = 0;
+	int marked;
+	uint64_t issued = 0;
 
 	if (!dev || !dev->tuner)
 		return -1;
 
+	marked = _rtlsdr_marker_begin(dev, &issued);
+
 	if (dev->tuner->set_gain) {
 		rtlsdr_set_i2c_repeater(dev, 1);
 		r = dev->tuner->set_gain((void *)dev, gain);
@@ -1043,6 +1273,9 @@ int rtlsdr_set_tuner_gain(rtlsdr_dev_t *dev, int gain)
 	else
 		dev->gain = 0;
 
+	if (marked)
+		_rtlsdr_marker_end(dev, RTLSDR_MARKER_GAIN, gain, issued, r);
+
 	return r;
 }
 
@@ -1073,16 +1306,23 @@ int rtlsdr_set_tuner_if_gain(rtlsdr_dev_t *dev, int stage, int gain)
 int rtlsdr_set_tuner_gain_mode(rtlsdr_dev_t *dev, int mode)
 {
 	int r = 0;
+	int marked;
+	uint64_t issued = 0;
 
 	if (!dev || !dev->tuner)
 		return -1;
 
+	marked = _rtlsdr_marker_begin(dev, &issued);
+
 	if (dev->tuner->set_gain_mode) {
 		rtlsdr_set_i2c_repeater(dev, 1);
 		r = dev->tuner->set_gain_mode((void *)dev, mode);
 		rtlsdr_set_i2c_repeater(dev, 0);
 	}
 
+	if (marked)
+		_rtlsdr_marker_end(dev, RTLSDR_MARKER_GAIN_MODE, mode, issued, r);
+
 	return r;
 }
 
@@ -1573,6 +1813,9 @@ found:
 
 	rtlsdr_set_i2c_repeater(dev, 0);
 
+	pthread_mutex_init(&dev->marker_mp, NULL);
+	pthread_mutex_init(&dev->stats_mp, NULL);
+
 	*out_dev = dev;
 
 	return 0;
@@ -1735,6 +1978,9 @@ int rtlsdr_close(rtlsdr_dev_t *dev)
 
 	libusb_exit(dev->ctx);
 
+	rtlsdr_free_hop_list(dev);
+	pthread_mutex_destroy(&dev->marker_mp);
+	pthread_mutex_destroy(&dev->stats_mp);
 	free(dev);
 
 	return 0;
@@ -1759,13 +2005,200 @@ int rtlsdr_read_sync(rtlsdr_dev_t *dev, void *buf, int len, int *n_read)
 	return libusb_bulk_transfer(dev->devh, 0x81, buf, len, n_read, BULK_TIMEOUT);
 }
 
+/* consumer mode: swap the filled buffer with a free queue slot */
+static void _enqueue_transfer(rtlsdr_dev_t *dev, struct libusb_transfer *xfer,
+			      uint64_t first_sample)
+{
+	uint32_t head = dev->queue_head;
+	uint32_t depth = head - ATOMIC_LOAD(&dev->queue_tail);
+	uint32_t index;
+	unsigned char *temp;
+
+	if (depth >= dev->consumer_queue_len) {
+		pthread_mutex_lock(&dev->stats_mp);
+		dev->async_stats.dropped++;
+		pthread_mutex_unlock(&dev->stats_mp);
+		return;
+	}
+
+	index = head & (dev->consumer_queue_len - 1);
+	temp = dev->queue_buf[index];
+	dev->queue_buf[index] = xfer->buffer;
+	dev->queue_len[index] = xfer->actual_length;
+	dev->queue_first[index] = first_sample;
+	xfer->buffer = temp;
+
+	pthread_mutex_lock(&dev->stats_mp);
+	if (depth + 1 > dev->async_stats.queue_depth_max)
+		dev->async_stats.queue_depth_max = depth + 1;
+	pthread_mutex_unlock(&dev->stats_mp);
+
+	ATOMIC_STORE(&dev->queue_head, head + 1);
+
+	if (ATOMIC_LOAD(&dev->consumer_waiting)) {
+		pthread_mutex_lock(&dev->consumer_mp);
+		pthread_cond_signal(&dev->consumer_cv);
+		pthread_mutex_unlock(&dev->consumer_mp);
+	}
+}
+
+static int _wait_for_transfer(rtlsdr_dev_t *dev, uint32_t tail)
+{
+	int spin;
+
+	for (spin = 0; spin < CONSUMER_SPIN_COUNT; spin++) {
+		if (ATOMIC_LOAD(&dev->queue_head) != tail)
+			return 1;
+
+		if (dev->consumer_stop)
+			return 0;
+
+		sched_yield();
+	}
+
+	pthread_mutex_lock(&dev->consumer_mp);
+	ATOMIC_STORE(&dev->consumer_waiting, 1);
+
+	while (ATOMIC_LOAD(&dev->queue_head) == tail && !dev->consumer_stop)
+		pthread_cond_wait(&dev->consumer_cv, &dev->consumer_mp);
+
+	ATOMIC_STORE(&dev->consumer_waiting, 0);
+	pthread_mutex_unlock(&dev->consumer_mp);
+
+	return !dev->consumer_stop;
+}
+
+static void *_consumer_threadproc(void *arg)
+{
+	rtlsdr_dev_t *dev = (rtlsdr_dev_t *)arg;
+	uint32_t tail, index;
+
+	while (!dev->consumer_stop) {
+		tail = dev->queue_tail;
+
+		if (!_wait_for_transfer(dev, tail))
+			break;
+
+		index = tail & (dev->consumer_queue_len - 1);
+		dev->cb_first_sample = dev->queue_first[index];
+
+		if (dev->cb)
+			dev->cb(dev->queue_buf[index], dev->queue_len[index], dev->cb_ctx);
+
+		pthread_mutex_lock(&dev->stats_mp);
+		dev->async_stats.delivered++;
+		pthread_mutex_unlock(&dev->stats_mp);
+
+		/* buf is the callback's until it returns, then _enqueue_transfer() may reuse it */
+		ATOMIC_STORE(&dev->queue_tail, tail + 1);
+	}
+
+	return NULL;
+}
+
+static int _rtlsdr_start_consumer(rtlsdr_dev_t *dev)
+{
+	uint32_t i;
+
+	dev->consumer_active = 0;
+
+	if (!dev->consumer_queue_len)
+		return 0;
+
+	dev->queue_buf = calloc(dev->consumer_queue_len, sizeof(unsigned char *));
+	dev->queue_pool = calloc(dev->consumer_queue_len, sizeof(unsigned char *));
+	dev->queue_len = calloc(dev->consumer_queue_len, sizeof(uint32_t));
+	dev->queue_first = calloc(dev->consumer_queue_len, sizeof(uint64_t));
+	if (!dev->queue_buf || !dev->queue_pool || !dev->queue_len ||
+	    !dev->queue_first)
+		return -ENOMEM;
+
+	for (i = 0; i < dev->consumer_queue_len; i++) {
+		dev->queue_pool[i] = malloc(dev->xfer_buf_len);
+		if (!dev->queue_pool[i])
+			return -ENOMEM;
+		dev->queue_buf[i] = dev->queue_pool[i];
+	}
+
+	dev->queue_head = 0;
+	dev->queue_tail = 0;
+	dev->consumer_stop = 0;
+	dev->consumer_waiting = 0;
+	pthread_mutex_init(&dev->consumer_mp, NULL);
+	pthread_cond_init(&dev->consumer_cv, NULL);
+
+	if (pthread_create(&dev->consumer_thread, NULL, _consumer_threadproc, dev)) {
+		pthread_cond_destroy(&dev->consumer_cv);
+		pthread_mutex_destroy(&dev->consumer_mp);
+		return -1;
+	}
+
+	dev->consumer_active = 1;
+	return 0;
+}
+
+static void _rtlsdr_stop_consumer(rtlsdr_dev_t *dev)
+{
+	uint32_t i;
+
+	if (dev->consumer_active) {
+		pthread_mutex_lock(&dev->consumer_mp);
+		dev->consumer_stop = 1;
+		pthread_cond_signal(&dev->consumer_cv);
+		pthread_mutex_unlock(&dev->consumer_mp);
+
+		pthread_join(dev->consumer_thread, NULL);
+		pthread_cond_destroy(&dev->consumer_cv);
+		pthread_mutex_destroy(&dev->consumer_mp);
+		dev->consumer_active = 0;
+	}
+
+	/*
+	 * Buffers travel between the transfers and the queue, every one is
+	 * released through the array it was allocated in.
+	 */
+	if (dev->queue_pool) {
+		for (i = 0; i < dev->consumer_queue_len; i++)
+			free(dev->queue_pool[i]);
+	}
+
+	free(dev->queue_pool);
+	free(dev->queue_buf);
+	free(dev->queue_len);
+	free(dev->queue_first);
+	dev->queue_pool = NULL;
+	dev->queue_buf = NULL;
+	dev->queue_len = NULL;
+	dev->queue_first = NULL;
+}
+
 static void LIBUSB_CALL _libusb_callback(struct libusb_transfer *xfer)
 {
 	rtlsdr_dev_t *dev = (rtlsdr_dev_t *)xfer->user_data;
+	uint64_t first_sample;
 
 	if (LIBUSB_TRANSFER_COMPLETED == xfer->status) {
-		if (dev->cb)
-			dev->cb(xfer->buffer, xfer->actual_length, dev->cb_ctx);
+		pthread_mutex_lock(&dev->stats_mp);
+		dev->async_stats.transfers++;
+		pthread_mutex_unlock(&dev->stats_mp);
+
+		pthread_mutex_lock(&dev->marker_mp);
+		first_sample = dev->sample_count;
+		dev->sample_count += xfer->actual_length / 2;
+		dev->sample_time_us = _rtlsdr_time_us();
+		pthread_mutex_unlock(&dev->marker_mp);
+
+		if (dev->consumer_active) {
+			_enqueue_transfer(dev, xfer, first_sample);
+		} else {
+			dev->cb_first_sample = first_sample;
+			if (dev->cb)
+				dev->cb(xfer->buffer, xfer->actual_length, dev->cb_ctx);
+
+			pthread_mutex_lock(&dev->stats_mp);
+			dev->async_stats.delivered++;
+			pthread_mutex_unlock(&dev->stats_mp);
+		}
 
 		libusb_submit_transfer(xfer); /* resubmit transfer */
 		dev->xfer_errors = 0;
@@ -1943,6 +2376,27 @@ int rtlsdr_read_async(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb, void *ctx,
 
 	_rtlsdr_alloc_async_buffers(dev);
 
+	pthread_mutex_lock(&dev->stats_mp);
+	memset(&dev->async_stats, 0, sizeof(dev->async_stats));
+	pthread_mutex_unlock(&dev->stats_mp);
+
+	pthread_mutex_lock(&dev->marker_mp);
+	dev->sample_count = 0;
+	dev->sample_time_us = _rtlsdr_time_us();
+	dev->marker_head = 0;
+	dev->marker_tail = 0;
+	dev->markers_enabled = (dev->meta_cb != NULL);
+	pthread_mutex_unlock(&dev->marker_mp);
+
+	r = _rtlsdr_start_consumer(dev);
+	if (r < 0) {
+		_rtlsdr_stop_consumer(dev);
+		_rtlsdr_free_async_buffers(dev);
+		dev->markers_enabled = 0;
+		dev->async_status = RTLSDR_INACTIVE;
+		return r;
+	}
+
 	for(i = 0; i < dev->xfer_buf_num; ++i) {
 		libusb_fill_bulk_transfer(dev->xfer[i],
 					  dev->devh,
@@ -2015,8 +2469,13 @@ int rtlsdr_read_async(rtlsdr_dev_t *dev, rtlsdr_read_async_cb_t cb, void *ctx,
 		}
 	}
 
+	_rtlsdr_stop_consumer(dev);
 	_rtlsdr_free_async_buffers(dev);
 
+	pthread_mutex_lock(&dev->marker_mp);
+	dev->markers_enabled = 0;
+	pthread_mutex_unlock(&dev->marker_mp);
+
 	dev->async_status = next_status;
 
 	return r;
@@ -2044,6 +2503,160 @@ int rtlsdr_cancel_async(rtlsdr_dev_t *dev)
 	return -2;
 }
 
+int rtlsdr_set_async_consumer(rtlsdr_dev_t *dev, uint32_t queue_len)
+{
+	uint32_t len = 1;
+
+	if (!dev)
+		return -1;
+
+	if (RTLSDR_INACTIVE != dev->async_status)
+		return -2;
+
+	if (queue_len > MAX_CONSUMER_QUEUE)
+		return -1;
+
+	if (!queue_len) {
+		dev->consumer_queue_len = 0;
+		return 0;
+	}
+
+	while (len < queue_len)
+		len <<= 1;
+
+	dev->consumer_queue_len = len;
+	return 0;
+}
+
+int rtlsdr_get_async_stats(rtlsdr_dev_t *dev, rtlsdr_async_stats_t *stats)
+{
+	if (!dev || !stats)
+		return -1;
+
+	pthread_mutex_lock(&dev->stats_mp);
+	*stats = dev->async_stats;
+	pthread_mutex_unlock(&dev->stats_mp);
+	return 0;
+}
+
+int rtlsdr_set_output_format(rtlsdr_dev_t *dev,
+			     enum rtlsdr_sample_format format,
+			     int dc_block,
+			     int decimation)
+{
+	if (!dev)
+		return -1;
+
+	if (RTLSDR_INACTIVE != dev->async_status)
+		return -2;
+
+	if ((format != RTLSDR_SAMPLE_FLOAT32_IQ &&
+	     format != RTLSDR_SAMPLE_INT16_IQ) ||
+	    (decimation != 1 && decimation != 2 &&
+	     decimation != 4 && decimation != 8))
+		return -1;
+
+	dev->out_format = format;
+	dev->out_dc_block = dc_block ? 1 : 0;
+	dev->out_decimation = decimation;
+
+	return 0;
+}
+
+static void _converted_callback(unsigned char *buf, uint32_t len, void *ctx)
+{
+	rtlsdr_dev_t *dev = (rtlsdr_dev_t *)ctx;
+	void *samples;
+	int n;
+
+	n = iq_converter_process(dev->cnv, buf, len / 2, &samples);
+	if (n > 0)
+		dev->converted_cb(samples, (uint32_t)n, dev->converted_ctx);
+}
+
+int rtlsdr_read_async_converted(rtlsdr_dev_t *dev,
+				rtlsdr_read_async_converted_cb_t cb,
+				void *ctx,
+				uint32_t buf_num,
+				uint32_t buf_len)
+{
+	int r;
+
+	if (!dev || !cb)
+		return -1;
+
+	if (RTLSDR_INACTIVE != dev->async_status)
+		return -2;
+
+	dev->cnv = iq_converter_create(dev->out_format, dev->out_dc_block,
+				       dev->out_decimation);
+	if (!dev->cnv)
+		return -ENOMEM;
+
+	dev->converted_cb = cb;
+	dev->converted_ctx = ctx;
+
+	r = rtlsdr_read_async(dev, _converted_callback, dev, buf_num, buf_len);
+
+	iq_converter_free(dev->cnv);
+	dev->cnv = NULL;
+
+	return r;
+}
+
+static void _meta_callback(unsigned char *buf, uint32_t len, void *ctx)
+{
+	rtlsdr_dev_t *dev = (rtlsdr_dev_t *)ctx;
+	rtlsdr_buffer_meta_t meta;
+	rtlsdr_marker_t *m;
+	uint32_t n = 0;
+
+	meta.first_sample = dev->cb_first_sample;
+	meta.sample_count = len / 2;
+
+	/* hand over the markers issued before the end of this buffer */
+	pthread_mutex_lock(&dev->marker_mp);
+	while (dev->marker_tail != dev->marker_head) {
+		m = &dev->markers[dev->marker_tail % MAX_MARKERS];
+		if (m->issued >= meta.first_sample + meta.sample_count)
+			break;
+
+		dev->meta_markers[n++] = *m;
+		dev->marker_tail++;
+	}
+	pthread_mutex_unlock(&dev->marker_mp);
+
+	meta.marker_count = n;
+	meta.markers = n ? dev->meta_markers : NULL;
+
+	dev->meta_cb(buf, len, &meta, dev->meta_ctx);
+}
+
+int rtlsdr_read_async_meta(rtlsdr_dev_t *dev,
+			   rtlsdr_read_async_meta_cb_t cb,
+			   void *ctx,
+			   uint32_t buf_num,
+			   uint32_t buf_len)
+{
+	int r;
+
+	if (!dev || !cb)
+		return -1;
+
+	if (RTLSDR_INACTIVE != dev->async_status)
+		return -2;
+
+	dev->meta_cb = cb;
+	dev->meta_ctx = ctx;
+
+	r = rtlsdr_read_async(dev, _meta_callback, dev, buf_num, buf_len);
+
+	dev->meta_cb = NULL;
+	dev->meta_ctx = NULL;
+
+	return r;
+}
+
 uint32_t rtlsdr_get_tuner_clock(void *dev)
 {
 	uint32_t tuner_freq;
@@ -154,6 +154,32 @@ RTLSDR_API int rtlsdr_set_center_freq(rtlsdr_dev_t *dev, uint32_t freq);
  */
 RTLSDR_API uint32_t rtlsdr_get_center_freq(rtlsdr_dev_t *dev);
 
+/*!
+ * Prepare a list of frequencies for fast hopping with rtlsdr_set_hop_index().
+ * On R820T/R828D tuners the mux and PLL register values of every frequency
+ * are computed here, so a hop only writes the registers that differ from
+ * the current ones and polls for the PLL lock. Other tuners hop through
+ * rtlsdr_set_center_freq(). Prepare the list again after changing the
+ * sample rate, bandwidth or frequency correction, stale entries fall back
+ * to a regular retune.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param freqs array of frequencies in Hz, copied by the library
+ * \param count number of frequencies, 0 to release the list
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_prepare_hop_list(rtlsdr_dev_t *dev, const uint32_t *freqs,
+				       uint32_t count);
+
+/*!
+ * Tune to an entry of the list set up with rtlsdr_prepare_hop_list().
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param index position in the hop list
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_set_hop_index(rtlsdr_dev_t *dev, uint32_t index);
+
 /*!
  * Set the frequency correction value for the device.
  *
@@ -374,6 +400,123 @@ RTLSDR_API int rtlsdr_read_async(rtlsdr_dev_t *dev,
 				 uint32_t buf_num,
 				 uint32_t buf_len);
 
+enum rtlsdr_sample_format {
+	RTLSDR_SAMPLE_FLOAT32_IQ = 0,
+	RTLSDR_SAMPLE_INT16_IQ
+};
+
+typedef void(*rtlsdr_read_async_converted_cb_t)(void *samples, uint32_t sample_count, void *ctx);
+
+/*!
+ * Configure the sample conversion done by rtlsdr_read_async_converted().
+ * Can only be changed while not streaming.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param format float (scaled to +-1.0) or int16 complex samples
+ * \param dc_block 1 to remove the DC offset, 0 to keep it
+ * \param decimation 1, 2, 4 or 8, done with half-band filters
+ * \return 0 on success, -2 while streaming
+ */
+RTLSDR_API int rtlsdr_set_output_format(rtlsdr_dev_t *dev,
+					enum rtlsdr_sample_format format,
+					int dc_block,
+					int decimation);
+
+/*!
+ * Same as rtlsdr_read_async(), but the callback receives samples converted
+ * as configured with rtlsdr_set_output_format(), sample_count being the
+ * number of complex samples after decimation.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param cb callback function to return converted samples
+ * \param ctx user specific context to pass via the callback function
+ * \param buf_num optional buffer count, see rtlsdr_read_async()
+ * \param buf_len optional buffer length, see rtlsdr_read_async()
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_read_async_converted(rtlsdr_dev_t *dev,
+					   rtlsdr_read_async_converted_cb_t cb,
+					   void *ctx,
+					   uint32_t buf_num,
+					   uint32_t buf_len);
+
+/*!
+ * Run the async callback on a dedicated consumer thread. Completed USB
+ * transfers are swapped with a free buffer out of a pool and resubmitted
+ * immediately, the filled buffers are queued for the consumer thread. When
+ * the queue is full the data is dropped and counted in
+ * rtlsdr_get_async_stats(). Can only be changed while not streaming.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param queue_len number of queued buffers (rounded up to a power of two),
+ *		    0 to call the callback from the USB event loop (default)
+ * \return 0 on success, -2 while streaming
+ */
+RTLSDR_API int rtlsdr_set_async_consumer(rtlsdr_dev_t *dev, uint32_t queue_len);
+
+typedef struct rtlsdr_async_stats {
+	uint64_t transfers;	/* completed USB transfers */
+	uint64_t delivered;	/* buffers passed to the callback */
+	uint64_t dropped;	/* buffers lost because the consumer queue was full */
+	uint32_t queue_depth_max; /* highest consumer queue occupancy */
+} rtlsdr_async_stats_t;
+
+/*!
+ * Get the counters of the current or last asynchronous read.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param stats filled with the counters
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_get_async_stats(rtlsdr_dev_t *dev, rtlsdr_async_stats_t *stats);
+
+enum rtlsdr_marker_type {
+	RTLSDR_MARKER_FREQ = 0,		/* rtlsdr_set_center_freq(), rtlsdr_set_hop_index() */
+	RTLSDR_MARKER_GAIN,		/* rtlsdr_set_tuner_gain() */
+	RTLSDR_MARKER_GAIN_MODE		/* rtlsdr_set_tuner_gain_mode() */
+};
+
+typedef struct rtlsdr_marker {
+	enum rtlsdr_marker_type type;
+	int64_t value;		/* frequency in Hz, gain in tenth dB or gain mode */
+	int result;		/* return value of the call */
+	uint64_t issued;	/* sample index when the call was made */
+	uint64_t completed;	/* sample index when the call returned */
+} rtlsdr_marker_t;
+
+typedef struct rtlsdr_buffer_meta {
+	uint64_t first_sample;	/* stream index of the first sample in the buffer */
+	uint32_t sample_count;	/* complex samples in the buffer */
+	uint32_t marker_count;
+	const rtlsdr_marker_t *markers;	/* only valid during the callback */
+} rtlsdr_buffer_meta_t;
+
+typedef void(*rtlsdr_read_async_meta_cb_t)(unsigned char *buf, uint32_t len,
+					   const rtlsdr_buffer_meta_t *meta,
+					   void *ctx);
+
+/*!
+ * Same as rtlsdr_read_async(), but every buffer comes with its position in
+ * the stream and with the retune and gain changes made while streaming.
+ * Samples are counted from the start of the read, buffers dropped by the
+ * consumer thread still advance the count. A marker's sample indexes are
+ * estimated from the samples received so far plus the time elapsed since
+ * the last transfer completed. Each marker is reported once, with the
+ * first buffer that ends after its issued index.
+ *
+ * \param dev the device handle given by rtlsdr_open()
+ * \param cb callback function to return received samples and metadata
+ * \param ctx user specific context to pass via the callback function
+ * \param buf_num optional buffer count, see rtlsdr_read_async()
+ * \param buf_len optional buffer length, see rtlsdr_read_async()
+ * \return 0 on success
+ */
+RTLSDR_API int rtlsdr_read_async_meta(rtlsdr_dev_t *dev,
+				      rtlsdr_read_async_meta_cb_t cb,
+				      void *ctx,
+				      uint32_t buf_num,
+				      uint32_t buf_len);
+
 /*!
  * Cancel all pending asynchronous operations on the device.
  *
@@ -236,7 +236,7 @@ static int r82xx_xtal_capacitor[][2] = {
 /*
  * I2C read/write code and shadow registers logic
  */
-static void shadow_store(struct r82xx_priv *priv, uint8_t reg, const uint8_t *val,
+static void shadow_store(uint8_t *shadow, uint8_t reg, const uint8_t *val,
 			 int len)
 {
 	int r = reg - REG_SHADOW_START;
@@ -250,17 +250,14 @@ static void shadow_store(struct r82xx_priv *priv, uint8_t reg, const uint8_t *va
 	if (len > NUM_REGS - r)
 		len = NUM_REGS - r;
 
-	memcpy(&priv->regs[r], val, len);
+	memcpy(&shadow[r], val, len);
 }
 
-static int r82xx_write(struct r82xx_priv *priv, uint8_t reg, const uint8_t *val,
-		       unsigned int len)
+static int r82xx_write_raw(struct r82xx_priv *priv, uint8_t reg,
+			   const uint8_t *val, unsigned int len)
 {
 	int rc, size, pos = 0;
 
-	/* Store the shadow registers */
-	shadow_store(priv, reg, val, len);
-
 	do {
 		if (len > priv->cfg->max_i2c_msg_len - 1)
 			size = priv->cfg->max_i2c_msg_len - 1;
@@ -282,6 +279,9 @@ static int r82xx_write(struct r82xx_priv *priv, uint8_t reg, const uint8_t *val,
 			return -1;
 		}
 
+		/* Remember what the chip now holds */
+		shadow_store(priv->hw_regs, reg, &val[pos], size);
+
 		reg += size;
 		len -= size;
 		pos += size;
@@ -290,6 +290,107 @@ static int r82xx_write(struct r82xx_priv *priv, uint8_t reg, const uint8_t *val,
 	return 0;
 }
 
+/*
+ * Write batching: between r82xx_batch_begin() and r82xx_batch_end() writes
+ * to shadowed registers only update the shadow and mark the register dirty.
+ * The flush drops registers whose value the chip already holds and sends
+ * each run of consecutive dirty registers as a single I2C burst, in
+ * ascending register order. The one exception is the SDM pair, which goes
+ * high byte (0x16) first like r82xx_set_pll() writes it unbatched. Reads
+ * flush first so the chip is up to date.
+ */
+static int r82xx_batch_flush(struct r82xx_priv *priv)
+{
+	const int sdm_lo = 0x15 - REG_SHADOW_START;
+	const uint32_t sdm_pair = 3u << sdm_lo;
+	int rc, r, start, split_sdm;
+
+	if (!priv->dirty)
+		return 0;
+
+	/* The chip contents are only known once the init array was written */
+	if (priv->init_done) {
+		for (r = 0; r < NUM_REGS; r++) {
+			if (priv->regs[r] == priv->hw_regs[r])
+				priv->dirty &= ~(1u << r);
+		}
+	}
+
+	split_sdm = (priv->dirty & sdm_pair) == sdm_pair;
+
+	r = 0;
+	while (r < NUM_REGS) {
+		if (!(priv->dirty & (1u << r))) {
+			r++;
+			continue;
+		}
+
+		if (split_sdm && r == sdm_lo) {
+			rc = r82xx_write_raw(priv, 0x16, &priv->regs[sdm_lo + 1], 1);
+			if (rc < 0)
+				return rc;
+			rc = r82xx_write_raw(priv, 0x15, &priv->regs[sdm_lo], 1);
+			if (rc < 0)
+				return rc;
+
+			priv->dirty &= ~sdm_pair;
+			r += 2;
+			continue;
+		}
+
+		start = r;
+		while (r < NUM_REGS && (priv->dirty & (1u << r)) &&
+		       !(split_sdm && r == sdm_lo))
+			r++;
+
+		rc = r82xx_write_raw(priv, start + REG_SHADOW_START,
+				     &priv->regs[start], r - start);
+		if (rc < 0)
+			return rc;
+
+		priv->dirty &= ~(((1u << (r - start)) - 1) << start);
+	}
+
+	return 0;
+}
+
+static void r82xx_batch_begin(struct r82xx_priv *priv)
+{
+	priv->batch++;
+}
+
+static int r82xx_batch_end(struct r82xx_priv *priv)
+{
+	if (priv->batch > 0 && --priv->batch > 0)
+		return 0;
+
+	return r82xx_batch_flush(priv);
+}
+
+static int r82xx_write(struct r82xx_priv *priv, uint8_t reg, const uint8_t *val,
+		       unsigned int len)
+{
+	unsigned int i;
+	int rc;
+
+	/* Store the shadow registers */
+	shadow_store(priv->regs, reg, val, len);
+
+	if (priv->batch && reg >= REG_SHADOW_START &&
+	    reg + len <= REG_SHADOW_START + NUM_REGS) {
+		for (i = 0; i < len; i++)
+			priv->dirty |= 1u << (reg - REG_SHADOW_START + i);
+		return 0;
+	}
+
+	/* Keep pending writes ordered before this one */
+	rc = r82xx_batch_flush(priv);
+	if (rc < 0)
+		return rc;
+
+	return r82xx_write_raw(priv, reg, val, len);
+}
+
 static int r82xx_write_reg(struct r82xx_priv *priv, uint8_t reg, uint8_t val)
 {
 	return r82xx_write(priv, reg, &val, 1);
@@ -331,6 +432,10 @@ static int r82xx_read(struct r82xx_priv *priv, uint8_t reg, uint8_t *val, int le
 	int rc, i;
 	uint8_t *p = &priv->buf[1];
 
+	rc = r82xx_batch_flush(priv);
+	if (rc < 0)
+		return rc;
+
 	priv->buf[0] = reg;
 
 	rc = rtlsdr_i2c_write_fn(priv->rtl_dev, priv->cfg->i2c_addr, priv->buf, 1);
@@ -364,12 +469,9 @@ static int r82xx_read(struct r82xx_priv *priv, uint8_t reg, uint8_t *val, int le
  * r82xx tuning logic
  */
 
-static int r82xx_set_mux(struct r82xx_priv *priv, uint32_t freq)
+static const struct r82xx_freq_range *r82xx_get_range(uint32_t freq)
 {
-	const struct r82xx_freq_range *range;
-	int rc;
 	unsigned int i;
-	uint8_t val;
 
 	/* Get the proper frequency range */
 	freq = freq / 1000000;
@@ -377,7 +479,34 @@ static int r82xx_set_mux(struct r82xx_priv *priv, uint32_t freq)
 		if (freq < freq_ranges[i + 1].freq)
 			break;
 	}
-	range = &freq_ranges[i];
+
+	return &freq_ranges[i];
+}
+
+static uint8_t r82xx_xtal_cap(struct r82xx_priv *priv,
+			      const struct r82xx_freq_range *range)
+{
+	/* XTAL CAP & Drive */
+	switch (priv->xtal_cap_sel) {
+	case XTAL_LOW_CAP_30P:
+	case XTAL_LOW_CAP_20P:
+		return range->xtal_cap20p | 0x08;
+	case XTAL_LOW_CAP_10P:
+		return range->xtal_cap10p | 0x08;
+	case XTAL_HIGH_CAP_0P:
+		return range->xtal_cap0p | 0x00;
+	default:
+	case XTAL_LOW_CAP_0P:
+		return range->xtal_cap0p | 0x08;
+	}
+}
+
+static int r82xx_set_mux(struct r82xx_priv *priv, uint32_t freq)
+{
+	const struct r82xx_freq_range *range;
+	int rc;
+
+	range = r82xx_get_range(freq);
 
 	/* Open Drain */
 	rc = r82xx_write_reg_mask(priv, 0x17, range->open_d, 0x08);
@@ -394,24 +523,7 @@ static int r82xx_set_mux(struct r82xx_priv *priv, uint32_t freq)
 	if (rc < 0)
 		return rc;
 
-	/* XTAL CAP & Drive */
-	switch (priv->xtal_cap_sel) {
-	case XTAL_LOW_CAP_30P:
-	case XTAL_LOW_CAP_20P:
-		val = range->xtal_cap20p | 0x08;
-		break;
-	case XTAL_LOW_CAP_10P:
-		val = range->xtal_cap10p | 0x08;
-		break;
-	case XTAL_HIGH_CAP_0P:
-		val = range->xtal_cap0p | 0x00;
-		break;
-	default:
-	case XTAL_LOW_CAP_0P:
-		val = range->xtal_cap0p | 0x08;
-		break;
-	}
-	rc = r82xx_write_reg_mask(priv, 0x10, val, 0x0b);
+	rc = r82xx_write_reg_mask(priv, 0x10, r82xx_xtal_cap(priv, range), 0x0b);
 	if (rc < 0)
 		return rc;
 
@@ -424,10 +536,17 @@ static int r82xx_set_mux(struct r82xx_priv *priv, uint32_t freq)
 	return rc;
 }
 
-static int r82xx_set_pll(struct r82xx_priv *priv, uint32_t freq)
+/* Divider, integer and SDM settings of the PLL for one LO frequency */
+struct r82xx_pll_set {
+	uint8_t		div_num;
+	uint8_t		ni_si;
+	uint8_t		pw_sdm;
+	uint16_t	sdm;
+};
+
+static int r82xx_calc_pll(struct r82xx_priv *priv, uint32_t freq,
+			  uint8_t vco_fine_tune, struct r82xx_pll_set *pll)
 {
-	int rc, i;
-	unsigned sleep_time = 10000;
 	uint64_t vco_freq;
 	uint32_t vco_fra;	/* VCO contribution by SDM (kHz) */
 	uint32_t vco_min = 1770000;
@@ -439,29 +558,13 @@ static int r82xx_set_pll(struct r82xx_priv *priv, uint32_t freq)
 	uint8_t div_buf = 0;
 	uint8_t div_num = 0;
 	uint8_t vco_power_ref = 2;
-	uint8_t refdiv2 = 0;
-	uint8_t ni, si, nint, vco_fine_tune, val;
-	uint8_t data[5];
+	uint8_t ni, si, nint;
 
 	/* Frequency in kHz */
 	freq_khz = (freq + 500) / 1000;
 	pll_ref = priv->cfg->xtal;
 	pll_ref_khz = (priv->cfg->xtal + 500) / 1000;
 
-	rc = r82xx_write_reg_mask(priv, 0x10, refdiv2, 0x10);
-	if (rc < 0)
-		return rc;
-
-	/* set pll autotune = 128kHz */
-	rc = r82xx_write_reg_mask(priv, 0x1a, 0x00, 0x0c);
-	if (rc < 0)
-		return rc;
-
-	/* set VCO current = 100 */
-	rc = r82xx_write_reg_mask(priv, 0x12, 0x80, 0xe0);
-	if (rc < 0)
-		return rc;
-
 	/* Calculate divider */
 	while (mix_div <= 64) {
 		if (((freq_khz * mix_div) >= vco_min) &&
@@ -476,24 +579,14 @@ static int r82xx_set_pll(struct r82xx_priv *priv, uint32_t freq)
 		mix_div = mix_div << 1;
 	}
 
-	rc = r82xx_read(priv, 0x00, data, sizeof(data));
-	if (rc < 0)
-		return rc;
-
 	if (priv->cfg->rafael_chip == CHIP_R828D)
 		vco_power_ref = 1;
 
-	vco_fine_tune = (data[4] & 0x30) >> 4;
-
 	if (vco_fine_tune > vco_power_ref)
 		div_num = div_num - 1;
 	else if (vco_fine_tune < vco_power_ref)
 		div_num = div_num + 1;
 
-	rc = r82xx_write_reg_mask(priv, 0x10, div_num << 5, 0xe0);
-	if (rc < 0)
-		return rc;
-
 	vco_freq = (uint64_t)freq * (uint64_t)mix_div;
 	nint = vco_freq / (2 * pll_ref);
 	vco_fra = (vco_freq - 2 * pll_ref * nint) / 1000;
@@ -506,19 +599,8 @@ static int r82xx_set_pll(struct r82xx_priv *priv, uint32_t freq)
 	ni = (nint - 13) / 4;
 	si = nint - 4 * ni - 13;
 
-	rc = r82xx_write_reg(priv, 0x14, ni + (si << 6));
-	if (rc < 0)
-		return rc;
-
 	/* pw_sdm */
-	if (!vco_fra)
-		val = 0x08;
-	else
-		val = 0x00;
-
-	rc = r82xx_write_reg_mask(priv, 0x12, val, 0x08);
-	if (rc < 0)
-		return rc;
+	pll->pw_sdm = vco_fra ? 0x00 : 0x08;
 
 	/* sdm calculator */
 	while (vco_fra > 1) {
@@ -531,24 +613,34 @@ static int r82xx_set_pll(struct r82xx_priv *priv, uint32_t freq)
 		n_sdm <<= 1;
 	}
 
-	rc = r82xx_write_reg(priv, 0x16, sdm >> 8);
-	if (rc < 0)
-		return rc;
-	rc = r82xx_write_reg(priv, 0x15, sdm & 0xff);
-	if (rc < 0)
-		return rc;
+	pll->div_num = div_num;
+	pll->ni_si = ni + (si << 6);
+	pll->sdm = sdm;
+
+	return 0;
+}
 
-	for (i = 0; i < 2; i++) {
-//		usleep_range(sleep_time, sleep_time + 1000);
+/*
+ * Poll the lock flag instead of sleeping: each read is a USB round trip,
+ * which is usually all the time the PLL needs. The VCO current is raised
+ * half-way through if it still has not locked.
+ */
+#define PLL_LOCK_POLLS	4
 
+static int r82xx_pll_lock(struct r82xx_priv *priv)
+{
+	int rc, i;
+	uint8_t data[3];
+
+	for (i = 0; i < 2 * PLL_LOCK_POLLS; i++) {
 		/* Check if PLL has locked */
-		rc = r82xx_read(priv, 0x00, data, 3);
+		rc = r82xx_read(priv, 0x00, data, sizeof(data));
 		if (rc < 0)
 			return rc;
 		if (data[2] & 0x40)
 			break;
 
-		if (!i) {
+		if (i == PLL_LOCK_POLLS - 1) {
 			/* Didn't lock. Increase VCO current */
 			rc = r82xx_write_reg_mask(priv, 0x12, 0x60, 0xe0);
 			if (rc < 0)
@@ -565,9 +657,58 @@ static int r82xx_set_pll(struct r82xx_priv *priv, uint32_t freq)
 	priv->has_lock = 1;
 
 	/* set pll autotune = 8kHz */
-	rc = r82xx_write_reg_mask(priv, 0x1a, 0x08, 0x08);
+	return r82xx_write_reg_mask(priv, 0x1a, 0x08, 0x08);
+}
 
-	return rc;
+static int r82xx_set_pll(struct r82xx_priv *priv, uint32_t freq)
+{
+	struct r82xx_pll_set pll;
+	int rc;
+	uint8_t refdiv2 = 0;
+	uint8_t data[5];
+
+	rc = r82xx_write_reg_mask(priv, 0x10, refdiv2, 0x10);
+	if (rc < 0)
+		return rc;
+
+	/* set pll autotune = 128kHz */
+	rc = r82xx_write_reg_mask(priv, 0x1a, 0x00, 0x0c);
+	if (rc < 0)
+		return rc;
+
+	/* set VCO current = 100 */
+	rc = r82xx_write_reg_mask(priv, 0x12, 0x80, 0xe0);
+	if (rc < 0)
+		return rc;
+
+	rc = r82xx_read(priv, 0x00, data, sizeof(data));
+	if (rc < 0)
+		return rc;
+
+	rc = r82xx_calc_pll(priv, freq, (data[4] & 0x30) >> 4, &pll);
+	if (rc < 0)
+		return rc;
+
+	rc = r82xx_write_reg_mask(priv, 0x10, pll.div_num << 5, 0xe0);
+	if (rc < 0)
+		return rc;
+
+	rc = r82xx_write_reg(priv, 0x14, pll.ni_si);
+	if (rc < 0)
+		return rc;
+
+	rc = r82xx_write_reg_mask(priv, 0x12, pll.pw_sdm, 0x08);
+	if (rc < 0)
+		return rc;
+
+	rc = r82xx_write_reg(priv, 0x16, pll.sdm >> 8);
+	if (rc < 0)
+		return rc;
+	rc = r82xx_write_reg(priv, 0x15, pll.sdm & 0xff);
+	if (rc < 0)
+		return rc;
+
+	return r82xx_pll_lock(priv);
 }
 
 static int r82xx_sysfreq_sel(struct r82xx_priv *priv, uint32_t freq,
@@ -1099,34 +1240,28 @@ int r82xx_set_bandwidth(struct r82xx_priv *priv, int bw, uint32_t rate)
 #undef FILT_HP_BW1
 #undef FILT_HP_BW2
 
-int r82xx_set_freq(struct r82xx_priv *priv, uint32_t freq)
+static uint32_t r82xx_lo_freq(struct r82xx_priv *priv, uint32_t freq,
+			      int is_rtlsdr_blog_v4)
 {
-	int rc = -1;
-	int is_rtlsdr_blog_v4;
 	uint32_t upconvert_freq;
-	uint32_t lo_freq;
-	uint8_t air_cable1_in;
-	uint8_t open_d;
-	uint8_t band;
-	uint8_t cable_2_in;
-	uint8_t cable_1_in;
-	uint8_t air_in;
-
-	is_rtlsdr_blog_v4 = rtlsdr_check_dongle_model(priv->rtl_dev, "RTLSDRBlog", "Blog V4");
 
 	/* if it's an RTL-SDR Blog V4, automatically upconvert by 28.8 MHz if we tune to HF
 	 * so that we don't need to manually set any upconvert offset in the SDR software */
 	upconvert_freq = is_rtlsdr_blog_v4 ? ((freq < MHZ(28.8)) ? (freq + MHZ(28.8)) : freq) : freq;
 
-	lo_freq = upconvert_freq + priv->int_freq;
-
-	rc = r82xx_set_mux(priv, lo_freq);
-	if (rc < 0)
-		goto err;
+	return upconvert_freq + priv->int_freq;
+}
 
-	rc = r82xx_set_pll(priv, lo_freq);
-	if (rc < 0 || !priv->has_lock)
-		goto err;
+static int r82xx_set_input(struct r82xx_priv *priv, uint32_t freq,
+			   int is_rtlsdr_blog_v4)
+{
+	int rc = 0;
+	uint8_t air_cable1_in;
+	uint8_t open_d;
+	uint8_t band;
+	uint8_t cable_2_in;
+	uint8_t cable_1_in;
+	uint8_t air_in;
 
 	if (is_rtlsdr_blog_v4) {
 		/* determine if notch filters should be on or off notches are turned OFF
@@ -1152,27 +1287,24 @@ int r82xx_set_freq(struct r82xx_priv *priv, uint32_t freq)
 			rc = r82xx_write_reg_mask(priv, 0x06, cable_2_in, 0x08);
 
 			if (rc < 0)
-				goto err;
+				return rc;
 
 			/* Control upconverter GPIO switch on newer batches */
 			rc = rtlsdr_set_bias_tee_gpio(priv->rtl_dev, 5, !cable_2_in);
 
 			if (rc < 0)
-				goto err;
+				return rc;
 
 			/* activate cable 1 (VHF input) */
 			cable_1_in = (band == VHF) ? 0x40 : 0x00;
 			rc = r82xx_write_reg_mask(priv, 0x05, cable_1_in, 0x40);
 
 			if (rc < 0)
-				goto err;
+				return rc;
 
 			/* activate air_in (UHF input) */
 			air_in = (band == UHF) ? 0x00 : 0x20;
 			rc = r82xx_write_reg_mask(priv, 0x05, air_in, 0x20);
-
-			if (rc < 0)
-				goto err;
 		}
 	}
 	else /* Standard R828D dongle*/
@@ -1190,7 +1322,129 @@ int r82xx_set_freq(struct r82xx_priv *priv, uint32_t freq)
 		}
 	}
 
+	return rc;
+}
+
+int r82xx_set_freq(struct r82xx_priv *priv, uint32_t freq)
+{
+	int rc = -1, flush_rc;
+	int is_rtlsdr_blog_v4;
+	uint32_t lo_freq;
+
+	is_rtlsdr_blog_v4 = rtlsdr_check_dongle_model(priv->rtl_dev, "RTLSDRBlog", "Blog V4");
+
+	lo_freq = r82xx_lo_freq(priv, freq, is_rtlsdr_blog_v4);
+
+	/* Collect the register updates of a retune into as few bursts as possible */
+	r82xx_batch_begin(priv);
+
+	rc = r82xx_set_mux(priv, lo_freq);
+	if (rc < 0)
+		goto err;
+
+	rc = r82xx_set_pll(priv, lo_freq);
+	if (rc < 0 || !priv->has_lock)
+		goto err;
+
+	rc = r82xx_set_input(priv, freq, is_rtlsdr_blog_v4);
+
 err:
+	flush_rc = r82xx_batch_end(priv);
+	if (rc >= 0 && flush_rc < 0)
+		rc = flush_rc;
+
+	if (rc < 0)
+		fprintf(stderr, "%s: failed=%d\n", __FUNCTION__, rc);
+	return rc;
+}
+
+/*
+ * Frequency hopping: r82xx_prepare_hop() computes the mux and PLL register
+ * image of a frequency once, r82xx_set_hop() then only has to write the
+ * registers that differ from the current state and wait for the lock.
+ */
+static const uint8_t r82xx_hop_regs[R82XX_HOP_REGS] = {
+	0x08, 0x09, 0x10, 0x12, 0x14, 0x15, 0x16, 0x17, 0x1a, 0x1b
+};
+
+static const uint8_t r82xx_hop_masks[R82XX_HOP_REGS] = {
+	0x3f, 0x3f, 0xfb, 0xe8, 0xff, 0xff, 0xff, 0x08, 0xcf, 0xff
+};
+
+int r82xx_prepare_hop(struct r82xx_priv *priv, uint32_t freq,
+		      struct r82xx_hop *hop)
+{
+	const struct r82xx_freq_range *range;
+	struct r82xx_pll_set pll;
+	uint32_t lo_freq;
+	uint8_t data[5];
+	int rc;
+
+	lo_freq = r82xx_lo_freq(priv, freq,
+		rtlsdr_check_dongle_model(priv->rtl_dev, "RTLSDRBlog", "Blog V4"));
+
+	/* The VCO fine tune state is sampled once for the whole image */
+	rc = r82xx_read(priv, 0x00, data, sizeof(data));
+	if (rc < 0)
+		return rc;
+
+	rc = r82xx_calc_pll(priv, lo_freq, (data[4] & 0x30) >> 4, &pll);
+	if (rc < 0)
+		return rc;
+
+	range = r82xx_get_range(lo_freq);
+
+	hop->freq = freq;
+	hop->int_freq = priv->int_freq;
+	hop->xtal = priv->cfg->xtal;
+
+	hop->val[0] = 0x00;
+	hop->val[1] = 0x00;
+	/* refdiv2 = 0, divider and xtal cap */
+	hop->val[2] = (pll.div_num << 5) | r82xx_xtal_cap(priv, range);
+	/* VCO current = 100 and pw_sdm */
+	hop->val[3] = 0x80 | pll.pw_sdm;
+	hop->val[4] = pll.ni_si;
+	hop->val[5] = pll.sdm & 0xff;
+	hop->val[6] = pll.sdm >> 8;
+	hop->val[7] = range->open_d;
+	/* RF_MUX,Polymux and pll autotune = 128kHz */
+	hop->val[8] = range->rf_mux_ploy & 0xc3;
+	hop->val[9] = range->tf_c;
+
+	return 0;
+}
+
+int r82xx_set_hop(struct r82xx_priv *priv, const struct r82xx_hop *hop)
+{
+	int rc = 0, flush_rc;
+	unsigned int i;
+
+	/* The image is stale once the IF or the reference clock changed */
+	if (hop->int_freq != priv->int_freq || hop->xtal != priv->cfg->xtal)
+		return r82xx_set_freq(priv, hop->freq);
+
+	r82xx_batch_begin(priv);
+
+	for (i = 0; i < R82XX_HOP_REGS; i++) {
+		rc = r82xx_write_reg_mask(priv, r82xx_hop_regs[i], hop->val[i],
+					  r82xx_hop_masks[i]);
+		if (rc < 0)
+			goto err;
+	}
+
+	rc = r82xx_pll_lock(priv);
+	if (rc < 0 || !priv->has_lock)
+		goto err;
+
+	rc = r82xx_set_input(priv, hop->freq,
+		rtlsdr_check_dongle_model(priv->rtl_dev, "RTLSDRBlog", "Blog V4"));
+
+err:
+	flush_rc = r82xx_batch_end(priv);
+	if (rc >= 0 && flush_rc < 0)
+		rc = flush_rc;
+
 	if (rc < 0)
 		fprintf(stderr, "%s: failed=%d\n", __FUNCTION__, rc);
 	return rc;
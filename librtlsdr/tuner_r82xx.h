@@ -76,6 +76,7 @@ struct r82xx_priv {
 	struct r82xx_config		*cfg;
 
 	uint8_t				regs[NUM_REGS];
+	uint8_t				hw_regs[NUM_REGS];	/* last written to the chip */
 	uint8_t				buf[NUM_REGS + 1];
 	enum r82xx_xtal_cap_value	xtal_cap_sel;
 	uint16_t			pll;	/* kHz */
@@ -85,6 +86,10 @@ struct r82xx_priv {
 	int				has_lock;
 	int				init_done;
 
+	/* Deferred register writes, see r82xx_batch_begin() */
+	uint32_t			dirty;
+	int				batch;
+
 	/* Store current mode */
 	uint32_t			delsys;
 	enum r82xx_tuner_type		type;
@@ -94,6 +99,16 @@ struct r82xx_priv {
 	void *rtl_dev;
 };
 
+/* Precomputed tuning registers of one frequency, see r82xx_prepare_hop() */
+#define R82XX_HOP_REGS		10
+
+struct r82xx_hop {
+	uint32_t	freq;
+	uint32_t	int_freq;
+	uint32_t	xtal;
+	uint8_t		val[R82XX_HOP_REGS];
+};
+
 struct r82xx_freq_range {
 	uint32_t	freq;
 	uint8_t		open_d;
@@ -116,5 +131,8 @@ int r82xx_init(struct r82xx_priv *priv);
 int r82xx_set_freq(struct r82xx_priv *priv, uint32_t freq);
 int r82xx_set_gain(struct r82xx_priv *priv, int set_manual_gain, int gain);
 int r82xx_set_bandwidth(struct r82xx_priv *priv, int bandwidth,  uint32_t rate);
+int r82xx_prepare_hop(struct r82xx_priv *priv, uint32_t freq,
+		      struct r82xx_hop *hop);
+int r82xx_set_hop(struct r82xx_priv *priv, const struct r82xx_hop *hop);
 
 #endif